@@ -84,11 +84,27 @@ struct Methcla_EngineOptions
     Methcla_PacketHandler       packet_handler;
 
     size_t                      sample_rate;
+    //* Internal processing block size; audio driver buffers of any size are processed in blocks of at most this many frames (0 uses the driver's buffer size).
     size_t                      block_size;
 
     size_t                      realtime_memory_size;
+    //* Maximum number of nodes that may exist at the same time; node ids can be any non-negative 32 bit integer.
     size_t                      max_num_nodes;
     size_t                      max_num_audio_buses;
+    //* Number of control buses that synth control ports can be mapped to.
+    size_t                      max_num_control_buses;
+
+    //* Number of helper threads for processing independent synths in parallel (0 disables parallel processing).
+    size_t                      num_helper_threads;
+
+    //* Number of synth instances per synth definition whose memory is reserved on first use and recycled after freeing (0 disables recycling).
+    size_t                      synth_instance_pool_size;
+
+    //* Number of block-sized buffers shared by all synths for staging audio port data; synths with at most this many audio ports don't reserve buffers of their own (0 disables sharing). Only used without helper threads.
+    size_t                      num_synth_scratch_buffers;
+
+    //* Maximum number of freed nodes destroyed per audio callback, regardless of the number of blocks it processes; destruction of further nodes is deferred to subsequent callbacks (0 destroys all freed nodes at the end of the callback).
+    size_t                      max_num_node_destroys_per_block;
 
     Methcla_LogLevel            log_level;
 
@@ -146,6 +162,64 @@ METHCLA_EXPORT Methcla_Time methcla_engine_current_time(Methcla_Engine* engine);
 //* Send an OSC packet to the engine.
 METHCLA_EXPORT Methcla_Error methcla_engine_send(Methcla_Engine* engine, const void* packet, size_t size);
 
+//* Opcodes of binary engine commands.
+typedef enum
+{
+    //* Set control input `index` of synth `node_id` to `value` (equivalent to `/node/set`).
+    kMethcla_EngineCommandNodeSet = 1,
+    //* Set control bus `index` to `value` (equivalent to `/bus/control/set`); `node_id` is ignored.
+    kMethcla_EngineCommandBusControlSet
+} Methcla_EngineCommandOpcode;
+
+//* Fixed-size binary command for high-rate parameter updates.
+typedef struct Methcla_EngineCommand
+{
+    //* One of Methcla_EngineCommandOpcode.
+    uint32_t     opcode;
+    int32_t      node_id;
+    int32_t      index;
+    float        value;
+    //* Time at which the command takes effect, or 0 for the start of the next audio block.
+    //
+    //  Commands that take effect at the same frame are executed in the order they are sent; a command for a later frame doesn't delay the commands sent after it.
+    Methcla_Time time;
+} Methcla_EngineCommand;
+
+//* Send binary commands to the engine.
+//
+//  Commands are written to a lock-free ring buffer that the audio thread drains at the frames the commands take effect, in addition to OSC requests, without allocating memory. Commands that take effect at the same frame as an OSC request are executed after it.
+//
+//  Can be called from any thread. Either all commands are sent or none: Invalid commands are rejected and an error is returned if the ring buffer doesn't have room for all of the commands.
+METHCLA_EXPORT Methcla_Error methcla_engine_send_commands(Methcla_Engine* engine, const Methcla_EngineCommand* commands, size_t numCommands);
+
+enum
+{
+    //* Number of bins in Methcla_EngineLoadStatistics::histogram.
+    kMethcla_EngineLoadHistogramSize = 11
+};
+
+//* DSP load statistics of the engine's audio callback.
+//
+//  The load of a callback is the time spent processing relative to the duration of the audio processed; a load of one or more means that the deadline was missed.
+typedef struct Methcla_EngineLoadStatistics
+{
+    //* Load of recent callbacks, smoothed with a time constant of one second.
+    double   load;
+    //* Highest load of a single callback.
+    double   peak_load;
+    //* Number of callbacks processed.
+    uint64_t num_callbacks;
+    //* Number of callbacks that overran their deadline.
+    uint64_t num_xruns;
+    //* Histogram of callback loads; bin i counts callbacks with a load in [i/10, (i+1)/10), the last bin counts overruns.
+    uint64_t histogram[kMethcla_EngineLoadHistogramSize];
+} Methcla_EngineLoadStatistics;
+
+//* Get the DSP load statistics of the engine.
+//
+//  Can be called from any thread.
+METHCLA_EXPORT Methcla_Error methcla_engine_load_statistics(const Methcla_Engine* engine, Methcla_EngineLoadStatistics* statistics);
+
 //* Open a sound file.
 METHCLA_EXPORT Methcla_Error methcla_engine_soundfile_open(const Methcla_Engine* engine, const char* path, Methcla_FileMode mode, Methcla_SoundFile** file, Methcla_SoundFileInfo* info);
 
@@ -22,6 +22,7 @@
 #include <methcla/detail.hpp>
 #include <methcla/detail/result.hpp>
 
+#include <deque>
 #include <exception>
 #include <iostream>
 #include <list>
@@ -115,6 +116,17 @@ namespace Methcla
         { }
     };
 
+    class ControlBusId : public detail::Id<ControlBusId,int32_t>
+    {
+    public:
+        ControlBusId(int32_t id)
+            : Id<ControlBusId,int32_t>(id)
+        { }
+        ControlBusId()
+            : ControlBusId(0)
+        { }
+    };
+
     // Node placement specification given a target.
     class NodePlacement
     {
@@ -206,10 +218,16 @@ namespace Methcla
     {
         size_t freeNumBytes;
         size_t usedNumBytes;
+        //* Number of synth allocations served from a synth definition's instance pool.
+        size_t freeListHits;
+        //* Number of synth allocations that fell back to the realtime heap.
+        size_t freeListMisses;
 
         RealtimeMemoryStatistics()
             : freeNumBytes(0)
             , usedNumBytes(0)
+            , freeListHits(0)
+            , freeListMisses(0)
         {}
 
         size_t totalNumBytes() const
@@ -218,6 +236,26 @@ namespace Methcla
         }
     };
 
+    //* DSP time accounted to a node or synth definition.
+    //
+    // Ticks are only comparable to each other; their unit depends on the platform's cycle counter.
+    struct Profile
+    {
+        size_t numCalls;
+        double numTicks;
+
+        Profile()
+            : numCalls(0)
+            , numTicks(0)
+        {}
+
+        //* Return the average number of ticks per process call.
+        double ticksPerCall() const
+        {
+            return numCalls > 0 ? numTicks / numCalls : 0;
+        }
+    };
+
     template <class Id, typename T> class ResourceIdAllocator
     {
     public:
@@ -238,47 +276,47 @@ namespace Methcla
             size_t available() const { return capacity() - allocated(); }
         };
 
+        //* Allocate up to `n` ids starting at `minValue`.
+        //
+        // Ids are handed out in increasing order at first; freed ids are queued and reused in the order they were freed once enough of them have accumulated, so that a freed id isn't reused right away. Memory usage is proportional to the number of ids in use plus the reuse delay, and allocation takes constant time.
         ResourceIdAllocator(T minValue, size_t n)
             : m_offset(minValue)
-            , m_bits(n)
-            , m_pos(0)
+            , m_capacity(n)
+            , m_reuseDelay(n / 2 < kMaxReuseDelay ? n / 2 : kMaxReuseDelay)
             , m_allocated(0)
         { }
 
         Statistics getStatistics()
         {
             std::lock_guard<std::mutex> lock(m_mutex);
-            return Statistics(m_bits.size(), m_allocated);
+            return Statistics(m_capacity, m_allocated);
         }
 
         Id alloc()
         {
             std::lock_guard<std::mutex> lock(m_mutex);
-            for (size_t i=m_pos; i < m_bits.size(); i++) {
-                if (!m_bits[i]) {
-                    m_bits[i] = true;
-                    m_pos = (i+1) == m_bits.size() ? 0 : i+1;
-                    m_allocated++;
-                    return Id(m_offset + i);
-                }
-            }
-            for (size_t i=0; i < m_pos; i++) {
-                if (!m_bits[i]) {
-                    m_bits[i] = true;
-                    m_pos = i+1;
-                    m_allocated++;
-                    return Id(m_offset + i);
-                }
+            size_t i;
+            if (!m_free.empty() && (m_free.size() > m_reuseDelay || m_used.size() == m_capacity)) {
+                i = m_free.front();
+                m_free.pop_front();
+            } else if (m_used.size() < m_capacity) {
+                i = m_used.size();
+                m_used.push_back(false);
+            } else {
+                throw std::runtime_error("No free ids");
             }
-            throw std::runtime_error("No free ids");
+            m_used[i] = true;
+            m_allocated++;
+            return Id(m_offset + (T)i);
         }
 
         void free(Id id)
         {
             std::lock_guard<std::mutex> lock(m_mutex);
             T i = id.id() - m_offset;
-            if ((i >= 0) && (i < (T)m_bits.size()) && m_bits[i]) {
-                m_bits[i] = false;
+            if ((i >= 0) && ((size_t)i < m_used.size()) && m_used[i]) {
+                m_used[i] = false;
+                m_free.push_back(i);
                 m_allocated--;
 #if 0 // Don't throw exception for now
             } else {
@@ -288,9 +326,15 @@ namespace Methcla
         }
 
     private:
+        static const size_t kMaxReuseDelay = 4096;
+
         T                 m_offset;
-        std::vector<bool> m_bits;
-        size_t            m_pos;
+        size_t            m_capacity;
+        size_t            m_reuseDelay;
+        // Ids that have been handed out at least once
+        std::vector<bool> m_used;
+        // Freed ids in the order they were freed
+        std::deque<size_t> m_free;
         size_t            m_allocated;
         // TODO: Make lock configurable?
         std::mutex        m_mutex;
@@ -485,6 +529,10 @@ namespace Methcla
         size_t maxNumControlBuses = 4096;
         size_t sampleRate = 44100;
         size_t blockSize = 64;
+        size_t numHelperThreads = 0;
+        size_t synthInstancePoolSize = 8;
+        size_t numSynthScratchBuffers = 16;
+        size_t maxNumNodeDestroysPerBlock = 64;
         std::list<LibraryFunction> pluginLibraries;
 
         AudioDriverOptions audioDriver;
@@ -522,6 +570,11 @@ namespace Methcla
             m_options.realtime_memory_size = realtimeMemorySize;
             m_options.max_num_nodes = maxNumNodes;
             m_options.max_num_audio_buses = maxNumAudioBuses;
+            m_options.max_num_control_buses = maxNumControlBuses;
+            m_options.num_helper_threads = numHelperThreads;
+            m_options.synth_instance_pool_size = synthInstancePoolSize;
+            m_options.num_synth_scratch_buffers = numSynthScratchBuffers;
+            m_options.max_num_node_destroys_per_block = maxNumNodeDestroysPerBlock;
             m_options.log_level = logLevel;
 
             m_pluginLibraries.assign(pluginLibraries.begin(), pluginLibraries.end());
@@ -537,6 +590,7 @@ namespace Methcla
 
     typedef ResourceIdAllocator<NodeId,int32_t> NodeIdAllocator;
     typedef ResourceIdAllocator<AudioBusId,int32_t> AudioBusIdAllocator;
+    typedef ResourceIdAllocator<ControlBusId,int32_t> ControlBusIdAllocator;
 
     class Request;
 
@@ -558,13 +612,21 @@ namespace Methcla
         inline void bundle(Methcla_Time time, std::function<void(Request&)> func);
 
         inline GroupId group(const NodePlacement& placement);
+        inline GroupId parGroup(const NodePlacement& placement);
         inline void freeAll(GroupId group);
         inline SynthId synth(const char* synthDef, const NodePlacement& placement, const std::vector<float>& controls, const std::list<Value>& options=std::list<Value>());
         inline void activate(SynthId synth);
         inline void mapInput(SynthId synth, size_t index, AudioBusId bus, BusMappingFlags flags=kBusMappingInternal);
         inline void mapOutput(SynthId synth, size_t index, AudioBusId bus, BusMappingFlags flags=kBusMappingInternal);
+        inline void mapInputs(SynthId synth, size_t index, AudioBusId bus, size_t numChannels, BusMappingFlags flags=kBusMappingInternal);
+        inline void mapOutputs(SynthId synth, size_t index, AudioBusId bus, size_t numChannels, BusMappingFlags flags=kBusMappingInternal);
+        inline void mapControlInput(SynthId synth, size_t index, ControlBusId bus);
+        inline void mapControlInput(SynthId synth, size_t index, AudioBusId bus, BusMappingFlags flags);
+        inline void mapControlOutput(SynthId synth, size_t index, ControlBusId bus);
+        inline void setControlBus(ControlBusId bus, double value);
         inline void set(NodeId node, size_t index, double value);
         inline void free(NodeId node);
+        inline void run(NodeId node, bool running);
     };
 
     class Request
@@ -686,6 +748,23 @@ namespace Methcla
             return GroupId(nodeId.id());
         }
 
+        //* Create a group whose children may be processed in parallel.
+        GroupId parGroup(const NodePlacement& placement)
+        {
+            beginMessage();
+
+            const NodeId nodeId(m_engine->nodeIdAllocator().alloc());
+
+            oscPacket()
+                .openMessage("/pargroup/new", 3)
+                    .int32(nodeId.id())
+                    .int32(placement.target().id())
+                    .int32(placement.placement())
+                .closeMessage();
+
+            return GroupId(nodeId.id());
+        }
+
         void freeAll(GroupId group)
         {
             beginMessage();
@@ -721,6 +800,52 @@ namespace Methcla
             return SynthId(nodeId.id());
         }
 
+        //* Create one synth per element of `controls` in a single command.
+        //
+        // Each element holds the control initializers of one synth and must provide a value for each control input.
+        std::vector<SynthId> synths(const char* synthDef, const NodePlacement& placement, const std::vector<std::vector<float>>& controls, const std::list<Value>& options=std::list<Value>())
+        {
+            beginMessage();
+
+            std::vector<SynthId> result;
+            result.reserve(controls.size());
+            size_t numControls = 0;
+            for (const auto& x : controls) {
+                result.push_back(SynthId(m_engine->nodeIdAllocator().alloc().id()));
+                numControls += x.size();
+            }
+
+            oscPacket()
+                .openMessage("/synth/new/batch", 3 + OSCPP::Tags::array(result.size()) + OSCPP::Tags::array(numControls) + OSCPP::Tags::array(options.size()))
+                    .string(synthDef)
+                    .int32(placement.target().id())
+                    .int32(placement.placement());
+
+                    oscPacket().openArray();
+                        for (const auto& x : result) {
+                            oscPacket().int32(x.id());
+                        }
+                    oscPacket().closeArray();
+
+                    oscPacket().openArray();
+                        for (const auto& x : controls) {
+                            for (float y : x) {
+                                oscPacket().float32(y);
+                            }
+                        }
+                    oscPacket().closeArray();
+
+                    oscPacket().openArray();
+                        for (const auto& x : options) {
+                            x.put(oscPacket());
+                        }
+                    oscPacket().closeArray();
+
+                oscPacket().closeMessage();
+
+            return result;
+        }
+
         void activate(SynthId synth)
         {
             beginMessage();
@@ -757,6 +882,87 @@ namespace Methcla
                 .closeMessage();
         }
 
+        //* Map `numChannels` consecutive inputs starting at `index` to consecutive buses starting at `bus`.
+        void mapInputs(SynthId synth, size_t index, AudioBusId bus, size_t numChannels, BusMappingFlags flags=kBusMappingInternal)
+        {
+            beginMessage();
+
+            oscPacket()
+                .openMessage("/synth/map/inputs", 5)
+                    .int32(synth.id())
+                    .int32(index)
+                    .int32(bus.id())
+                    .int32(numChannels)
+                    .int32(flags)
+                .closeMessage();
+        }
+
+        //* Map `numChannels` consecutive outputs starting at `index` to consecutive buses starting at `bus`.
+        void mapOutputs(SynthId synth, size_t index, AudioBusId bus, size_t numChannels, BusMappingFlags flags=kBusMappingInternal)
+        {
+            beginMessage();
+
+            oscPacket()
+                .openMessage("/synth/map/outputs", 5)
+                    .int32(synth.id())
+                    .int32(index)
+                    .int32(bus.id())
+                    .int32(numChannels)
+                    .int32(flags)
+                .closeMessage();
+        }
+
+        //* Map control input to control bus; a bus id of -1 unmaps the input.
+        void mapControlInput(SynthId synth, size_t index, ControlBusId bus)
+        {
+            beginMessage();
+
+            oscPacket()
+                .openMessage("/synth/map/control/input", 3)
+                    .int32(synth.id())
+                    .int32(index)
+                    .int32(bus.id())
+                .closeMessage();
+        }
+
+        //* Map control input to audio bus; a bus id of -1 unmaps the input.
+        void mapControlInput(SynthId synth, size_t index, AudioBusId bus, BusMappingFlags flags)
+        {
+            beginMessage();
+
+            oscPacket()
+                .openMessage("/synth/map/control/input/audio", 4)
+                    .int32(synth.id())
+                    .int32(index)
+                    .int32(bus.id())
+                    .int32(flags)
+                .closeMessage();
+        }
+
+        //* Map control output to control bus; a bus id of -1 unmaps the output.
+        void mapControlOutput(SynthId synth, size_t index, ControlBusId bus)
+        {
+            beginMessage();
+
+            oscPacket()
+                .openMessage("/synth/map/control/output", 3)
+                    .int32(synth.id())
+                    .int32(index)
+                    .int32(bus.id())
+                .closeMessage();
+        }
+
+        void setControlBus(ControlBusId bus, double value)
+        {
+            beginMessage();
+
+            oscPacket()
+                .openMessage("/bus/control/set", 2)
+                    .int32(bus.id())
+                    .float32(value)
+                .closeMessage();
+        }
+
         void set(NodeId node, size_t index, double value)
         {
             beginMessage();
@@ -780,6 +986,17 @@ namespace Methcla
             m_engine->nodeIdAllocator().free(node.id());
         }
 
+        void run(NodeId node, bool running)
+        {
+            beginMessage();
+
+            oscPacket()
+                .openMessage("/node/run", 2)
+                    .int32(node.id())
+                    .int32(running)
+                .closeMessage();
+        }
+
         void whenDone(SynthId synth, NodeDoneFlags flags)
         {
             beginMessage();
@@ -807,6 +1024,14 @@ namespace Methcla
         return result;
     }
 
+    GroupId EngineInterface::parGroup(const NodePlacement& placement)
+    {
+        Request request(this);
+        GroupId result = request.parGroup(placement);
+        request.send();
+        return result;
+    }
+
     void EngineInterface::freeAll(GroupId group)
     {
         Request request(this);
@@ -843,6 +1068,48 @@ namespace Methcla
         request.send();
     }
 
+    void EngineInterface::mapInputs(SynthId synth, size_t index, AudioBusId bus, size_t numChannels, BusMappingFlags flags)
+    {
+        Request request(this);
+        request.mapInputs(synth, index, bus, numChannels, flags);
+        request.send();
+    }
+
+    void EngineInterface::mapOutputs(SynthId synth, size_t index, AudioBusId bus, size_t numChannels, BusMappingFlags flags)
+    {
+        Request request(this);
+        request.mapOutputs(synth, index, bus, numChannels, flags);
+        request.send();
+    }
+
+    void EngineInterface::mapControlInput(SynthId synth, size_t index, ControlBusId bus)
+    {
+        Request request(this);
+        request.mapControlInput(synth, index, bus);
+        request.send();
+    }
+
+    void EngineInterface::mapControlInput(SynthId synth, size_t index, AudioBusId bus, BusMappingFlags flags)
+    {
+        Request request(this);
+        request.mapControlInput(synth, index, bus, flags);
+        request.send();
+    }
+
+    void EngineInterface::mapControlOutput(SynthId synth, size_t index, ControlBusId bus)
+    {
+        Request request(this);
+        request.mapControlOutput(synth, index, bus);
+        request.send();
+    }
+
+    void EngineInterface::setControlBus(ControlBusId bus, double value)
+    {
+        Request request(this);
+        request.setControlBus(bus, value);
+        request.send();
+    }
+
     void EngineInterface::set(NodeId node, size_t index, double value)
     {
         Request request(this);
@@ -857,6 +1124,13 @@ namespace Methcla
         request.send();
     }
 
+    void EngineInterface::run(NodeId node, bool running)
+    {
+        Request request(this);
+        request.run(node, running);
+        request.send();
+    }
+
     class Engine : public EngineInterface
     {
     public:
@@ -864,6 +1138,7 @@ namespace Methcla
             : m_logHandler(inOptions.logHandler)
             , m_nodeIds(1, inOptions.maxNumNodes - 1)
             , m_audioBusIds(0, inOptions.maxNumAudioBuses)
+            , m_controlBusIds(0, inOptions.maxNumControlBuses)
             , m_requestId(kMethcla_Notification+1)
             , m_notificationHandlerId(0)
             , m_packets(8192)
@@ -921,6 +1196,22 @@ namespace Methcla
             return methcla_engine_current_time(m_engine);
         }
 
+        //* Return the DSP load statistics of the engine's audio callback.
+        Methcla_EngineLoadStatistics loadStatistics() const
+        {
+            Methcla_EngineLoadStatistics result;
+            detail::checkReturnCode(methcla_engine_load_statistics(m_engine, &result));
+            return result;
+        }
+
+        //* Send binary commands to the engine.
+        //
+        // Binary commands bypass OSC encoding and are meant for high-rate parameter updates.
+        void sendCommands(const Methcla_EngineCommand* commands, size_t numCommands)
+        {
+            detail::checkReturnCode(methcla_engine_send_commands(m_engine, commands, numCommands));
+        }
+
         void setLogFlags(Methcla_EngineLogFlags flags)
         {
             methcla_engine_set_log_flags(m_engine, flags);
@@ -946,6 +1237,11 @@ namespace Methcla
             return m_audioBusIds;
         }
 
+        ControlBusIdAllocator& controlBusId()
+        {
+            return m_controlBusIds;
+        }
+
         std::unique_ptr<Packet> allocPacket() override
         {
             return std::unique_ptr<Packet>(new Packet(m_packets));
@@ -1052,6 +1348,61 @@ namespace Methcla
             return result.get();
         }
 
+        //* Return the DSP time accumulated by a node.
+        //
+        // Groups report the sum over all synths in their sub-tree. Requires an engine built with profiling enabled.
+        Profile getNodeProfile(NodeId nodeId)
+        {
+            const char* request = "/node/profile";
+            const Methcla_RequestId requestId = getRequestId();
+            auto packet = allocPacket();
+            packet->packet()
+                .openMessage(request, 2)
+                .int32(requestId)
+                .int32(nodeId.id())
+                .closeMessage();
+            detail::Result<Profile> result;
+            withRequest(requestId, packet->packet(), [&request,&result](Methcla_RequestId, const OSCPP::Server::Message& response){
+                result.checkResponse(request, response);
+                OSCPP::Server::ArgStream args(response.args());
+                args.int32(); // node id
+                Profile value;
+                value.numCalls = args.int32();
+                value.numTicks = args.float32();
+                result.set(value);
+            });
+            return result.get();
+        }
+
+        //* Return the DSP time accumulated by all instances of each synth definition, indexed by URI.
+        //
+        // Requires an engine built with profiling enabled.
+        std::unordered_map<std::string,Profile> getSynthDefProfiles()
+        {
+            const char* request = "/synthdef/profile";
+            const Methcla_RequestId requestId = getRequestId();
+            auto packet = allocPacket();
+            packet->packet()
+                .openMessage(request, 1)
+                .int32(requestId)
+                .closeMessage();
+            detail::Result<std::unordered_map<std::string,Profile>> result;
+            withRequest(requestId, packet->packet(), [&request,&result](Methcla_RequestId, const OSCPP::Server::Message& response){
+                result.checkResponse(request, response);
+                OSCPP::Server::ArgStream args(response.args());
+                std::unordered_map<std::string,Profile> value;
+                while (!args.atEnd()) {
+                    const std::string uri(args.string());
+                    Profile profile;
+                    profile.numCalls = args.int32();
+                    profile.numTicks = args.float32();
+                    value[uri] = profile;
+                }
+                result.set(value);
+            });
+            return result.get();
+        }
+
         RealtimeMemoryStatistics getRealtimeMemoryStatistics()
         {
             const char* request = "/engine/realtime-memory/statistics";
@@ -1068,6 +1419,8 @@ namespace Methcla
                 RealtimeMemoryStatistics value;
                 value.freeNumBytes = args.int32();
                 value.usedNumBytes = args.int32();
+                value.freeListHits = args.int32();
+                value.freeListMisses = args.int32();
                 result.set(value);
             });
             return result.get();
@@ -1188,6 +1541,7 @@ namespace Methcla
         LogHandler              m_logHandler;
         NodeIdAllocator         m_nodeIds;
         AudioBusIdAllocator     m_audioBusIds;
+        ControlBusIdAllocator   m_controlBusIds;
         Methcla_RequestId       m_requestId;
         std::mutex              m_requestIdMutex;
         ResponseHandlers        m_responseHandlers;
@@ -46,6 +46,13 @@ typedef void (*Methcla_HostPerformFunction)(const Methcla_Host* host, void* data
 //* Callback function type for performing commands in the realtime context.
 typedef void (*Methcla_WorldPerformFunction)(const Methcla_World* world, void* data);
 
+//* Callback function type for handling an OSC request registered with Methcla_Host::register_command.
+//
+// tag_buffer and arg_buffer contain the type tags (without the leading comma) and the argument data of the request message. Returning an error code other than kMethcla_NoError sends an error reply to the client.
+//
+// Context: RT
+typedef Methcla_ErrorCode (*Methcla_CommandFunction)(const Methcla_World* world, void* data, const void* tag_buffer, size_t tag_size, const void* arg_buffer, size_t arg_size);
+
 //* Realtime interface
 struct Methcla_World
 {
@@ -159,6 +166,8 @@ typedef enum
 {
     kMethcla_PortFlags  = 0x0
   , kMethcla_Trigger    = 0x1
+    //* Control input is connected to a buffer of block size frames instead of a single value, so that it can be modulated at audio rate.
+  , kMethcla_AudioRate  = 0x2
 } Methcla_PortFlags;
 
 typedef struct Methcla_PortDescriptor Methcla_PortDescriptor;
@@ -174,6 +183,15 @@ typedef uint16_t Methcla_PortCount;
 
 typedef void Methcla_SynthOptions;
 
+typedef enum
+{
+    kMethcla_SynthDefFlags                      = 0x0
+    //* Silent audio inputs produce silent audio outputs.
+    //
+    // When all connected audio inputs of a synth are silent, the engine skips calling `process` and marks the synth's audio outputs as silent.
+  , kMethcla_SynthDefSilentInputSilentOutput    = 0x1
+} Methcla_SynthDefFlags;
+
 typedef struct Methcla_SynthDef Methcla_SynthDef;
 
 struct Methcla_SynthDef
@@ -197,6 +215,8 @@ struct Methcla_SynthDef
     void (*construct)(const Methcla_World* world, const Methcla_SynthDef* def, const Methcla_SynthOptions* options, Methcla_Synth* synth);
 
     //* Connect port at index to data.
+    //
+    // Audio ports may be reconnected between calls to `process`, e.g. to read from and write to bus memory directly or to buffers shared with other synths; plugins must not write to audio input buffers and must not expect audio buffers to keep their contents between calls to `process`. Audio ports are not connected before the first call to `process`.
     void (*connect)(Methcla_Synth* synth, Methcla_PortCount index, void* data);
 
     //* Activate the synth instance just before starting to call `process`.
@@ -207,6 +227,18 @@ struct Methcla_SynthDef
 
     //* Destroy a synth instance.
     void (*destroy)(const Methcla_World* world, Methcla_Synth* synth);
+
+    //* Synth definition flags.
+    Methcla_SynthDefFlags flags;
+
+    //* Return the tail length of a synth instance in seconds.
+    //
+    // The tail length is the time the audio outputs of a synth may remain non-silent after all of its audio inputs have become silent, e.g. the decay time of a reverb or the feedback time of a delay. Once all audio inputs have been silent for longer than the tail length, the engine marks the synth as done, which frees it or sends a notification according to its done flags.
+    //
+    // May be NULL if the synth doesn't have a finite tail.
+    //
+    // Context: RT
+    double (*tail_length)(const Methcla_World* world, const Methcla_Synth* synth);
 };
 
 struct Methcla_Host
@@ -243,6 +275,13 @@ struct Methcla_Host
 
     //* Log a message and a newline character.
     void (*log_line)(const Methcla_Host* host, Methcla_LogLevel level, const char* message);
+
+    //* Register a handler for requests with the OSC address `address`.
+    //
+    // Returns an error if the address is already handled by the engine or another plugin.
+    //
+    // Context: NRT, only while the plugin library is being loaded.
+    Methcla_Error (*register_command)(const Methcla_Host* host, const char* address, Methcla_CommandFunction perform, void* data);
 };
 
 static inline void methcla_host_register_synthdef(const Methcla_Host* host, const Methcla_SynthDef* synthDef)
@@ -302,6 +341,14 @@ static inline void methcla_host_log_line(const Methcla_Host* host, Methcla_LogLe
     host->log_line(host, level, message);
 }
 
+static inline Methcla_Error methcla_host_register_command(const Methcla_Host* host, const char* address, Methcla_CommandFunction perform, void* data)
+{
+    assert(host && host->register_command);
+    assert(address);
+    assert(perform);
+    return host->register_command(host, address, perform, data);
+}
+
 typedef struct Methcla_Library Methcla_Library;
 
 struct Methcla_Library
@@ -216,13 +216,34 @@ namespace Methcla { namespace Plugin {
             static inline void exec(const Methcla_World* context, Synth* synth)
                 { synth->cleanup(World<Synth>(context)); }
         };
+
+        typedef double (*TailLengthFunction)(const Methcla_World*, const Methcla_Synth*);
+
+        template <class Synth, bool Condition>
+        class IfSynthDefHasTailLength
+        {
+        public:
+            static inline TailLengthFunction function() { return nullptr; }
+        };
+
+        template <class Synth>
+        class IfSynthDefHasTailLength<Synth, true>
+        {
+            static double tailLength(const Methcla_World* context, const Methcla_Synth* synth)
+                { return static_cast<const Synth*>(synth)->tailLength(World<Synth>(context)); }
+
+        public:
+            static inline TailLengthFunction function() { return tailLength; }
+        };
     } // namespace detail
 
     enum SynthDefFlags
     {
         kSynthDefDefaultFlags = 0x00,
         kSynthDefHasActivate  = 0x01,
-        kSynthDefHasCleanup   = 0x02
+        kSynthDefHasCleanup   = 0x02,
+        kSynthDefSilentInputSilentOutput = 0x04,
+        kSynthDefHasTailLength = 0x08
     };
 
     template <class Synth, class Options, class PortDescriptor, SynthDefFlags Flags=kSynthDefDefaultFlags> class SynthDef
@@ -287,7 +308,14 @@ namespace Methcla { namespace Plugin {
                 connect,
                 activate,
                 process,
-                destroy
+                destroy,
+                (Flags & kSynthDefSilentInputSilentOutput) == kSynthDefSilentInputSilentOutput
+                    ? kMethcla_SynthDefSilentInputSilentOutput
+                    : kMethcla_SynthDefFlags,
+                detail::IfSynthDefHasTailLength<
+                    Synth,
+                    (Flags & kSynthDefHasTailLength) == kSynthDefHasTailLength
+                >::function()
             };
             methcla_host_register_synthdef(host, &kSynthDef);
         }
@@ -1063,7 +1063,9 @@ static const Methcla_SynthDef kDiskSamplerDef =
     disksampler_connect,
     nullptr,
     disksampler_process,
-    disksampler_destroy
+    disksampler_destroy,
+    kMethcla_SynthDefFlags,
+    nullptr
 };
 
 static const Methcla_Library kDiskSamplerLibrary = { nullptr, nullptr };
@@ -95,6 +95,8 @@ static const Methcla_SynthDef descriptor =
     connect,
     NULL,
     process,
+    NULL,
+    kMethcla_SynthDefSilentInputSilentOutput,
     NULL
 };
 
@@ -164,7 +166,7 @@ public:
     }
 };
 
-StaticSynthDef<Amplifier,AmplifierOptions,AmplifierPorts> kAmplifierDef;
+StaticSynthDef<Amplifier,AmplifierOptions,AmplifierPorts,kSynthDefSilentInputSilentOutput> kAmplifierDef;
 
 };
 
@@ -423,7 +423,9 @@ static const Methcla_SynthDef descriptor =
     connect,
     nullptr,
     process,
-    destroy
+    destroy,
+    kMethcla_SynthDefFlags,
+    nullptr
 };
 
 static const Methcla_Library library = { NULL, NULL };
@@ -38,7 +38,7 @@ typedef struct {
 } Sine;
 
 static const Methcla_PortDescriptor kPortDescriptors[] = {
-    { .type = kMethcla_ControlPort, .direction = kMethcla_Input, .flags = kMethcla_PortFlags },
+    { .type = kMethcla_ControlPort, .direction = kMethcla_Input, .flags = kMethcla_AudioRate },
     { .type = kMethcla_ControlPort, .direction = kMethcla_Input, .flags = kMethcla_PortFlags },
     { .type = kMethcla_AudioPort, .direction = kMethcla_Output, .flags = kMethcla_PortFlags }
 };
@@ -86,15 +86,16 @@ process(const Methcla_World* world, Methcla_Synth* synth, size_t numFrames)
 {
     Sine* sine = (Sine*)synth;
 
-    const float freq      = *sine->ports[kSine_freq];
-    const float amp       = *sine->ports[kSine_amp];
-    double phase          = sine->phase;
-    const double phaseInc = freq * sine->freqToPhaseInc;
-    float* const output   = sine->ports[kSine_out];
+    const float* const freq     = sine->ports[kSine_freq];
+    const float amp             = *sine->ports[kSine_amp];
+    double phase                = sine->phase;
+    const double freqToPhaseInc = sine->freqToPhaseInc;
+    float* const output         = sine->ports[kSine_out];
 
+    // Frequency is an audio rate input
     for (size_t k = 0; k < numFrames; k++) {
         output[k] = amp * sin(phase);
-        phase += phaseInc;
+        phase += freq[k] * freqToPhaseInc;
     }
 
     sine->phase = phase;
@@ -110,6 +111,8 @@ static const Methcla_SynthDef descriptor =
     connect,
     NULL,
     process,
+    NULL,
+    kMethcla_SynthDefFlags,
     NULL
 };
 
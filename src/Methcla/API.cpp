@@ -68,6 +68,11 @@ Methcla::Audio::Environment::Options Methcla::API::convertOptions(const Methcla_
     result.realtimeMemorySize = options->realtime_memory_size;
     result.maxNumNodes = options->max_num_nodes;
     result.maxNumAudioBuses = options->max_num_audio_buses;
+    result.maxNumControlBuses = options->max_num_control_buses;
+    result.numHelperThreads = options->num_helper_threads;
+    result.synthInstancePoolSize = options->synth_instance_pool_size;
+    result.numSynthScratchBuffers = options->num_synth_scratch_buffers;
+    result.maxNumNodeDestroysPerBlock = options->max_num_node_destroys_per_block;
 
     if (options->plugin_libraries != nullptr)
     {
@@ -105,7 +110,9 @@ public:
         m_driver->driver()->setProcessCallback(processCallback, this);
 
         engineOptions.sampleRate = m_driver->driver()->sampleRate();
-        engineOptions.blockSize = m_driver->driver()->bufferSize();
+        // The driver buffer is processed in blocks of block_size frames; default to the driver's buffer size.
+        if (engineOptions.blockSize == 0)
+            engineOptions.blockSize = m_driver->driver()->bufferSize();
         engineOptions.numHardwareInputChannels = m_driver->driver()->numInputs();
         engineOptions.numHardwareOutputChannels = m_driver->driver()->numOutputs();
 
@@ -322,6 +329,18 @@ METHCLA_EXPORT Methcla_Error methcla_engine_send(Methcla_Engine* engine, const v
     return methcla_no_error();
 }
 
+METHCLA_EXPORT Methcla_Error methcla_engine_send_commands(Methcla_Engine* engine, const Methcla_EngineCommand* commands, size_t numCommands)
+{
+    if (engine == nullptr)
+        return methcla_error_new(kMethcla_ArgumentError);
+    if (commands == nullptr && numCommands > 0)
+        return methcla_error_new(kMethcla_ArgumentError);
+    METHCLA_API_TRY {
+        engine->env()->sendCommands(commands, numCommands);
+    } METHCLA_API_CATCH;
+    return methcla_no_error();
+}
+
 METHCLA_EXPORT Methcla_Error methcla_engine_soundfile_open(const Methcla_Engine* engine, const char* path, Methcla_FileMode mode, Methcla_SoundFile** file, Methcla_SoundFileInfo* info)
 {
     if (engine == nullptr)
@@ -338,6 +357,16 @@ METHCLA_EXPORT Methcla_Error methcla_engine_soundfile_open(const Methcla_Engine*
     return methcla_host_soundfile_open(host, path, mode, file, info);
 }
 
+METHCLA_EXPORT Methcla_Error methcla_engine_load_statistics(const Methcla_Engine* engine, Methcla_EngineLoadStatistics* statistics)
+{
+    if (engine == nullptr)
+        return methcla_error_new(kMethcla_ArgumentError);
+    if (statistics == nullptr)
+        return methcla_error_new(kMethcla_ArgumentError);
+    *statistics = engine->env()->loadStatistics();
+    return methcla_no_error();
+}
+
 METHCLA_EXPORT const char* methcla_error_code_description(Methcla_ErrorCode code)
 {
     switch (code)
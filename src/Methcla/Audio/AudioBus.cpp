@@ -15,12 +15,20 @@
 #include "Methcla/Audio/AudioBus.hpp"
 #include "Methcla/Audio/Engine.hpp"
 
+#include <algorithm>
+#include <new>
+
 using namespace Methcla::Audio;
 using namespace Methcla::Memory;
 
 AudioBus::AudioBus(sample_t* data, Epoch epoch)
     : m_epoch(epoch)
+    , m_silent(false)
     , m_data(data)
+    , m_scheduleStamp(0)
+    , m_scheduleReadLevel(0)
+    , m_scheduleWriteLevel(0)
+    , m_scheduleChunk(0)
 {
 }
 
@@ -33,13 +41,59 @@ ExternalAudioBus::ExternalAudioBus(Epoch epoch)
 {
 }
 
-InternalAudioBus::InternalAudioBus(size_t numFrames, Epoch epoch)
-    : AudioBus( allocAlignedOf<sample_t>(kSIMDAlignment, numFrames)
-              , epoch )
+// Granularity of committing arena memory; touching a smaller unit than the actual page size only causes redundant work.
+static const size_t kPageSize = 4096;
+
+// Number of frames of a bus data slot, rounded up to a multiple of the cache line size.
+static size_t strideOf(size_t blockSize)
+{
+    const size_t lineSize = kCacheLineAlignment / sizeof(sample_t);
+    return (blockSize + lineSize - 1) / lineSize * lineSize;
+}
+
+AudioBusArena::AudioBusArena(size_t numBuses, size_t blockSize, Epoch epoch)
+    : m_numBuses(numBuses)
+    , m_stride(strideOf(blockSize))
+    , m_buses(nullptr)
+    , m_data(nullptr)
+    , m_numPrepared(0)
+{
+    if (numBuses > 0)
+    {
+        m_buses = allocAlignedOf<AudioBus>(kCacheLineAlignment, numBuses);
+        m_data = allocAlignedOf<sample_t>(kCacheLineAlignment, numBuses * m_stride);
+        for (size_t i=0; i < numBuses; i++)
+        {
+            new (m_buses + i) AudioBus(m_data + i * m_stride, epoch);
+        }
+    }
+}
+
+AudioBusArena::~AudioBusArena()
 {
+    for (size_t i=0; i < m_numBuses; i++)
+    {
+        m_buses[i].~AudioBus();
+    }
+    Methcla::Memory::freeAligned(m_buses);
+    Methcla::Memory::freeAligned(m_data);
 }
 
-InternalAudioBus::~InternalAudioBus()
+void AudioBusArena::prepare(size_t numBuses)
 {
-    Methcla::Memory::freeAligned(data());
+    numBuses = std::min(numBuses, m_numBuses);
+    const size_t numPrepared = m_numPrepared.load(std::memory_order_relaxed);
+    if (numBuses > numPrepared)
+    {
+        char* const begin = reinterpret_cast<char*>(m_data + numPrepared * m_stride);
+        char* const end = reinterpret_cast<char*>(m_data + numBuses * m_stride);
+        // Write to each page without changing its contents; volatile keeps the compiler from dropping the writes.
+        for (volatile char* page = begin; page < end; page += kPageSize)
+        {
+            *page = *page;
+        }
+        volatile char* const last = end - 1;
+        *last = *last;
+        m_numPrepared.store(numBuses, std::memory_order_release);
+    }
 }
@@ -17,38 +17,28 @@
 
 #include "Methcla/Audio.hpp"
 
+#include <atomic>
+#include <cassert>
 #include <boost/serialization/strong_typedef.hpp>
 
 namespace Methcla { namespace Audio {
 
 BOOST_STRONG_TYPEDEF(uint32_t, AudioBusId);
 
+class ExecutionPlan;
+
 class AudioBus
 {
 public:
-    // class Lock
-    // {
-    // public:
-    //     void lock() { }
-    //     void try_lock() { }
-    //     void unlock() { }
-    //
-    //     void lock_shared() { }
-    //     bool try_lock_shared() { return true; }
-    //     void unlock_shared() { }
-    // };
-
     // typedef boost::intrusive_ptr<AudioBus> Handle;
 
 public:
     AudioBus(sample_t* data, Epoch epoch);
-    virtual ~AudioBus();
+    ~AudioBus();
 
     AudioBus(const AudioBus&) = delete;
     AudioBus& operator=(const AudioBus&) = delete;
 
-    // Lock& lock() { return m_lock; }
-
     const Epoch& epoch() const
     {
         return m_epoch;
@@ -59,6 +49,25 @@ public:
         m_epoch = epoch;
     }
 
+    //* Return true if the last write to the bus was silent.
+    //
+    // The data of a silent bus is stale and must be read as zeros.
+    bool isSilent() const
+    {
+        return m_silent;
+    }
+
+    //* Return true if the bus has been written to in `epoch` and is silent.
+    bool isSilent(const Epoch& epoch) const
+    {
+        return m_epoch == epoch && m_silent;
+    }
+
+    void setSilent(bool silent)
+    {
+        m_silent = silent;
+    }
+
     sample_t* data()
     {
         return m_data;
@@ -71,9 +80,17 @@ protected:
     }
 
 private:
-    // Lock        m_lock;
+    friend class ExecutionPlan;
+
     Epoch       m_epoch;
+    bool        m_silent;
     sample_t*   m_data;
+
+    // Dependency analysis state (see ExecutionPlan)
+    uint32_t    m_scheduleStamp;
+    uint32_t    m_scheduleReadLevel;
+    uint32_t    m_scheduleWriteLevel;
+    uint32_t    m_scheduleChunk;
 };
 
 class ExternalAudioBus : public AudioBus
@@ -86,11 +103,57 @@ public:
     }
 };
 
-class InternalAudioBus : public AudioBus
+//* Storage for the internal audio buses.
+//
+// Bus headers are kept in a contiguous array, so that checking the epochs of the buses a synth is mapped to doesn't touch their data. Bus data is allocated as a single block with a cache line aligned slot per bus. The block is only reserved when the arena is created; its memory is committed ahead of time by `prepare` before the buses are handed out to the audio thread.
+class AudioBusArena
 {
 public:
-    InternalAudioBus(size_t numFrames, Epoch epoch);
-    virtual ~InternalAudioBus();
+    //* Create an arena for `numBuses` buses of `blockSize` frames.
+    AudioBusArena(size_t numBuses, size_t blockSize, Epoch epoch);
+    ~AudioBusArena();
+
+    AudioBusArena(const AudioBusArena&) = delete;
+    AudioBusArena& operator=(const AudioBusArena&) = delete;
+
+    //* Return number of buses.
+    size_t size() const
+    {
+        return m_numBuses;
+    }
+
+    //* Return distance in samples between the data of buses with consecutive ids.
+    size_t stride() const
+    {
+        return m_stride;
+    }
+
+    //* Return bus with `id`.
+    AudioBus* bus(AudioBusId id)
+    {
+        assert( id < m_numBuses );
+        return m_buses + id;
+    }
+
+    //* Return number of buses whose memory has been prepared.
+    size_t numPrepared() const
+    {
+        return m_numPrepared.load(std::memory_order_acquire);
+    }
+
+    //* Commit the memory of buses with an id less than `numBuses`.
+    //
+    // Only the memory of buses that haven't been prepared yet is accessed; these buses must not be used by other threads until `numPrepared` has been updated. Calls must be serialized.
+    //
+    // Context: NRT
+    void prepare(size_t numBuses);
+
+private:
+    const size_t        m_numBuses;
+    const size_t        m_stride;
+    AudioBus*           m_buses;
+    sample_t*           m_data;
+    std::atomic<size_t> m_numPrepared;
 };
 
 } }
@@ -0,0 +1,149 @@
+// Copyright 2012-2014 Samplecount S.L.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Methcla/Audio/CommandTable.hpp"
+
+#include <cassert>
+#include <cstring>
+
+using namespace Methcla::Audio;
+
+// FNV-1a hash of a null-terminated string.
+static uint32_t hashAddress(const char* address)
+{
+    uint32_t hash = 2166136261u;
+    for (const char* it = address; *it != '\0'; it++)
+    {
+        hash ^= static_cast<uint8_t>(*it);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static const struct { const char* address; CommandId id; const char* signature; } kBuiltinCommands[] = {
+    { "/group/new",                            kCommand_GroupNew,                       "iii" },
+    { "/pargroup/new",                         kCommand_ParGroupNew,                    "iii" },
+    { "/group/freeAll",                        kCommand_GroupFreeAll,                   "i" },
+    { "/synth/new",                            kCommand_SynthNew,                       "diii*" },
+    { "/synth/new/batch",                      kCommand_SynthNewBatch,                  "dii*" },
+    { "/synth/activate",                       kCommand_SynthActivate,                  "i" },
+    { "/synth/map/input",                      kCommand_SynthMapInput,                  "iiii" },
+    { "/synth/map/output",                     kCommand_SynthMapOutput,                 "iiii" },
+    { "/synth/map/inputs",                     kCommand_SynthMapInputs,                 "iiiii" },
+    { "/synth/map/outputs",                    kCommand_SynthMapOutputs,                "iiiii" },
+    { "/synth/map/control/input",              kCommand_SynthMapControlInput,           "iii" },
+    { "/synth/map/control/output",             kCommand_SynthMapControlOutput,          "iii" },
+    { "/synth/map/control/input/audio",        kCommand_SynthMapControlInputAudio,      "iiii" },
+    { "/bus/control/set",                      kCommand_BusControlSet,                  "if" },
+    { "/synth/property/doneFlags/set",         kCommand_SynthPropertyDoneFlagsSet,      "ii" },
+    { "/node/free",                            kCommand_NodeFree,                       "i" },
+    { "/node/run",                             kCommand_NodeRun,                        "ii" },
+    { "/node/set",                             kCommand_NodeSet,                        "iif" },
+    { "/node/tree/statistics",                 kCommand_NodeTreeStatistics,             "i" },
+    { "/node/profile",                         kCommand_NodeProfile,                    "ii" },
+    { "/synthdef/profile",                     kCommand_SynthDefProfile,                "i" },
+    { "/engine/realtime-memory/statistics",    kCommand_EngineRealtimeMemoryStatistics, "i" },
+    { "/engine/load/statistics",               kCommand_EngineLoadStatistics,           "i" },
+};
+
+// Keep the load factor at or below one half so that probe sequences stay short.
+static const size_t kInitialCapacity = 64;
+
+CommandTable::CommandTable()
+    : m_entries(kInitialCapacity)
+    , m_size(0)
+{
+    for (const auto& command : kBuiltinCommands)
+    {
+        Entry entry;
+        entry.address = command.address;
+        entry.hash = hashAddress(command.address);
+        entry.id = command.id;
+        entry.signature = command.signature;
+        entry.perform = nullptr;
+        entry.data = nullptr;
+        const bool inserted = insert(entry);
+        assert(inserted);
+        (void)inserted;
+    }
+}
+
+bool CommandTable::insert(const char* address, Methcla_CommandFunction perform, void* data)
+{
+    assert(address && perform);
+
+    if (lookup(address) != nullptr)
+        return false;
+
+    m_addresses.push_back(address);
+
+    Entry entry;
+    entry.address = m_addresses.back().c_str();
+    entry.hash = hashAddress(entry.address);
+    entry.id = kCommand_Plugin;
+    entry.signature = "*";
+    entry.perform = perform;
+    entry.data = data;
+
+    return insert(entry);
+}
+
+const CommandTable::Entry* CommandTable::lookup(const char* address) const
+{
+    const uint32_t hash = hashAddress(address);
+    const size_t mask = m_entries.size() - 1;
+
+    for (size_t i = hash & mask; m_entries[i].address != nullptr; i = (i + 1) & mask)
+    {
+        const Entry& entry = m_entries[i];
+        if (entry.hash == hash && std::strcmp(entry.address, address) == 0)
+            return &entry;
+    }
+
+    return nullptr;
+}
+
+bool CommandTable::insert(const Entry& entry)
+{
+    if (2 * (m_size + 1) > m_entries.size())
+        grow();
+
+    const size_t mask = m_entries.size() - 1;
+    size_t i = entry.hash & mask;
+
+    while (m_entries[i].address != nullptr)
+    {
+        if (m_entries[i].hash == entry.hash && std::strcmp(m_entries[i].address, entry.address) == 0)
+            return false;
+        i = (i + 1) & mask;
+    }
+
+    m_entries[i] = entry;
+    m_size++;
+
+    return true;
+}
+
+void CommandTable::grow()
+{
+    std::vector<Entry> entries(2 * m_entries.size());
+    entries.swap(m_entries);
+    m_size = 0;
+
+    for (const auto& entry : entries)
+    {
+        if (entry.address != nullptr)
+            insert(entry);
+    }
+}
@@ -0,0 +1,109 @@
+// Copyright 2012-2014 Samplecount S.L.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef METHCLA_AUDIO_COMMANDTABLE_HPP_INCLUDED
+#define METHCLA_AUDIO_COMMANDTABLE_HPP_INCLUDED
+
+#include <methcla/plugin.h>
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <vector>
+
+namespace Methcla { namespace Audio {
+
+//* Identifiers of the request commands handled by the engine.
+enum CommandId
+{
+    kCommand_GroupNew,
+    kCommand_ParGroupNew,
+    kCommand_GroupFreeAll,
+    kCommand_SynthNew,
+    kCommand_SynthNewBatch,
+    kCommand_SynthActivate,
+    kCommand_SynthMapInput,
+    kCommand_SynthMapOutput,
+    kCommand_SynthMapInputs,
+    kCommand_SynthMapOutputs,
+    kCommand_SynthMapControlInput,
+    kCommand_SynthMapControlOutput,
+    kCommand_SynthMapControlInputAudio,
+    kCommand_BusControlSet,
+    kCommand_SynthPropertyDoneFlagsSet,
+    kCommand_NodeFree,
+    kCommand_NodeRun,
+    kCommand_NodeSet,
+    kCommand_NodeTreeStatistics,
+    kCommand_NodeProfile,
+    kCommand_SynthDefProfile,
+    kCommand_EngineRealtimeMemoryStatistics,
+    kCommand_EngineLoadStatistics,
+    //* Command registered by a plugin.
+    kCommand_Plugin
+};
+
+//* Map OSC request addresses to command handlers.
+//
+// Addresses are interned in an open addressing hash table when the engine is set up, so that dispatching a request in the realtime thread costs one hash computation and, in the common case, a single string comparison.
+class CommandTable
+{
+public:
+    struct Entry
+    {
+        const char*             address;
+        uint32_t                hash;
+        CommandId               id;
+        //* Argument types: 'i' int32, 'f' float32, 'd' synth definition name; '*' passes the remaining arguments on unparsed.
+        const char*             signature;
+        Methcla_CommandFunction perform;
+        void*                   data;
+    };
+
+    //* Construct a table containing the engine's builtin commands.
+    CommandTable();
+
+    CommandTable(const CommandTable&) = delete;
+    CommandTable& operator=(const CommandTable&) = delete;
+
+    //* Register a plugin command handler for address.
+    //
+    // Returns false if the address is already registered.
+    //
+    // Context: NRT
+    bool insert(const char* address, Methcla_CommandFunction perform, void* data);
+
+    //* Return the entry registered for address or nullptr if there is none.
+    //
+    // Context: RT
+    const Entry* lookup(const char* address) const;
+
+    //* Return the number of registered addresses.
+    size_t size() const
+    {
+        return m_size;
+    }
+
+private:
+    bool insert(const Entry& entry);
+    void grow();
+
+    std::vector<Entry>      m_entries;
+    size_t                  m_size;
+    std::list<std::string>  m_addresses;
+};
+
+} }
+
+#endif // METHCLA_AUDIO_COMMANDTABLE_HPP_INCLUDED
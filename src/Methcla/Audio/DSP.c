@@ -1,8 +1,135 @@
+// Copyright 2012-2013 Samplecount S.L.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
 #include "Methcla/Audio/DSP.h"
 
-void accumulate(float* restrict a, const float* restrict b, int n)
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# define METHCLA_DSP_SSE2 1
+# include <emmintrin.h>
+#endif
+
+// AVX2 kernels are compiled with a function level target attribute and only selected when the CPU supports them.
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)) \
+    && (defined(__clang__) || (__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+# define METHCLA_DSP_AVX2 1
+# include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+# define METHCLA_DSP_NEON 1
+# include <arm_neon.h>
+#endif
+
+static void accumulate_scalar(float* restrict dst, const float* restrict src, size_t n)
+{
+    for (size_t i=0; i < n; i++) {
+        dst[i] += src[i];
+    }
+}
+
+#if METHCLA_DSP_SSE2
+static void accumulate_sse2(float* restrict dst, const float* restrict src, size_t n)
 {
-    for (int i=0; i < n; i++) {
-        a[i] += b[i];
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128 a0 = _mm_loadu_ps(dst + i);
+        __m128 a1 = _mm_loadu_ps(dst + i + 4);
+        a0 = _mm_add_ps(a0, _mm_loadu_ps(src + i));
+        a1 = _mm_add_ps(a1, _mm_loadu_ps(src + i + 4));
+        _mm_storeu_ps(dst + i, a0);
+        _mm_storeu_ps(dst + i + 4, a1);
     }
+    accumulate_scalar(dst + i, src + i, n - i);
+}
+#endif
+
+#if METHCLA_DSP_AVX2
+__attribute__((target("avx2")))
+static void accumulate_avx2(float* restrict dst, const float* restrict src, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 a0 = _mm256_loadu_ps(dst + i);
+        __m256 a1 = _mm256_loadu_ps(dst + i + 8);
+        a0 = _mm256_add_ps(a0, _mm256_loadu_ps(src + i));
+        a1 = _mm256_add_ps(a1, _mm256_loadu_ps(src + i + 8));
+        _mm256_storeu_ps(dst + i, a0);
+        _mm256_storeu_ps(dst + i + 8, a1);
+    }
+    accumulate_scalar(dst + i, src + i, n - i);
+}
+#endif
+
+#if METHCLA_DSP_NEON
+static void accumulate_neon(float* restrict dst, const float* restrict src, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        float32x4_t a0 = vld1q_f32(dst + i);
+        float32x4_t a1 = vld1q_f32(dst + i + 4);
+        a0 = vaddq_f32(a0, vld1q_f32(src + i));
+        a1 = vaddq_f32(a1, vld1q_f32(src + i + 4));
+        vst1q_f32(dst + i, a0);
+        vst1q_f32(dst + i + 4, a1);
+    }
+    accumulate_scalar(dst + i, src + i, n - i);
+}
+#endif
+
+typedef void (*AccumulateFunc)(float* restrict, const float* restrict, size_t);
+
+#if METHCLA_DSP_NEON
+static AccumulateFunc s_accumulate = accumulate_neon;
+static const char* s_isa = "neon";
+#elif METHCLA_DSP_SSE2
+static AccumulateFunc s_accumulate = accumulate_sse2;
+static const char* s_isa = "sse2";
+#else
+static AccumulateFunc s_accumulate = accumulate_scalar;
+static const char* s_isa = "scalar";
+#endif
+
+void methcla_dsp_init(void)
+{
+#if METHCLA_DSP_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        s_accumulate = accumulate_avx2;
+        s_isa = "avx2";
+    }
+#endif
+}
+
+const char* methcla_dsp_isa(void)
+{
+    return s_isa;
+}
+
+// The C library's memcpy and memset already select vectorised implementations for the CPU at load time.
+void methcla_dsp_copy(float* dst, const float* src, size_t n)
+{
+    memcpy(dst, src, n * sizeof(float));
+}
+
+void methcla_dsp_zero(float* dst, size_t n)
+{
+    memset(dst, 0, n * sizeof(float));
+}
+
+void methcla_dsp_accumulate(float* dst, const float* src, size_t n)
+{
+    s_accumulate(dst, src, n);
 }
@@ -17,6 +17,25 @@
 
 #include <methcla/common.h>
 
-METHCLA_C_LINKAGE void accumulate(float* a, const float* b, int n);
+#include <stddef.h>
+
+//* Select the fastest kernels supported by the CPU.
+//
+// Safe to call more than once; kernels fall back to portable implementations until called.
+//
+// Context: NRT
+METHCLA_C_LINKAGE void methcla_dsp_init(void);
+
+//* Return the name of the instruction set used by the kernels ("avx2", "sse2", "neon" or "scalar").
+METHCLA_C_LINKAGE const char* methcla_dsp_isa(void);
+
+//* Copy n samples from src to dst; the buffers must not overlap.
+METHCLA_C_LINKAGE void methcla_dsp_copy(float* dst, const float* src, size_t n);
+
+//* Set n samples in dst to zero.
+METHCLA_C_LINKAGE void methcla_dsp_zero(float* dst, size_t n);
+
+//* Add n samples from src to dst; the buffers must not overlap.
+METHCLA_C_LINKAGE void methcla_dsp_accumulate(float* dst, const float* src, size_t n);
 
 #endif // METHCLA_AUDIO_DSP_H_INCLUDED
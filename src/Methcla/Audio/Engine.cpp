@@ -58,6 +58,20 @@ METHCLA_C_LINKAGE void methcla_api_host_register_soundfile_api(const Methcla_Hos
     static_cast<Environment*>(host->handle)->registerSoundFileAPI(api);
 }
 
+METHCLA_C_LINKAGE Methcla_Error methcla_api_host_register_command(const Methcla_Host* host, const char* address, Methcla_CommandFunction perform, void* data)
+{
+    assert(host && host->handle);
+    assert(address && perform);
+    if (!static_cast<Environment*>(host->handle)->registerCommand(address, perform, data))
+    {
+        return methcla_error_new_with_message(
+            kMethcla_ArgumentError,
+            "Command address already registered"
+        );
+    }
+    return methcla_no_error();
+}
+
 METHCLA_C_LINKAGE void* methcla_api_host_alloc(const Methcla_Host*, size_t size)
 {
     try {
@@ -229,10 +243,11 @@ METHCLA_C_LINKAGE void methcla_api_world_log_line(const Methcla_World* world, Me
     static_cast<Environment*>(world->handle)->logLineRT(level, message);
 }
 
-METHCLA_C_LINKAGE void methcla_api_world_synth_done(const Methcla_World*, Methcla_Synth* synth)
+METHCLA_C_LINKAGE void methcla_api_world_synth_done(const Methcla_World* world, Methcla_Synth* synth)
 {
+    assert(world && world->handle);
     assert(synth != nullptr);
-    Synth::fromSynth(synth)->setDone();
+    static_cast<Environment*>(world->handle)->synthDone(Synth::fromSynth(synth));
 }
 }
 
@@ -263,7 +278,8 @@ Environment::Environment(
         methcla_api_host_soundfile_open,
         methcla_api_host_perform_command,
         methcla_api_host_notify,
-        methcla_api_host_log_line
+        methcla_api_host_log_line,
+        methcla_api_host_register_command
     };
 
     // Initialize Methcla_World interface
@@ -312,14 +328,34 @@ Environment::operator const Methcla_World* () const
     return &m_world;
 }
 
+size_t Environment::numSynthScratchBuffers() const
+{
+    return m_impl->m_numSynthScratchBuffers;
+}
+
 size_t Environment::numAudioBuses() const
 {
-    return m_impl->m_internalAudioBuses.size();
+    return m_impl->m_audioBuses.size();
 }
 
 AudioBus* Environment::audioBus(AudioBusId id)
 {
-    return m_impl->m_internalAudioBuses.at(id).get();
+    return m_impl->audioBus(id);
+}
+
+size_t Environment::audioBusStride() const
+{
+    return m_impl->m_audioBuses.stride();
+}
+
+size_t Environment::numControlBuses() const
+{
+    return m_impl->m_controlBuses.size();
+}
+
+sample_t* Environment::controlBus(ControlBusId id)
+{
+    return &m_impl->m_controlBuses.at(id);
 }
 
 size_t Environment::numExternalAudioOutputs() const
@@ -357,9 +393,24 @@ Methcla_Time Environment::currentTime() const
     return m_impl->currentTime();
 }
 
+Methcla_EngineLoadStatistics Environment::loadStatistics() const
+{
+    return m_impl->m_loadMeter.statistics();
+}
+
 void Environment::send(const void* packet, size_t size)
 {
-    m_impl->m_requests->send(new Request(this, packet, size));
+    std::unique_ptr<Request> request(new Request(this, packet, size));
+    m_impl->decodeRequest(request.get());
+    // Buses are prepared before the request is queued, so that the audio thread only accesses memory that has been committed.
+    m_impl->prepareAudioBuses(request->numAudioBuses());
+    m_impl->m_requests->send(request.get());
+    request.release();
+}
+
+void Environment::sendCommands(const Methcla_EngineCommand* commands, size_t numCommands)
+{
+    m_impl->sendCommands(commands, numCommands);
 }
 
 bool Environment::hasPendingCommands() const
@@ -377,9 +428,18 @@ void Environment::sendFromWorker(PerformFunc f, void* data)
     m_impl->sendFromWorker(f, data);
 }
 
+void Environment::invalidateExecutionPlan()
+{
+    m_impl->m_plan.invalidate();
+}
+
+void Environment::synthDone(Synth* synth)
+{
+    m_impl->synthDone(synth);
+}
+
 void Environment::process(Methcla_Time currentTime, size_t numFrames, const sample_t* const* inputs, sample_t* const* outputs)
 {
-    assert( numFrames <= blockSize() );
     m_impl->process(currentTime, numFrames, inputs, outputs);
 }
 
@@ -408,6 +468,11 @@ void Environment::nodeEnded(NodeId nodeId)
     m_impl->nodeEnded(nodeId);
 }
 
+void Environment::destroyLater(Node* node)
+{
+    m_impl->destroyLater(node);
+}
+
 void Environment::reply(Methcla_RequestId requestId, const void* packet, size_t size)
 {
     m_impl->reply(requestId, packet, size);
@@ -443,6 +508,11 @@ const Memory::shared_ptr<SynthDef>& Environment::synthDef(const char* uri) const
     return m_impl->synthDef(uri);
 }
 
+bool Environment::registerCommand(const char* address, Methcla_CommandFunction perform, void* data)
+{
+    return m_impl->registerCommand(address, perform, data);
+}
+
 void Environment::registerSoundFileAPI(const Methcla_SoundFileAPI* api)
 {
     m_impl->m_soundFileAPIs.push_front(api);
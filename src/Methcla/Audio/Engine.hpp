@@ -42,6 +42,7 @@ namespace Methcla { namespace Audio
     typedef void (*PerformFunc)(Environment* env, void* data);
 
     class Group;
+    class Synth;
 
     typedef std::function<void (Methcla_LogLevel, const char*)> LogHandler;
     typedef std::function<void (Methcla_RequestId, const void*, size_t)> PacketHandler;
@@ -50,6 +51,8 @@ namespace Methcla { namespace Audio
 
     class EnvironmentImpl;
 
+    BOOST_STRONG_TYPEDEF(uint32_t, ControlBusId);
+
     class Environment
     {
     public:
@@ -70,6 +73,10 @@ namespace Methcla { namespace Audio
             size_t blockSize = 64;
             size_t numHardwareInputChannels = 2;
             size_t numHardwareOutputChannels = 2;
+            size_t numHelperThreads = 0;
+            size_t synthInstancePoolSize = 8;
+            size_t numSynthScratchBuffers = 16;
+            size_t maxNumNodeDestroysPerBlock = 64;
             std::list<Methcla_LibraryFunction> pluginLibraries;
             Methcla_LogLevel logLevel = kMethcla_LogWarn;
         };
@@ -112,6 +119,9 @@ namespace Methcla { namespace Audio
         double sampleRate() const { return m_sampleRate; }
         size_t blockSize() const { return m_blockSize; }
 
+        //* Return number of scratch buffers shared by synths for staging audio ports (0 if synths use their own buffers).
+        size_t numSynthScratchBuffers() const;
+
         //* Return number of external audio outputs.
         size_t numExternalAudioOutputs() const;
         //* Return number of external audio inputs.
@@ -128,15 +138,41 @@ namespace Methcla { namespace Audio
         //* Return audio bus with id (needed by Synth).
         AudioBus* audioBus(AudioBusId id);
 
+        //* Return distance in samples between the data of audio buses with consecutive ids.
+        size_t audioBusStride() const;
+
+        //* Return number of control buses.
+        size_t numControlBuses() const;
+
+        //* Return pointer to the value of the control bus with id.
+        //
+        // Control bus storage is allocated when the environment is created and never moves, so that synth control ports can be connected to it directly.
+        sample_t* controlBus(ControlBusId id);
+
         Memory::RTMemoryManager& rtMem();
 
         Epoch epoch() const;
 
         Methcla_Time currentTime() const;
 
+        //* Return the DSP load statistics of the audio callback.
+        //
+        // Context: RT, NRT
+        Methcla_EngineLoadStatistics loadStatistics() const;
+
         //* Send an OSC request to the engine.
+        //
+        // The request is decoded and its arguments are checked before it is queued. Errors that don't depend on the state of the node tree are reported by throwing, in which case no part of the request is executed.
+        //
+        // @throw Methcla::Error
         void send(const void* packet, size_t size);
 
+        //* Send binary commands to the engine.
+        //
+        // @throw Methcla::Error
+        // @throw std::runtime_error
+        void sendCommands(const Methcla_EngineCommand* commands, size_t numCommands);
+
         //* Return true if there are any pending scheduled commands.
         bool hasPendingCommands() const;
 
@@ -146,6 +182,13 @@ namespace Methcla { namespace Audio
         //* Lookup SynthDef
         const Memory::shared_ptr<SynthDef>& synthDef(const char* uri) const;
 
+        //* Register a plugin command handler for OSC requests with `address`.
+        //
+        // Returns false if the address is already registered.
+        //
+        // Context: NRT
+        bool registerCommand(const char* address, Methcla_CommandFunction perform, void* data);
+
         //* Sound file API registration
         void registerSoundFileAPI(const Methcla_SoundFileAPI* api);
 
@@ -162,6 +205,21 @@ namespace Methcla { namespace Audio
         // Context: NRT
         void sendFromWorker(PerformFunc f, void* data);
 
+        //* Mark the execution plan as out of date after a change to the node tree, to the done flags of a node or to the bus mappings of a synth.
+        //
+        // Context: RT
+        void invalidateExecutionPlan();
+
+        //* Flag a synth as done and perform its done actions.
+        //
+        // Context: RT
+        void synthDone(Synth* synth);
+
+        //* Process numFrames frames of audio starting at currentTime.
+        //
+        // numFrames can be any number of frames; buffers larger than the block size are processed as several blocks of at most blockSize() frames.
+        //
+        // Context: RT
         void process(
             Methcla_Time currentTime,
             size_t numFrames,
@@ -191,6 +249,7 @@ namespace Methcla { namespace Audio
 
     private:
         friend class Node;
+        friend class Group;
 
         //* Notify the client that a node has been flagged as 'done'.
         //
@@ -202,6 +261,11 @@ namespace Methcla { namespace Audio
         // Context: RT
         void nodeEnded(NodeId nodeId);
 
+        //* Queue an unlinked node for deferred destruction.
+        //
+        // Context: RT
+        void destroyLater(Node* node);
+
     private:
         EnvironmentImpl*    m_impl;
         const double        m_sampleRate;
@@ -15,6 +15,7 @@
 #include "Methcla/Audio/EngineImpl.hpp"
 #include "Methcla/Audio/Engine.hpp"
 #include "Methcla/Audio/Group.hpp"
+#include "Methcla/Audio/ParGroup.hpp"
 #include "Methcla/Audio/Synth.hpp"
 #include "Methcla/Exception.hpp"
 #include "Methcla/Memory.hpp"
@@ -29,6 +30,8 @@
 #include <oscpp/print.hpp>
 #include <oscpp/util.hpp>
 
+#include <algorithm>
+
 using namespace Methcla;
 using namespace Methcla::Audio;
 using namespace Methcla::Memory;
@@ -60,19 +63,9 @@ template <> const char* nodeTypeName<Synth>()
     return "synth";
 }
 
-static inline bool isValidNodeId(const std::vector<Node*>& nodes, NodeId nodeId)
-{
-    return nodeId >= 0 && (size_t)nodeId < nodes.size();
-}
-
-static inline bool isUsedNodeId(const std::vector<Node*>& nodes, NodeId nodeId)
-{
-    return isValidNodeId(nodes, nodeId) && nodes[nodeId] != nullptr;
-}
-
-static inline void checkNodeIdIsValid(const std::vector<Node*>& nodes, NodeId nodeId)
+static inline void checkNodeIdIsValid(NodeId nodeId)
 {
-    if (!isValidNodeId(nodes, nodeId))
+    if (!NodeMap::isValid(nodeId))
     {
         throwErrorWith(kMethcla_NodeIdError, [&](std::stringstream& s) {
             s << "Node id " << nodeId << " out of range";
@@ -80,11 +73,11 @@ static inline void checkNodeIdIsValid(const std::vector<Node*>& nodes, NodeId no
     }
 }
 
-static inline void checkNodeIdIsFree(const std::vector<Node*>& nodes, NodeId nodeId)
+static inline void checkNodeIdIsFree(const NodeMap& nodes, NodeId nodeId)
 {
-    checkNodeIdIsValid(nodes, nodeId);
+    checkNodeIdIsValid(nodeId);
 
-    if (nodes[nodeId] != nullptr)
+    if (nodes.lookup(nodeId) != nullptr)
     {
         throwErrorWith(kMethcla_NodeIdError, [&](std::stringstream& s) {
             s << "Node id " << nodeId << " already in use";
@@ -92,18 +85,36 @@ static inline void checkNodeIdIsFree(const std::vector<Node*>& nodes, NodeId nod
     }
 }
 
-static inline void addNode(std::vector<Node*>& nodes, Node* node)
+// Check that a node with id nodeId can be added before constructing it.
+static inline void checkCanAddNode(const NodeMap& nodes, size_t maxNumNodes, NodeId nodeId)
 {
-    NodeId nodeId(node->id());
     checkNodeIdIsFree(nodes, nodeId);
-    nodes[nodeId] = node;
+
+    if (nodes.size() >= maxNumNodes)
+    {
+        throwErrorWith(kMethcla_MemoryError, [&](std::stringstream& s) {
+            s << "Maximum number of nodes (" << maxNumNodes << ") exceeded";
+        });
+    }
+
+    if (!nodes.canInsert(nodeId))
+    {
+        throwErrorWith(kMethcla_MemoryError, [&](std::stringstream& s) {
+            s << "Node table exhausted, cannot add node " << nodeId << " before the next block";
+        });
+    }
+}
+
+static inline void addNode(NodeMap& nodes, Node* node)
+{
+    nodes.insert(node->id(), node);
 }
 
-static inline Node* lookupNode(std::vector<Node*>& nodes, const char* prefix, NodeId nodeId)
+static inline Node* lookupNode(const NodeMap& nodes, const char* prefix, NodeId nodeId)
 {
-    checkNodeIdIsValid(nodes, nodeId);
+    checkNodeIdIsValid(nodeId);
 
-    Node* node = nodes[nodeId];
+    Node* node = nodes.lookup(nodeId);
 
     if (node == nullptr)
     {
@@ -115,7 +126,7 @@ static inline Node* lookupNode(std::vector<Node*>& nodes, const char* prefix, No
     return node;
 }
 
-template <class T> T* lookupNodeAs(std::vector<Node*>& nodes, const char* prefix, NodeId nodeId)
+template <class T> T* lookupNodeAs(const NodeMap& nodes, const char* prefix, NodeId nodeId)
 {
     Node* node = lookupNode(nodes, prefix, nodeId);
 
@@ -204,15 +215,31 @@ EnvironmentImpl::EnvironmentImpl(
     , m_requests(messageQueue == nullptr ? new Utility::MessageQueue<Request*>(kQueueSize) : messageQueue)
     , m_worker(worker ? worker : new Utility::WorkerThread<Environment::Command>(kQueueSize, kNumWorkerThreads))
     , m_scheduler(options.mode == Environment::kRealtimeMode ? kQueueSize : 0)
+    , m_commandRing(kCommandRingSize)
+    // Internal buses start out as not written in the current epoch, like the external buses.
+    , m_audioBuses(options.maxNumAudioBuses, options.blockSize, Epoch(0) - 1)
     , m_epoch(0)
     , m_currentTime(0)
-    , m_nodes(options.maxNumNodes, nullptr)
+    , m_nodes(*owner)
+    , m_maxNumNodes(options.maxNumNodes)
+    , m_plan(options.maxNumNodes, options.blockSize, options.numHelperThreads > 0,
+             options.numHelperThreads > 0 ? 0 : options.numSynthScratchBuffers)
+    , m_synthInstancePoolSize(options.synthInstancePoolSize)
+    , m_numSynthScratchBuffers(options.numHelperThreads > 0 ? 0 : options.numSynthScratchBuffers)
+    , m_freedNodes(nullptr)
+    , m_lastFreedNode(nullptr)
+    , m_maxNumNodeDestroysPerBlock(options.maxNumNodeDestroysPerBlock)
+    , m_nodeSetCommand(nullptr)
+    , m_busControlSetCommand(nullptr)
     , m_logLevel(options.logLevel)
     , m_logFlags(kMethcla_EngineLogDefault)
 {
     assert( m_logLevel.is_lock_free() );
     assert( m_logFlags.is_lock_free() );
 
+    // Select bus copy and mixing kernels for the CPU
+    methcla_dsp_init();
+
     const Epoch prevEpoch = m_epoch - 1;
 
     m_externalAudioInputs.reserve(options.numHardwareInputChannels);
@@ -231,17 +258,43 @@ EnvironmentImpl::EnvironmentImpl(
         );
     }
 
-    for (size_t i=0; i < options.maxNumAudioBuses; i++)
+    // Bus memory is committed lazily, only prepare the buses mapped first.
+    m_audioBuses.prepare(kNumAudioBusesPreparedAhead);
+
+    m_controlBuses.assign(options.maxNumControlBuses, 0.f);
+
+    if (options.numHelperThreads > 0)
     {
-        m_internalAudioBuses.push_back(
-            Memory::make_shared<InternalAudioBus>(options.blockSize, prevEpoch)
-        );
+        m_threadPool = std::unique_ptr<ThreadPool>(new ThreadPool(options.numHelperThreads));
+    }
+}
+
+AudioBus* EnvironmentImpl::audioBus(AudioBusId id)
+{
+    const size_t index = static_cast<uint32_t>(id);
+    if (index >= m_audioBuses.size())
+        throw std::out_of_range("Internal audio bus id out of range");
+
+    // Buses are prepared by the sender before a command mapping them is queued.
+    if (index >= m_audioBuses.numPrepared())
+        throwError(kMethcla_LogicError, "Internal audio bus has not been prepared");
+
+    return m_audioBuses.bus(id);
+}
+
+void EnvironmentImpl::prepareAudioBuses(size_t numBuses)
+{
+    if (numBuses > m_audioBuses.numPrepared())
+    {
+        std::lock_guard<std::mutex> lock(m_audioBusesMutex);
+        m_audioBuses.prepare(numBuses + kNumAudioBusesPreparedAhead);
     }
 }
 
 EnvironmentImpl::~EnvironmentImpl()
 {
     m_rootNode->free();
+    destroyFreedNodes(0);
     // Stop worker thread(s). Note that relying on the destructor here doesn't
     // cut it, because asynchronous commands in the worker thread queue might
     // reference a partially destroyed Environment.
@@ -255,10 +308,15 @@ void EnvironmentImpl::init(const Environment::Options& options)
     addNode(m_nodes, m_rootNode);
     // Load plugins
     m_plugins.loadPlugins(*m_owner, options.pluginLibraries);
+    // The command table doesn't change after plugins have been loaded.
+    m_nodeSetCommand = m_commands.lookup("/node/set");
+    m_busControlSetCommand = m_commands.lookup("/bus/control/set");
 }
 
 void EnvironmentImpl::process(Methcla_Time currentTime, size_t numFrames, const sample_t* const* inputs, sample_t* const* outputs)
 {
+    const LoadMeter::Clock::time_point processBegin = LoadMeter::Clock::now();
+
     // Update current time
     m_currentTime = currentTime;
 
@@ -267,79 +325,412 @@ void EnvironmentImpl::process(Methcla_Time currentTime, size_t numFrames, const
 
     // Process external requests
     processRequests(logFlags, currentTime);
-    // Process scheduled requests
-    processScheduler(logFlags, currentTime, currentTime + numFrames / m_owner->sampleRate());
     // std::cout << "Environment::process " << currentTime << std::endl;
 
     // Process non-realtime commands
     m_worker->perform();
 
+    const double sampleRate = m_owner->sampleRate();
+    // Tolerance for time stamps that are slightly off a frame boundary due to rounding.
+    const double frameEpsilon = 1e-3;
+
+    // Split the buffer into blocks and at the frames where scheduled commands take effect.
+    size_t frame = 0;
+    while (frame < numFrames)
+    {
+        const Methcla_Time frameTime = currentTime + frame / sampleRate;
+
+        m_currentTime = frameTime;
+
+        // Process scheduled requests and binary commands that fall on the current frame
+        const Methcla_Time nextFrameTime = currentTime + (frame + 1 - frameEpsilon) / sampleRate;
+        processScheduler(logFlags, frameTime, nextFrameTime);
+        processCommandRing(logFlags, nextFrameTime);
+
+        // Process at most one block, up to the frame of the next scheduled request or binary command
+        size_t endFrame = std::min(numFrames, frame + m_owner->blockSize());
+        auto splitAt = [&](Methcla_Time time) {
+            const double nextFrame = std::floor((time - currentTime) * sampleRate + frameEpsilon);
+            if (nextFrame < (double)endFrame)
+                endFrame = std::max(frame + 1, (size_t)std::max(0., nextFrame));
+        };
+        if (!m_scheduler.isEmpty())
+            splitAt(m_scheduler.time());
+
+        processFrames(frame, endFrame - frame, inputs, outputs);
+
+        frame = endFrame;
+    }
+
+    // Destroy nodes freed during this callback within the budget
+    destroyFreedNodes(m_maxNumNodeDestroysPerBlock);
+
+    // Replace the node map pages used up by nodes created during this callback
+    m_nodes.refill();
+
+    m_loadMeter.update(processBegin, numFrames / sampleRate);
+}
+
+void EnvironmentImpl::destroyFreedNodes(size_t maxNumNodes)
+{
+    for (size_t i=0; m_freedNodes != nullptr && (maxNumNodes == 0 || i < maxNumNodes); i++) {
+        Node* node = m_freedNodes;
+        m_freedNodes = node->m_next;
+        if (m_freedNodes == nullptr)
+            m_lastFreedNode = nullptr;
+        node->m_next = nullptr;
+        // Destroying a group queues its children.
+        node->destroy();
+    }
+}
+
+void EnvironmentImpl::processFrames(size_t offset, size_t numFrames, const sample_t* const* inputs, sample_t* const* outputs)
+{
     const size_t numExternalInputs = m_externalAudioInputs.size();
     const size_t numExternalOutputs = m_externalAudioOutputs.size();
 
     // Connect input and output buses
     for (size_t i=0; i < numExternalInputs; i++)
     {
-        m_externalAudioInputs[i]->setData(const_cast<sample_t*>(inputs[i]));
+        m_externalAudioInputs[i]->setData(const_cast<sample_t*>(inputs[i]) + offset);
         m_externalAudioInputs[i]->setEpoch(m_epoch);
     }
 
     for (size_t i=0; i < numExternalOutputs; i++)
     {
-        m_externalAudioOutputs[i]->setData(outputs[i]);
+        m_externalAudioOutputs[i]->setData(outputs[i] + offset);
     }
 
     // Run DSP graph
-    m_rootNode->process(numFrames);
+    // Free nodes that are done and rebuild the execution plan if the node tree has changed.
+    m_plan.update(m_rootNode);
+    // Helper threads are back to sleep when this returns.
+    m_plan.process(*m_owner, m_threadPool.get(), numFrames);
 
-    // Zero outputs that haven't been written to
+    // Zero outputs that haven't been written to or are silent
     for (size_t i=0; i < numExternalOutputs; i++)
     {
-        if (m_externalAudioOutputs[i]->epoch() != m_epoch)
+        if (m_externalAudioOutputs[i]->epoch() != m_epoch || m_externalAudioOutputs[i]->isSilent())
         {
-            memset(outputs[i], 0, numFrames * sizeof(sample_t));
+            memset(outputs[i] + offset, 0, numFrames * sizeof(sample_t));
         }
     }
 
     m_epoch++;
 }
 
-void EnvironmentImpl::processRequests(Methcla_EngineLogFlags logFlags, const Methcla_Time currentTime)
+void EnvironmentImpl::decodeRequest(Request* request) const
 {
-    Request* request;
-    while (m_requests->next(request))
+    try
     {
-        try
+        OSCPP::Server::Packet packet(request->packet(), request->size());
+        decodePacket(request, packet, nullptr);
+    }
+    catch (OSCPP::Error& e)
+    {
+        throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
+            s << "Couldn't parse request packet: " << e.what();
+        });
+    }
+}
+
+void EnvironmentImpl::decodePacket(Request* request, const OSCPP::Server::Packet& packet, const CommandBundle* parent) const
+{
+    std::vector<Command>& commands = request->commands();
+    std::vector<CommandBundle>& bundles = request->bundles();
+
+    // Messages outside of a bundle are executed immediately.
+    CommandBundle bundle = { 0., false, commands.size(), commands.size() };
+
+    auto addBundle = [&]() {
+        if (bundle.end > bundle.begin)
+            bundles.push_back(bundle);
+        bundle.begin = bundle.end = commands.size();
+    };
+
+    if (packet.isBundle())
+    {
+        OSCPP::Server::Bundle oscBundle(packet);
+        const Methcla_Time time = methcla_time_from_uint64(oscBundle.time());
+
+        if (parent == nullptr)
+        {
+            bundle.time = time;
+        }
+        else if (parent->time == 0.)
+        {
+            // Bundles nested in an immediate bundle are executed immediately unless their time is still ahead.
+            bundle.time = time;
+            bundle.immediateIfDue = true;
+        }
+        else
+        {
+            // Other nested bundles are executed with the enclosing bundle unless their time is later.
+            bundle.time = std::max(parent->time, time);
+            bundle.immediateIfDue = parent->immediateIfDue;
+        }
+
+        auto packets = oscBundle.packets();
+        while (!packets.atEnd())
+        {
+            auto element = packets.next();
+            if (element.isBundle())
+            {
+                addBundle();
+                decodePacket(request, element, &bundle);
+                bundle.begin = bundle.end = commands.size();
+            }
+            else
+            {
+                decodeMessage(request, element);
+                bundle.end = commands.size();
+            }
+        }
+    }
+    else
+    {
+        decodeMessage(request, packet);
+        bundle.end = commands.size();
+    }
+
+    addBundle();
+}
+
+void EnvironmentImpl::decodeMessage(Request* request, const OSCPP::Server::Packet& packet) const
+{
+    const OSCPP::Server::Message msg(packet);
+
+    // Requests for unknown addresses are ignored.
+    const CommandTable::Entry* entry = m_commands.lookup(msg.address());
+    if (entry == nullptr)
+        return;
+
+    Command command;
+    command.entry = entry;
+    command.synthDef = nullptr;
+
+    auto args = msg.args();
+
+    try
+    {
+        size_t numArgs = 0;
+        const char* type = entry->signature;
+        for (; *type != '\0' && *type != '*'; type++)
         {
-            OSCPP::Server::Packet packet(request->packet(), request->size());
-            if (packet.isBundle())
+            assert(numArgs < Command::kMaxNumArgs);
+            switch (*type)
             {
-                OSCPP::Server::Bundle bundle(packet);
-                Methcla_Time bundleTime = methcla_time_from_uint64(bundle.time());
-                if (bundleTime == 0.)
+                case 'i':
+                    command.args[numArgs++].i = args.int32();
+                    break;
+                case 'f':
+                    command.args[numArgs++].f = args.float32();
+                    break;
+                case 'd':
+                    command.synthDef = synthDef(args.string()).get();
+                    break;
+                default:
+                    assert(false);
+            }
+        }
+
+        if (*type != '*' && !args.atEnd())
+            throwError(kMethcla_ArgumentError, "Too many arguments");
+
+        command.rest = args;
+
+        // Check arguments that don't depend on the state of the node tree.
+        Command::Args scalars(command.args);
+
+        switch (entry->id)
+        {
+            case kCommand_SynthNew:
+            case kCommand_SynthNewBatch:
+            {
+                auto rest = args;
+                if (entry->id == kCommand_SynthNewBatch)
                 {
-                    processBundle(logFlags, request, bundle, currentTime, currentTime);
+                    auto nodeIds = rest.array();
+                    while (!nodeIds.atEnd())
+                        nodeIds.int32();
                 }
-                else
+                if (!rest.atEnd())
                 {
-                    request->retain();
-                    m_scheduler.push(bundleTime, ScheduledBundle(request, bundle));
+                    auto synthControls = rest.array();
+                    while (!synthControls.atEnd())
+                        synthControls.float32();
                 }
+                if (!rest.atEnd())
+                    rest.array();
+                if (!rest.atEnd())
+                    throwError(kMethcla_ArgumentError, "Too many arguments");
             }
-            else
+            break;
+            case kCommand_SynthMapInput:
+            case kCommand_SynthMapOutput:
+            {
+                const bool isInput = entry->id == kCommand_SynthMapInput;
+                scalars.int32();
+                scalars.int32();
+                const int32_t busId = scalars.int32();
+                const Methcla_BusMappingFlags flags = Methcla_BusMappingFlags(scalars.int32());
+
+                if ((flags & kMethcla_BusMappingExternal) && (busId < 0 || (size_t)busId >= (isInput ? m_externalAudioInputs.size() : m_externalAudioOutputs.size())))
+                {
+                    throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
+                        s << "External audio bus id " << busId << " out of range";
+                    });
+                }
+                else if ((flags & kMethcla_BusMappingInternal) && (busId < 0 || (size_t)busId >= m_audioBuses.size()))
+                {
+                    throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
+                        s << "Internal audio bus id " << busId << " out of range";
+                    });
+                }
+
+                if (!(flags & kMethcla_BusMappingExternal) && busId >= 0)
+                    request->useAudioBuses(busId + 1);
+            }
+            break;
+            case kCommand_SynthMapInputs:
+            case kCommand_SynthMapOutputs:
+            {
+                const bool isInput = entry->id == kCommand_SynthMapInputs;
+                scalars.int32();
+                scalars.int32();
+                const int32_t busId = scalars.int32();
+                const int32_t numChannels = scalars.int32();
+                const Methcla_BusMappingFlags flags = Methcla_BusMappingFlags(scalars.int32());
+
+                if (numChannels < 1)
+                {
+                    throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
+                        s << "Invalid number of channels " << numChannels;
+                    });
+                }
+
+                const size_t numBuses = flags & kMethcla_BusMappingExternal
+                                            ? (isInput ? m_externalAudioInputs.size() : m_externalAudioOutputs.size())
+                                            : m_audioBuses.size();
+                if (busId < 0 || (size_t)busId + numChannels > numBuses)
+                {
+                    throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
+                        s << (flags & kMethcla_BusMappingExternal ? "External" : "Internal")
+                          << " audio buses " << busId << " to " << busId + numChannels - 1 << " out of range";
+                    });
+                }
+
+                if (!(flags & kMethcla_BusMappingExternal))
+                    request->useAudioBuses(busId + numChannels);
+            }
+            break;
+            case kCommand_SynthMapControlInput:
+            case kCommand_SynthMapControlOutput:
             {
-                processMessage(logFlags, packet, currentTime, currentTime);
+                scalars.int32();
+                scalars.int32();
+                const int32_t busId = scalars.int32();
+
+                if (busId < -1 || busId >= (int32_t)m_controlBuses.size())
+                {
+                    throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
+                        s << "Control bus id " << busId << " out of range";
+                    });
+                }
             }
-            request->release();
-        }
-        catch (OSCPP::Error&)
-        {
-            replyError(kMethcla_Notification, "Couldn't parse request packet");
+            break;
+            case kCommand_SynthMapControlInputAudio:
+            {
+                scalars.int32();
+                scalars.int32();
+                const int32_t busId = scalars.int32();
+                const Methcla_BusMappingFlags flags = Methcla_BusMappingFlags(scalars.int32());
+
+                if (busId < -1)
+                {
+                    throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
+                        s << "Audio bus id " << busId << " out of range";
+                    });
+                }
+                else if ((flags & kMethcla_BusMappingExternal) && busId >= (int32_t)m_externalAudioInputs.size())
+                {
+                    throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
+                        s << "External audio bus id " << busId << " out of range";
+                    });
+                }
+                else if (!(flags & kMethcla_BusMappingExternal) && busId >= (int32_t)m_audioBuses.size())
+                {
+                    throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
+                        s << "Internal audio bus id " << busId << " out of range";
+                    });
+                }
+
+                if (!(flags & kMethcla_BusMappingExternal) && busId >= 0)
+                    request->useAudioBuses(busId + 1);
+            }
+            break;
+            case kCommand_BusControlSet:
+            {
+                const int32_t busId = scalars.int32();
+
+                if (busId < 0 || busId >= (int32_t)m_controlBuses.size())
+                {
+                    throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
+                        s << "Control bus id " << busId << " out of range";
+                    });
+                }
+            }
+            break;
+            default:
+                break;
         }
-        catch (std::exception& e)
+    }
+    catch (Error& e)
+    {
+        throwErrorWith(e.errorCode(), [&](std::stringstream& s) {
+            s << msg.address() << ": " << e.what();
+        });
+    }
+    catch (OSCPP::Error& e)
+    {
+        throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
+            s << msg.address() << ": " << e.what();
+        });
+    }
+
+    command.message = packet.data();
+    command.messageSize = packet.size();
+
+    request->commands().push_back(command);
+}
+
+void EnvironmentImpl::processRequests(Methcla_EngineLogFlags logFlags, const Methcla_Time currentTime)
+{
+    Request* request;
+    while (m_requests->next(request))
+    {
+        const std::vector<CommandBundle>& bundles = request->bundles();
+        for (size_t i=0; i < bundles.size(); i++)
         {
-            replyError(kMethcla_Notification, e.what());
+            const CommandBundle& bundle = bundles[i];
+            if (bundle.time == 0. || (bundle.immediateIfDue && bundle.time <= currentTime))
+            {
+                processBundle(logFlags, request, bundle);
+            }
+            else
+            {
+                try
+                {
+                    m_scheduler.push(bundle.time, ScheduledBundle(request, i));
+                    request->retain();
+                }
+                catch (std::exception& e)
+                {
+                    replyError(kMethcla_Notification, e.what());
+                }
+            }
         }
+        request->release();
     }
 }
 
@@ -355,10 +746,17 @@ void EnvironmentImpl::processScheduler(Methcla_EngineLogFlags logFlags, const Me
                 rt_log() << "Late " << scheduleTime << " " << currentTime << " " << nextTime;
 #endif // DEBUG
             ScheduledBundle bundle = m_scheduler.top();
-            assert( methcla_time_from_uint64(bundle.m_bundle.time()) == scheduleTime );
-            processBundle(logFlags, bundle.m_request, bundle.m_bundle, scheduleTime, currentTime);
             m_scheduler.pop();
-            bundle.m_request->release();
+            if (bundle.m_request == nullptr)
+            {
+                processEngineCommand(logFlags, bundle.m_command);
+            }
+            else
+            {
+                assert( bundle.m_request->bundles()[bundle.m_bundle].time == scheduleTime );
+                processBundle(logFlags, bundle.m_request, bundle.m_request->bundles()[bundle.m_bundle]);
+                bundle.m_request->release();
+            }
         }
         else
         {
@@ -367,341 +765,724 @@ void EnvironmentImpl::processScheduler(Methcla_EngineLogFlags logFlags, const Me
     }
 }
 
-void EnvironmentImpl::processBundle(Methcla_EngineLogFlags logFlags, Request* request, const OSCPP::Server::Bundle& bundle, const Methcla_Time scheduleTime, const Methcla_Time currentTime)
+void EnvironmentImpl::processBundle(Methcla_EngineLogFlags logFlags, Request* request, const CommandBundle& bundle)
+{
+    const std::vector<Command>& commands = request->commands();
+    for (size_t i=bundle.begin; i < bundle.end; i++)
+    {
+        processCommand(logFlags, commands[i]);
+    }
+}
+
+void EnvironmentImpl::sendCommands(const Methcla_EngineCommand* commands, size_t numCommands)
+{
+    for (size_t i=0; i < numCommands; i++)
+    {
+        const Methcla_EngineCommand& command = commands[i];
+        switch (command.opcode)
+        {
+            case kMethcla_EngineCommandNodeSet:
+                break;
+            case kMethcla_EngineCommandBusControlSet:
+                if (command.index < 0 || command.index >= (int32_t)m_controlBuses.size())
+                {
+                    throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
+                        s << "Control bus id " << command.index << " out of range";
+                    });
+                }
+                break;
+            default:
+                throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
+                    s << "Invalid command opcode " << command.opcode;
+                });
+        }
+    }
+
+    if (!m_commandRing.pushAll(commands, numCommands))
+        throw std::runtime_error("Command ring overflow");
+}
+
+void EnvironmentImpl::processCommandRing(Methcla_EngineLogFlags logFlags, const Methcla_Time nextTime)
 {
-    auto packets = bundle.packets();
-    while (!packets.atEnd())
+    for (const Methcla_EngineCommand* ringCommand = m_commandRing.front();
+         ringCommand != nullptr;
+         ringCommand = m_commandRing.front())
     {
-        auto packet = packets.next();
-        if (packet.isBundle())
+        const Methcla_EngineCommand engineCommand = *ringCommand;
+        m_commandRing.pop();
+
+        if (engineCommand.time == 0. || engineCommand.time < nextTime)
         {
-            OSCPP::Server::Bundle innerBundle(packet);
-            Methcla_Time innerBundleTime = methcla_time_from_uint64(innerBundle.time());
-            if (innerBundleTime <= scheduleTime)
+            processEngineCommand(logFlags, engineCommand);
+        }
+        else
+        {
+            // Schedule commands that take effect later so they don't hold up the commands sent after them.
+            try
             {
-                processBundle(logFlags, request, innerBundle, scheduleTime, currentTime);
+                m_scheduler.push(engineCommand.time, ScheduledBundle(engineCommand));
             }
-            else
+            catch (std::exception& e)
             {
-                request->retain();
-                m_scheduler.push(innerBundleTime, ScheduledBundle(request, innerBundle));
+                replyError(kMethcla_Notification, e.what());
             }
         }
-        else
-        {
-            processMessage(logFlags, packet, scheduleTime, currentTime);
-        }
     }
 }
 
-void EnvironmentImpl::processMessage(Methcla_EngineLogFlags logFlags, const OSCPP::Server::Message& msg, Methcla_Time scheduleTime, Methcla_Time currentTime)
+void EnvironmentImpl::processEngineCommand(Methcla_EngineLogFlags logFlags, const Methcla_EngineCommand& engineCommand)
+{
+    // Execute binary commands like the equivalent decoded OSC requests.
+    Command command;
+    command.synthDef = nullptr;
+    command.message = nullptr;
+    command.messageSize = 0;
+
+    if (engineCommand.opcode == kMethcla_EngineCommandNodeSet)
+    {
+        command.entry = m_nodeSetCommand;
+        command.args[0].i = engineCommand.node_id;
+        command.args[1].i = engineCommand.index;
+        command.args[2].f = engineCommand.value;
+    }
+    else
+    {
+        assert(engineCommand.opcode == kMethcla_EngineCommandBusControlSet);
+        command.entry = m_busControlSetCommand;
+        command.args[0].i = engineCommand.index;
+        command.args[1].f = engineCommand.value;
+    }
+
+    processCommand(logFlags, command);
+}
+
+void EnvironmentImpl::processCommand(Methcla_EngineLogFlags logFlags, const Command& command)
 {
     using namespace std::placeholders;
 
     if (logFlags & kMethcla_EngineLogRequests)
-        rt_log() << "Request: " << msg;
+    {
+        if (command.message != nullptr)
+            rt_log() << "Request: " << OSCPP::Server::Message(OSCPP::Server::Packet(command.message, command.messageSize));
+        else
+            rt_log() << "Command: " << command.entry->address;
+    }
 
-    auto args = msg.args();
-    // Methcla_RequestId requestId = args.int32();
+    Command::Args args(command.args);
 
     try
     {
-        if (msg == "/group/new")
+        switch (command.entry->id)
         {
-            NodeId nodeId = NodeId(args.int32());
-            checkNodeIdIsFree(m_nodes, nodeId);
+            case kCommand_GroupNew:
+            {
+                NodeId nodeId = NodeId(args.int32());
+                checkCanAddNode(m_nodes, m_maxNumNodes, nodeId);
 
-            NodeId targetId = NodeId(args.int32());
-            Methcla_NodePlacement nodePlacement = Methcla_NodePlacement(args.int32());
+                NodeId targetId = NodeId(args.int32());
+                Methcla_NodePlacement nodePlacement = Methcla_NodePlacement(args.int32());
 
-            Node* target = lookupNode(m_nodes, "Target node", targetId);
+                Node* target = lookupNode(m_nodes, "Target node", targetId);
 
-            Group* group = Group::construct(*m_owner, nodeId);
-            addNode(m_nodes, group);
-            addNodeToTarget(target, group, nodePlacement);
-        }
-        else if (msg == "/group/freeAll")
-        {
-            NodeId nodeId = NodeId(args.int32());
-            Group* group = lookupNodeAs<Group>(m_nodes, "Group", nodeId);
-            group->freeAll();
-        }
-        else if (msg == "/synth/new")
-        {
-            const char* defName = args.string();
+                Group* group = Group::construct(*m_owner, nodeId);
+                addNode(m_nodes, group);
+                addNodeToTarget(target, group, nodePlacement);
+            }
+            break;
+            case kCommand_ParGroupNew:
+            {
+                NodeId nodeId = NodeId(args.int32());
+                checkCanAddNode(m_nodes, m_maxNumNodes, nodeId);
+
+                NodeId targetId = NodeId(args.int32());
+                Methcla_NodePlacement nodePlacement = Methcla_NodePlacement(args.int32());
 
-            NodeId nodeId = NodeId(args.int32());
-            checkNodeIdIsFree(m_nodes, nodeId);
+                Node* target = lookupNode(m_nodes, "Target node", targetId);
 
-            NodeId targetId = NodeId(args.int32());
-            Methcla_NodePlacement nodePlacement = Methcla_NodePlacement(args.int32());
+                Group* group = ParGroup::construct(*m_owner, nodeId);
+                addNode(m_nodes, group);
+                addNodeToTarget(target, group, nodePlacement);
+            }
+            break;
+            case kCommand_GroupFreeAll:
+            {
+                NodeId nodeId = NodeId(args.int32());
+                Group* group = lookupNodeAs<Group>(m_nodes, "Group", nodeId);
+                group->freeAll();
+            }
+            break;
+            case kCommand_SynthNew:
+            {
+                NodeId nodeId = NodeId(args.int32());
+                checkCanAddNode(m_nodes, m_maxNumNodes, nodeId);
 
-            const shared_ptr<SynthDef> def = m_owner->synthDef(defName);
+                NodeId targetId = NodeId(args.int32());
+                Methcla_NodePlacement nodePlacement = Methcla_NodePlacement(args.int32());
 
-            auto synthControls = args.atEnd() ? OSCPP::Server::ArgStream() : args.array();
-            // FIXME: Cannot be checked before the synth is instantiated.
-            // if (def->numControlInputs() != synthControls.size()) {
-            //     throw std::runtime_error("Missing synth control initialisers");
-            // }
-            auto synthArgs = args.atEnd() ? OSCPP::Server::ArgStream() : args.array();
+                const SynthDef* def = command.synthDef;
 
-            Node* target = lookupNode(m_nodes, "Target node", targetId);
+                auto rest = command.rest;
+                auto synthControls = rest.atEnd() ? OSCPP::Server::ArgStream() : rest.array();
+                // FIXME: Cannot be checked before the synth is instantiated.
+                // if (def->numControlInputs() != synthControls.size()) {
+                //     throw std::runtime_error("Missing synth control initialisers");
+                // }
+                auto synthArgs = rest.atEnd() ? OSCPP::Server::ArgStream() : rest.array();
 
-            try
-            {
-                Synth* synth = Synth::construct(
-                    *m_owner,
-                    nodeId,
-                    *def,
-                    synthControls,
-                    synthArgs);
+                Node* target = lookupNode(m_nodes, "Target node", targetId);
 
-                addNode(m_nodes, synth);
-                addNodeToTarget(target, synth, nodePlacement);
+                try
+                {
+                    Synth* synth = Synth::construct(
+                        *m_owner,
+                        nodeId,
+                        *def,
+                        synthControls,
+                        synthArgs);
+
+                    addNode(m_nodes, synth);
+                    addNodeToTarget(target, synth, nodePlacement);
+                }
+                catch (OSCPP::UnderrunError&)
+                {
+                    throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
+                        s << "Missing control initializer for synth " << nodeId;
+                    });
+                }
+                catch (OSCPP::ParseError&)
+                {
+                    throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
+                        s << "Invalid control initializer for synth " << nodeId;
+                    });
+                }
             }
-            catch (OSCPP::UnderrunError&)
+            break;
+            case kCommand_SynthNewBatch:
             {
-                throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
-                    s << "Missing control initializer for synth " << nodeId;
-                });
+                NodeId targetId = NodeId(args.int32());
+                Methcla_NodePlacement nodePlacement = Methcla_NodePlacement(args.int32());
+
+                auto rest = command.rest;
+                auto nodeIds = rest.array();
+                auto synthControls = rest.atEnd() ? OSCPP::Server::ArgStream() : rest.array();
+                auto synthArgs = rest.atEnd() ? OSCPP::Server::ArgStream() : rest.array();
+
+                const size_t numSynths = nodeIds.size();
+                if (numSynths == 0)
+                    return;
+
+                const SynthDef* def = command.synthDef;
+                Node* target = lookupNode(m_nodes, "Target node", targetId);
+
+                // Options, port layout and memory are shared by all synths of the batch.
+                const Methcla_SynthOptions* synthOptions = def->configure(synthArgs);
+                const Synth::Layout layout(*m_owner, *def, synthOptions);
+                Synth::Batch* batch = Synth::Batch::alloc(*m_owner, layout, numSynths);
+
+                try
+                {
+                    for (size_t i=0; i < numSynths; i++)
+                    {
+                        NodeId nodeId = NodeId(nodeIds.int32());
+                        checkCanAddNode(m_nodes, m_maxNumNodes, nodeId);
+                        try
+                        {
+                            addNode(m_nodes, batch->construct(*m_owner, nodeId, *def, synthOptions, layout, synthControls));
+                        }
+                        catch (OSCPP::UnderrunError&)
+                        {
+                            throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
+                                s << "Missing control initializer for synth " << nodeId;
+                            });
+                        }
+                        catch (OSCPP::ParseError&)
+                        {
+                            throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
+                                s << "Invalid control initializer for synth " << nodeId;
+                            });
+                        }
+                    }
+
+                    // Link the synths in order; only the first placement can fail.
+                    Synth* prev = batch->synth(0);
+                    addNodeToTarget(target, prev, nodePlacement);
+                    for (size_t i=1; i < numSynths; i++)
+                    {
+                        Synth* synth = batch->synth(i);
+                        prev->parent()->addAfter(prev, synth);
+                        prev = synth;
+                    }
+                }
+                catch (...)
+                {
+                    for (size_t i=0; i < batch->size(); i++)
+                    {
+                        m_nodes.remove(batch->synth(i)->id());
+                    }
+                    batch->destroy(*m_owner);
+                    throw;
+                }
             }
-            catch (OSCPP::ParseError&)
+            break;
+            case kCommand_SynthActivate:
             {
-                throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
-                    s << "Invalid control initializer for synth " << nodeId;
-                });
+                NodeId nodeId = NodeId(args.int32());
+                Synth* synth = lookupNodeAs<Synth>(m_nodes, "Synth", nodeId);
+                // Scheduled requests are processed at the start of the frame they fall on.
+                synth->activate();
             }
-        }
-        else if (msg == "/synth/activate")
-        {
-            NodeId nodeId = NodeId(args.int32());
-            Synth* synth = lookupNodeAs<Synth>(m_nodes, "Synth", nodeId);
-            // TODO: Use sample rate estimate from driver
-            const double sampleOffset = std::max(0., (scheduleTime - currentTime) * m_owner->sampleRate());
-            synth->activate(sampleOffset);
-        }
-        else if (msg == "/synth/map/input")
-        {
-            NodeId nodeId = NodeId(args.int32());
-            int32_t index = args.int32();
-            int32_t busId = AudioBusId(args.int32());
-            Methcla_BusMappingFlags flags = Methcla_BusMappingFlags(args.int32());
-
-            if ((flags & kMethcla_BusMappingExternal) && (busId < 0 || (size_t)busId >= m_externalAudioInputs.size()))
+            break;
+            case kCommand_SynthMapInput:
             {
-                throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
-                    s << "External audio bus id " << busId << " out of range";
-                });
+                NodeId nodeId = NodeId(args.int32());
+                int32_t index = args.int32();
+                int32_t busId = AudioBusId(args.int32());
+                Methcla_BusMappingFlags flags = Methcla_BusMappingFlags(args.int32());
+
+                Synth* synth = lookupNodeAs<Synth>(m_nodes, "Synth", nodeId);
+
+                if ((index < 0) || (index >= (int32_t)synth->numAudioInputs()))
+                {
+                    throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
+                        s << "Audio input index " << index << " out of range for synth " << nodeId;
+                    });
+                }
+
+                synth->mapInput(index, AudioBusId(busId), flags);
             }
-            else if ((flags & kMethcla_BusMappingInternal) && (busId < 0 || (size_t)busId >= m_internalAudioBuses.size()))
+            break;
+            case kCommand_SynthMapOutput:
             {
-                throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
-                    s << "Internal audio bus id " << busId << " out of range";
-                });
+                NodeId nodeId = NodeId(args.int32());
+                int32_t index = args.int32();
+                int32_t busId = args.int32();
+                Methcla_BusMappingFlags flags = Methcla_BusMappingFlags(args.int32());
+
+                Synth* synth = lookupNodeAs<Synth>(m_nodes, "Synth", nodeId);
+
+                if ((index < 0) || (index >= (int32_t)synth->numAudioOutputs()))
+                {
+                    throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
+                        s << "Audio output index " << index << " out of range for synth " << nodeId;
+                    });
+                }
+
+                synth->mapOutput(index, AudioBusId(busId), flags);
             }
+            break;
+            case kCommand_SynthMapInputs:
+            case kCommand_SynthMapOutputs:
+            {
+                const bool isInput = command.entry->id == kCommand_SynthMapInputs;
+                NodeId nodeId = NodeId(args.int32());
+                int32_t index = args.int32();
+                int32_t busId = args.int32();
+                int32_t numChannels = args.int32();
+                Methcla_BusMappingFlags flags = Methcla_BusMappingFlags(args.int32());
 
-            Synth* synth = lookupNodeAs<Synth>(m_nodes, "Synth", nodeId);
+                Synth* synth = lookupNodeAs<Synth>(m_nodes, "Synth", nodeId);
 
-            if ((index < 0) || (index >= (int32_t)synth->numAudioInputs()))
+                const int32_t numPorts = isInput ? synth->numAudioInputs() : synth->numAudioOutputs();
+                if ((index < 0) || (index + numChannels > numPorts))
+                {
+                    throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
+                        s << "Audio " << (isInput ? "inputs " : "outputs ") << index << " to " << index + numChannels - 1
+                          << " out of range for synth " << nodeId;
+                    });
+                }
+
+                if (isInput)
+                    synth->mapInputs(index, AudioBusId(busId), numChannels, flags);
+                else
+                    synth->mapOutputs(index, AudioBusId(busId), numChannels, flags);
+            }
+            break;
+            case kCommand_SynthMapControlInput:
+            case kCommand_SynthMapControlOutput:
             {
-                throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
-                    s << "Audio input index " << index << " out of range for synth " << nodeId;
-                });
+                const bool isInput = command.entry->id == kCommand_SynthMapControlInput;
+                NodeId nodeId = NodeId(args.int32());
+                int32_t index = args.int32();
+                int32_t busId = args.int32();
+
+                Synth* synth = lookupNodeAs<Synth>(m_nodes, "Synth", nodeId);
+
+                if ((index < 0) || (index >= (int32_t)(isInput ? synth->numControlInputs() : synth->numControlOutputs())))
+                {
+                    throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
+                        s << "Control " << (isInput ? "input" : "output") << " index " << index << " out of range for synth " << nodeId;
+                    });
+                }
+
+                // A bus id of -1 unmaps the port.
+                sample_t* bus = busId < 0 ? nullptr : &m_controlBuses[busId];
+                if (isInput)
+                    synth->mapControlInput(index, bus);
+                else
+                    synth->mapControlOutput(index, bus);
             }
+            break;
+            case kCommand_SynthMapControlInputAudio:
+            {
+                NodeId nodeId = NodeId(args.int32());
+                int32_t index = args.int32();
+                int32_t busId = args.int32();
+                Methcla_BusMappingFlags flags = Methcla_BusMappingFlags(args.int32());
 
-            synth->mapInput(index, AudioBusId(busId), flags);
-        }
-        else if (msg == "/synth/map/output")
-        {
-            NodeId nodeId = NodeId(args.int32());
-            int32_t index = args.int32();
-            int32_t busId = args.int32();
-            Methcla_BusMappingFlags flags = Methcla_BusMappingFlags(args.int32());
+                Synth* synth = lookupNodeAs<Synth>(m_nodes, "Synth", nodeId);
 
-            if ((flags & kMethcla_BusMappingExternal) && (busId < 0 || (size_t)busId >= m_externalAudioOutputs.size()))
+                if ((index < 0) || (index >= (int32_t)synth->numControlInputs()))
+                {
+                    throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
+                        s << "Control input index " << index << " out of range for synth " << nodeId;
+                    });
+                }
+
+                // A bus id of -1 unmaps the input.
+                AudioBus* bus = busId < 0
+                                    ? nullptr
+                                    : (flags & kMethcla_BusMappingExternal
+                                        ? m_externalAudioInputs[busId].get()
+                                        : audioBus(AudioBusId(busId)));
+                synth->mapControlInputToAudioBus(index, bus, flags);
+            }
+            break;
+            case kCommand_BusControlSet:
             {
-                throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
-                    s << "External audio bus id " << busId << " out of range";
-                });
+                int32_t busId = args.int32();
+                float value = args.float32();
+                m_controlBuses[busId] = value;
             }
-            else if ((flags & kMethcla_BusMappingInternal) && (busId < 0 || (size_t)busId >= m_internalAudioBuses.size()))
+            break;
+            case kCommand_SynthPropertyDoneFlagsSet:
             {
-                throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
-                    s << "Internal audio bus id " << busId << " out of range";
-                });
+                NodeId nodeId = NodeId(args.int32());
+                Methcla_NodeDoneFlags flags = Methcla_NodeDoneFlags(args.int32());
+                Synth* synth = lookupNodeAs<Synth>(m_nodes, "Synth", nodeId);
+                synth->setDoneFlags(flags);
             }
+            break;
+            case kCommand_NodeFree:
+            {
+                NodeId nodeId = NodeId(args.int32());
+                Node* node = lookupNode(m_nodes, "Node", nodeId);
 
-            Synth* synth = lookupNodeAs<Synth>(m_nodes, "Synth", nodeId);
+                if (node == m_rootNode)
+                {
+                    throwErrorWith(kMethcla_NodeIdError, [&](std::stringstream& s) {
+                        s << "Cannot free root node " << nodeId;
+                    });
+                }
 
-            if ((index < 0) || (index >= (int32_t)synth->numAudioOutputs()))
+                node->free();
+            }
+            break;
+            case kCommand_NodeRun:
             {
-                throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
-                    s << "Audio output index " << index << " out of range for synth " << nodeId;
-                });
+                NodeId nodeId = NodeId(args.int32());
+                bool running = args.int32() != 0;
+                Node* node = lookupNode(m_nodes, "Node", nodeId);
+                node->setRunning(running);
             }
+            break;
+            case kCommand_NodeSet:
+            {
+                NodeId nodeId = NodeId(args.int32());
+                int32_t index = args.int32();
+                float value = args.float32();
 
-            synth->mapOutput(index, AudioBusId(busId), flags);
-        }
-        else if (msg == "/synth/property/doneFlags/set")
-        {
-            NodeId nodeId = NodeId(args.int32());
-            Methcla_NodeDoneFlags flags = Methcla_NodeDoneFlags(args.int32());
-            Synth* synth = lookupNodeAs<Synth>(m_nodes, "Synth", nodeId);
-            synth->setDoneFlags(flags);
-        }
-        else if (msg == "/node/free")
-        {
-            NodeId nodeId = NodeId(args.int32());
-            Node* node = lookupNode(m_nodes, "Node", nodeId);
+                Synth* synth = lookupNodeAs<Synth>(m_nodes, "Synth", nodeId);
 
-            if (node == m_rootNode)
-            {
-                throwErrorWith(kMethcla_NodeIdError, [&](std::stringstream& s) {
-                    s << "Cannot free root node " << nodeId;
-                });
+                if ((index < 0) || (index >= (int32_t)synth->numControlInputs()))
+                {
+                    throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
+                        s << "Control input index " << index << " out of range for synth " << nodeId;
+                    });
+                }
+
+                synth->setControlInput(index, value);
             }
+            break;
+            case kCommand_NodeTreeStatistics:
+            {
+                class CommandNodeTreeStatistics
+                {
+                public:
+                    struct Statistics
+                    {
+                        Statistics()
+                            : numGroups(0)
+                            , numSynths(0)
+                        { }
 
-            node->free();
-        }
-        else if (msg == "/node/set")
-        {
-            NodeId nodeId = NodeId(args.int32());
-            int32_t index = args.int32();
-            float value = args.float32();
+                        size_t numGroups = 0;
+                        size_t numSynths = 0;
+                    };
 
-            Synth* synth = lookupNodeAs<Synth>(m_nodes, "Synth", nodeId);
+                    static Statistics collectStatistics(const Group* group, Statistics stats=Statistics())
+                    {
+                        stats.numGroups++;
 
-            if ((index < 0) || (index >= (int32_t)synth->numControlInputs()))
-            {
-                throwErrorWith(kMethcla_ArgumentError, [&](std::stringstream& s) {
-                    s << "Control input index " << index << " out of range for synth " << nodeId;
-                });
-            }
+                        const Node* cur = group->first();
 
-            synth->controlInput(index) = value;
-        }
-        else if (msg == "/node/tree/statistics")
-        {
-            class CommandNodeTreeStatistics
+                        while (cur != nullptr)
+                        {
+                            const Group* subGroup = dynamic_cast<const Group*>(cur);
+                            if (subGroup == nullptr)
+                            {
+                                stats.numSynths++;
+                            }
+                            else
+                            {
+                                stats = collectStatistics(subGroup, stats);
+                            }
+                            cur = cur->next();
+                        }
+
+                        return stats;
+                    }
+
+                    CommandNodeTreeStatistics(Methcla_RequestId requestId, Statistics stats)
+                        : m_requestId(requestId)
+                        , m_stats(stats)
+                    {
+                    }
+
+                    void perform(Environment* env)
+                    {
+                        static const char* address = "/node/tree/statistics";
+                        OSCPP::Client::DynamicPacket packet(
+                            OSCPP::Size::message(address, 2)
+                          + OSCPP::Size::int32(2)
+                        );
+                        packet.openMessage(address, 2);
+                        packet.int32(m_stats.numGroups);
+                        packet.int32(m_stats.numSynths);
+                        packet.closeMessage();
+                        env->reply(m_requestId, packet);
+                        env->sendFromWorker(perform_rt_free, this);
+                    }
+
+                private:
+                    Methcla_RequestId m_requestId;
+                    Statistics        m_stats;
+                };
+
+                Methcla_RequestId requestId = args.int32();
+
+                CommandNodeTreeStatistics::Statistics stats =
+                    CommandNodeTreeStatistics::collectStatistics(rootNode());
+
+                sendToWorker<CommandNodeTreeStatistics>(requestId, stats);
+            }
+            break;
+            case kCommand_NodeProfile:
             {
-            public:
-                struct Statistics
+    #if METHCLA_PROFILING
+                class CommandNodeProfile
                 {
-                    Statistics()
-                        : numGroups(0)
-                        , numSynths(0)
+                public:
+                    CommandNodeProfile(Methcla_RequestId requestId, NodeId nodeId, const Utility::Profile::Counter& profile)
+                        : m_requestId(requestId)
+                        , m_nodeId(nodeId)
+                        , m_profile(profile)
                     { }
 
-                    size_t numGroups = 0;
-                    size_t numSynths = 0;
+                    void perform(Environment* env)
+                    {
+                        static const char* address = "/node/profile";
+                        OSCPP::Client::DynamicPacket packet(
+                            OSCPP::Size::message(address, 3)
+                          + OSCPP::Size::int32(2)
+                          + OSCPP::Size::float32()
+                        );
+                        packet.openMessage(address, 3);
+                        packet.int32(m_nodeId);
+                        packet.int32(m_profile.calls);
+                        packet.float32(m_profile.ticks);
+                        packet.closeMessage();
+                        env->reply(m_requestId, packet);
+                        env->sendFromWorker(perform_rt_free, this);
+                    }
+
+                private:
+                    Methcla_RequestId         m_requestId;
+                    NodeId                    m_nodeId;
+                    Utility::Profile::Counter m_profile;
                 };
 
-                static Statistics collectStatistics(const Group* group, Statistics stats=Statistics())
-                {
-                    stats.numGroups++;
+                const Methcla_RequestId requestId = args.int32();
+                const NodeId nodeId = NodeId(args.int32());
 
-                    const Node* cur = group->first();
+                const Node* node = lookupNode(m_nodes, "Node", nodeId);
 
-                    while (cur != nullptr)
+                sendToWorker<CommandNodeProfile>(requestId, nodeId, node->profile());
+    #else
+                throwError(kMethcla_UnimplementedError, "Profiling is disabled in this build");
+    #endif
+            }
+            break;
+            case kCommand_SynthDefProfile:
+            {
+    #if METHCLA_PROFILING
+                class CommandSynthDefProfile
+                {
+                public:
+                    CommandSynthDefProfile(Methcla_RequestId requestId, const SynthDefMap* synthDefs)
+                        : m_requestId(requestId)
+                        , m_synthDefs(synthDefs)
+                    { }
+
+                    void perform(Environment* env)
                     {
-                        const Group* subGroup = dynamic_cast<const Group*>(cur);
-                        if (subGroup == nullptr)
+                        // Synth definitions are only registered during engine startup and their counters are atomic, so they can be read from the worker thread.
+                        static const char* address = "/synthdef/profile";
+                        const size_t numArgs = 3 * m_synthDefs->size();
+                        size_t size = OSCPP::Size::message(address, numArgs);
+                        for (const auto& def : *m_synthDefs)
                         {
-                            stats.numSynths++;
+                            size += OSCPP::Size::string(std::strlen(def.first))
+                                  + OSCPP::Size::int32()
+                                  + OSCPP::Size::float32();
                         }
-                        else
+                        OSCPP::Client::DynamicPacket packet(size);
+                        packet.openMessage(address, numArgs);
+                        for (const auto& def : *m_synthDefs)
                         {
-                            stats = collectStatistics(subGroup, stats);
+                            const Utility::Profile::Counter profile = def.second->profile().value();
+                            packet.string(def.first);
+                            packet.int32(profile.calls);
+                            packet.float32(profile.ticks);
                         }
-                        cur = cur->next();
+                        packet.closeMessage();
+                        env->reply(m_requestId, packet);
+                        env->sendFromWorker(perform_rt_free, this);
                     }
 
-                    return stats;
-                }
-
-                CommandNodeTreeStatistics(Methcla_RequestId requestId, Statistics stats)
-                    : m_requestId(requestId)
-                    , m_stats(stats)
-                {
-                }
+                private:
+                    Methcla_RequestId  m_requestId;
+                    const SynthDefMap* m_synthDefs;
+                };
 
-                void perform(Environment* env)
+                const Methcla_RequestId requestId = args.int32();
+                sendToWorker<CommandSynthDefProfile>(requestId, &m_synthDefs);
+    #else
+                throwError(kMethcla_UnimplementedError, "Profiling is disabled in this build");
+    #endif
+            }
+            break;
+            case kCommand_EngineRealtimeMemoryStatistics:
+            {
+                class CommandRealtimeMemoryStatistics
                 {
-                    static const char* address = "/node/tree/statistics";
-                    OSCPP::Client::DynamicPacket packet(
-                        OSCPP::Size::message(address, 2)
-                      + OSCPP::Size::int32(2)
-                    );
-                    packet.openMessage(address, 2);
-                    packet.int32(m_stats.numGroups);
-                    packet.int32(m_stats.numSynths);
-                    packet.closeMessage();
-                    env->reply(m_requestId, packet);
-                    env->sendFromWorker(perform_rt_free, this);
-                }
-
-            private:
-                Methcla_RequestId m_requestId;
-                Statistics        m_stats;
-            };
+                public:
+                    CommandRealtimeMemoryStatistics(Methcla_RequestId requestId, const RTMemoryManager::Statistics& stats)
+                        : m_requestId(requestId)
+                        , m_stats(stats)
+                    {
+                    }
 
-            Methcla_RequestId requestId = args.int32();
+                    void perform(Environment* env)
+                    {
+                        static const char* address = "/engine/realtime-memory/statistics";
+                        OSCPP::Client::DynamicPacket packet(
+                            OSCPP::Size::message(address, 4)
+                          + OSCPP::Size::int32(4)
+                        );
+                        packet.openMessage(address, 4);
+                        packet.int32(m_stats.freeNumBytes);
+                        packet.int32(m_stats.usedNumBytes);
+                        packet.int32(m_stats.freeListHits);
+                        packet.int32(m_stats.freeListMisses);
+                        packet.closeMessage();
+                        env->reply(m_requestId, packet);
+                        env->sendFromWorker(perform_rt_free, this);
+                    }
 
-            CommandNodeTreeStatistics::Statistics stats =
-                CommandNodeTreeStatistics::collectStatistics(rootNode());
+                private:
+                    Methcla_RequestId           m_requestId;
+                    RTMemoryManager::Statistics m_stats;
+                };
 
-            sendToWorker<CommandNodeTreeStatistics>(requestId, stats);
-        }
-        else if (msg == "/engine/realtime-memory/statistics")
-        {
-            class CommandRealtimeMemoryStatistics
+                const Methcla_RequestId requestId = args.int32();
+                RTMemoryManager::Statistics stats(rtMem().statistics());
+                sendToWorker<CommandRealtimeMemoryStatistics>(requestId, stats);
+            }
+            break;
+            case kCommand_EngineLoadStatistics:
             {
-            public:
-                CommandRealtimeMemoryStatistics(Methcla_RequestId requestId, const RTMemoryManager::Statistics& stats)
-                    : m_requestId(requestId)
-                    , m_stats(stats)
+                class CommandLoadStatistics
                 {
-                }
+                public:
+                    CommandLoadStatistics(Methcla_RequestId requestId, const Methcla_EngineLoadStatistics& stats)
+                        : m_requestId(requestId)
+                        , m_stats(stats)
+                    {
+                    }
 
-                void perform(Environment* env)
-                {
-                    static const char* address = "/engine/realtime-memory/statistics";
-                    OSCPP::Client::DynamicPacket packet(
-                        OSCPP::Size::message(address, 2)
-                      + OSCPP::Size::int32(2)
-                    );
-                    packet.openMessage(address, 2);
-                    packet.int32(m_stats.freeNumBytes);
-                    packet.int32(m_stats.usedNumBytes);
-                    packet.closeMessage();
-                    env->reply(m_requestId, packet);
-                    env->sendFromWorker(perform_rt_free, this);
-                }
+                    void perform(Environment* env)
+                    {
+                        static const char* address = "/engine/load/statistics";
+                        const size_t numArgs = 4 + LoadMeter::kHistogramSize;
+                        OSCPP::Client::DynamicPacket packet(
+                            OSCPP::Size::message(address, numArgs)
+                          + OSCPP::Size::float32(2)
+                          + OSCPP::Size::int32(numArgs - 2)
+                        );
+                        packet.openMessage(address, numArgs);
+                        packet.float32(m_stats.load);
+                        packet.float32(m_stats.peak_load);
+                        packet.int32(m_stats.num_callbacks);
+                        packet.int32(m_stats.num_xruns);
+                        for (size_t i=0; i < LoadMeter::kHistogramSize; i++)
+                            packet.int32(m_stats.histogram[i]);
+                        packet.closeMessage();
+                        env->reply(m_requestId, packet);
+                        env->sendFromWorker(perform_rt_free, this);
+                    }
 
-            private:
-                Methcla_RequestId           m_requestId;
-                RTMemoryManager::Statistics m_stats;
-            };
+                private:
+                    Methcla_RequestId            m_requestId;
+                    Methcla_EngineLoadStatistics m_stats;
+                };
 
-            const Methcla_RequestId requestId = args.int32();
-            RTMemoryManager::Statistics stats(rtMem().statistics());
-            sendToWorker<CommandRealtimeMemoryStatistics>(requestId, stats);
+                const Methcla_RequestId requestId = args.int32();
+                sendToWorker<CommandLoadStatistics>(requestId, m_loadMeter.statistics());
+            }
+            break;
+            case kCommand_Plugin:
+            {
+                auto state = command.rest.state();
+                const Methcla_ErrorCode result = command.entry->perform(
+                    *m_owner, command.entry->data,
+                    std::get<0>(state).pos(), std::get<0>(state).consumable(),
+                    std::get<1>(state).pos(), std::get<1>(state).consumable()
+                );
+                if (result != kMethcla_NoError)
+                    throwError(result, methcla_error_code_description(result));
+            }
+            break;
         }
     }
     catch (std::exception& e)
     {
         std::stringstream s;
-        s << msg.address() << ": " << e.what();
+        s << command.entry->address << ": " << e.what();
         replyError(kMethcla_Notification, s.str().c_str());
     }
 }
 
 void EnvironmentImpl::registerSynthDef(const Methcla_SynthDef* def)
 {
-    auto synthDef = Memory::make_shared<SynthDef>(def);
+    auto synthDef = Memory::make_shared<SynthDef>(def, m_rtMem, m_synthInstancePoolSize);
     m_synthDefs[synthDef->uri()] = synthDef;
 }
 
+bool EnvironmentImpl::registerCommand(const char* address, Methcla_CommandFunction perform, void* data)
+{
+    return m_commands.insert(address, perform, data);
+}
+
 const shared_ptr<SynthDef>& EnvironmentImpl::synthDef(const char* uri) const
 {
     auto it = m_synthDefs.find(uri);
@@ -16,12 +16,20 @@
 #define METHCLA_AUDIO_ENGINE_IMPL_HPP_INCLUDED
 
 #include "Methcla/Audio/AudioBus.hpp"
+#include "Methcla/Audio/CommandTable.hpp"
 #include "Methcla/Audio/Group.hpp"
+#include "Methcla/Audio/ExecutionPlan.hpp"
+#include "Methcla/Audio/LoadMeter.hpp"
+#include "Methcla/Audio/NodeMap.hpp"
+#include "Methcla/Audio/ProcessContext.hpp"
 #include "Methcla/Audio/Synth.hpp"
+#include "Methcla/Audio/ThreadPool.hpp"
 #include "Methcla/Memory.hpp"
 #include "Methcla/Memory/Manager.hpp"
 #include "Methcla/Platform.hpp"
 #include "Methcla/Utility/MessageQueue.hpp"
+#include "Methcla/Utility/Ring.hpp"
+#include "Methcla/Utility/Spinlock.hpp"
 
 #include <methcla/log.hpp>
 
@@ -31,6 +39,7 @@
 #include <cassert>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 // OSC request with reference counting.
@@ -49,6 +58,61 @@ template <class T> static void perform_perform(Environment* env, void* data)
     static_cast<T*>(data)->perform(env);
 }
 
+//* Request message decoded and validated by the sender.
+struct Command
+{
+    static const size_t kMaxNumArgs = 5;
+
+    union Arg
+    {
+        int32_t i;
+        float   f;
+    };
+
+    //* Read the decoded scalar arguments in order.
+    class Args
+    {
+    public:
+        Args(const Arg* args)
+            : m_pos(args)
+        { }
+
+        int32_t int32()
+        {
+            return (m_pos++)->i;
+        }
+
+        float float32()
+        {
+            return (m_pos++)->f;
+        }
+
+    private:
+        const Arg* m_pos;
+    };
+
+    const CommandTable::Entry*  entry;
+    //* Synth definition named by the request, if any.
+    const SynthDef*             synthDef;
+    Arg                         args[kMaxNumArgs];
+    //* Arguments following the scalar arguments, parsed by the command itself.
+    OSCPP::Server::ArgStream    rest;
+    //* Message data, for logging.
+    const void*                 message;
+    size_t                      messageSize;
+};
+
+//* Consecutive commands of a request that are executed at the same time.
+struct CommandBundle
+{
+    //* Execution time, or 0 for immediate execution.
+    Methcla_Time time;
+    //* Execute immediately if time has already passed when the request is received.
+    bool         immediateIfDue;
+    size_t       begin;
+    size_t       end;
+};
+
 class Request
 {
     typedef size_t RefCount;
@@ -57,6 +121,9 @@ class Request
     RefCount*    m_refs;
     void*        m_packet;
     size_t       m_size;
+    std::vector<Command>        m_commands;
+    std::vector<CommandBundle>  m_bundles;
+    size_t                      m_numAudioBuses;
 
 public:
     Request()
@@ -64,12 +131,14 @@ public:
         , m_refs(nullptr)
         , m_packet(nullptr)
         , m_size(0)
+        , m_numAudioBuses(0)
     {
     }
 
     Request(Environment* env, const void* packet, size_t size)
         : m_env(env)
         , m_size(size)
+        , m_numAudioBuses(0)
     {
         // Allocate memory for packet and data block
         char* mem = Memory::allocOf<char>(sizeof(RefCount) + size);
@@ -100,6 +169,30 @@ public:
         return m_size;
     }
 
+    //* Decoded commands, in the order they appear in the packet.
+    std::vector<Command>& commands()
+    {
+        return m_commands;
+    }
+
+    //* Bundles of decoded commands, in the order they appear in the packet.
+    std::vector<CommandBundle>& bundles()
+    {
+        return m_bundles;
+    }
+
+    //* Return number of internal audio buses needed by the commands, i.e. the highest mapped bus id plus one.
+    size_t numAudioBuses() const
+    {
+        return m_numAudioBuses;
+    }
+
+    //* Record that the commands map the internal audio buses with an id less than `numBuses`.
+    void useAudioBuses(size_t numBuses)
+    {
+        m_numAudioBuses = std::max(m_numAudioBuses, numBuses);
+    }
+
     void retain()
     {
         if (m_refs != nullptr)
@@ -218,6 +311,10 @@ public:
 
     static const size_t kNumWorkerThreads = 2;
     static const size_t kQueueSize = 8192;
+    //* Capacity of the ring buffer for binary commands.
+    static const size_t kCommandRingSize = 16384;
+    //* Number of audio buses following the highest mapped bus that are prepared by `prepareAudioBuses` on the thread sending the request.
+    static const size_t kNumAudioBusesPreparedAhead = 32;
 
     Environment*                m_owner;
 
@@ -235,31 +332,63 @@ public:
     // NOTE: Worker needs to be constructed before and destroyed after node map (m_nodes).
     std::unique_ptr<Environment::Worker> m_worker;
 
+    //* Bundle of a request or binary command (if m_request is nullptr) waiting for its time.
     struct ScheduledBundle
     {
-        ScheduledBundle(Request* request, const OSCPP::Server::Bundle& bundle)
+        ScheduledBundle(Request* request, size_t bundle)
             : m_request(request)
             , m_bundle(bundle)
         { }
 
-        Request*              m_request;
-        OSCPP::Server::Bundle m_bundle;
+        ScheduledBundle(const Methcla_EngineCommand& command)
+            : m_request(nullptr)
+            , m_bundle(0)
+            , m_command(command)
+        { }
+
+        Request*                m_request;
+        size_t                  m_bundle;
+        Methcla_EngineCommand   m_command;
     };
 
     Scheduler<ScheduledBundle>  m_scheduler;
+    Utility::Ring<Methcla_EngineCommand> m_commandRing;
 
     std::vector<Memory::shared_ptr<ExternalAudioBus>>   m_externalAudioInputs;
     std::vector<Memory::shared_ptr<ExternalAudioBus>>   m_externalAudioOutputs;
-    std::vector<Memory::shared_ptr<AudioBus>>           m_internalAudioBuses;
+    AudioBusArena                                       m_audioBuses;
+    std::mutex                                          m_audioBusesMutex;
+    std::vector<sample_t>                               m_controlBuses;
 
     Epoch                                               m_epoch;
     Methcla_Time                                        m_currentTime;
 
-    std::vector<Node*>                                  m_nodes;
+    NodeMap                                             m_nodes;
+    const size_t                                        m_maxNumNodes;
     Group*                                              m_rootNode;
+    ExecutionPlan                                       m_plan;
+
+    // Parallel processing (only when helper threads are configured)
+    std::unique_ptr<ThreadPool>                         m_threadPool;
+    Utility::Spinlock                                   m_sendLock;
+    Utility::Spinlock                                   m_doneLock;
+
+    const size_t                                        m_synthInstancePoolSize;
+    const size_t                                        m_numSynthScratchBuffers;
+
+    // Freed nodes waiting to be destroyed
+    Node*                                               m_freedNodes;
+    Node*                                               m_lastFreedNode;
+    const size_t                                        m_maxNumNodeDestroysPerBlock;
+
+    LoadMeter                                           m_loadMeter;
 
     SynthDefMap                                         m_synthDefs;
     std::list<const Methcla_SoundFileAPI*>              m_soundFileAPIs;
+    CommandTable                                        m_commands;
+    // Commands executed by binary commands, resolved after plugins have been loaded.
+    const CommandTable::Entry*                          m_nodeSetCommand;
+    const CommandTable::Entry*                          m_busControlSetCommand;
 
     std::atomic<int>                                    m_logLevel;
     std::atomic<int>                                    m_logFlags;
@@ -275,16 +404,26 @@ public:
         return m_rootNode;
     }
 
-    bool isValid(NodeId nodeId) const
-    {
-        return nodeId >= 0 && (size_t)nodeId < m_nodes.size();
-    }
-
     Methcla_Time currentTime() const
     {
         return m_currentTime;
     }
 
+    //* Return internal audio bus with `id`.
+    //
+    // The bus must have been prepared by `prepareAudioBuses` before the command mapping it was sent.
+    //
+    // @throw std::out_of_range
+    // @throw Methcla::Error
+    //
+    // Context: RT
+    AudioBus* audioBus(AudioBusId id);
+
+    //* Prepare the memory of the internal audio buses with an id less than `numBuses` and of the buses following them.
+    //
+    // Context: NRT, any thread
+    void prepareAudioBuses(size_t numBuses);
+
     Memory::RTMemoryManager& rtMem()
     {
         return m_rtMem;
@@ -293,12 +432,43 @@ public:
     void registerSynthDef(const Methcla_SynthDef* def);
     const Memory::shared_ptr<SynthDef>& synthDef(const char* uri) const;
 
+    //* Register a plugin command handler for OSC requests with `address`.
+    //
+    // Returns false if the address is already registered.
+    //
+    // Context: NRT
+    bool registerCommand(const char* address, Methcla_CommandFunction perform, void* data);
+
     void process(Methcla_Time currentTime, size_t numFrames, const sample_t* const* inputs, sample_t* const* outputs);
+    //* Process numFrames frames starting at offset in the current block.
+    void processFrames(size_t offset, size_t numFrames, const sample_t* const* inputs, sample_t* const* outputs);
 
     void processRequests(Methcla_EngineLogFlags logFlags, const Methcla_Time currentTime);
     void processScheduler(Methcla_EngineLogFlags logFlags, const Methcla_Time currentTime, const Methcla_Time nextTime);
-    void processBundle(Methcla_EngineLogFlags logFlags, Request* request, const OSCPP::Server::Bundle& bundle, const Methcla_Time scheduleTime, const Methcla_Time currentTime);
-    void processMessage(Methcla_EngineLogFlags logFlags, const OSCPP::Server::Message& msg, const Methcla_Time scheduleTime, const Methcla_Time currentTime);
+    void processBundle(Methcla_EngineLogFlags logFlags, Request* request, const CommandBundle& bundle);
+    //* Execute binary commands that take effect before nextTime and schedule the others.
+    void processCommandRing(Methcla_EngineLogFlags logFlags, const Methcla_Time nextTime);
+    void processEngineCommand(Methcla_EngineLogFlags logFlags, const Methcla_EngineCommand& engineCommand);
+    void processCommand(Methcla_EngineLogFlags logFlags, const Command& command);
+
+    //* Decode the OSC packet of request into commands and check their arguments.
+    //
+    // Only checks that don't depend on the state of the node tree are performed here.
+    //
+    // @throw Methcla::Error
+    //
+    // Context: NRT, any thread
+    void decodeRequest(Request* request) const;
+    void decodePacket(Request* request, const OSCPP::Server::Packet& packet, const CommandBundle* parent) const;
+    void decodeMessage(Request* request, const OSCPP::Server::Packet& packet) const;
+
+    //* Check binary commands and write them to the command ring.
+    //
+    // @throw Methcla::Error
+    // @throw std::runtime_error
+    //
+    // Context: NRT, any thread
+    void sendCommands(const Methcla_EngineCommand* commands, size_t numCommands);
 
     void sendToWorker(PerformFunc f, void* data)
     {
@@ -306,6 +476,8 @@ public:
         cmd.m_env = m_owner;
         cmd.m_perform = f;
         cmd.m_data = data;
+        // Serialize commands sent from helper threads.
+        std::lock_guard<Utility::Spinlock> lock(m_sendLock);
         m_worker->sendToWorker(cmd);
     }
 
@@ -386,9 +558,7 @@ public:
     //* Context: RT
     void notifyNodeDone(NodeId nodeId)
     {
-        if (isValid(nodeId)) {
-            sendToWorker<NodeDoneNotification>(nodeId);
-        }
+        sendToWorker<NodeDoneNotification>(nodeId);
     }
 
     class NodeEndedNotification : public NodeNotification
@@ -413,15 +583,37 @@ public:
         }
     };
 
+    //* Context: RT
+    void synthDone(Synth* synth)
+    {
+        // Done actions of synths processed concurrently might touch the same nodes.
+        std::lock_guard<Utility::Spinlock> lock(m_doneLock);
+        synth->setDone();
+    }
+
     //* Context: RT
     void nodeEnded(NodeId nodeId)
     {
-        if (isValid(nodeId)) {
-            m_nodes[nodeId] = nullptr;
-            sendToWorker<NodeEndedNotification>(nodeId);
-        }
+        m_nodes.remove(nodeId);
+        sendToWorker<NodeEndedNotification>(nodeId);
     }
 
+    //* Context: RT
+    void destroyLater(Node* node)
+    {
+        assert( node->m_parent == nullptr && node->m_prev == nullptr && node->m_next == nullptr );
+        if (m_lastFreedNode == nullptr)
+            m_freedNodes = node;
+        else
+            m_lastFreedNode->m_next = node;
+        m_lastFreedNode = node;
+    }
+
+    //* Destroy up to `maxNumNodes` freed nodes in the order they were freed, or all of them if `maxNumNodes` is zero.
+    //
+    // Context: RT
+    void destroyFreedNodes(size_t maxNumNodes);
+
     //* Context: NRT
     void reply(Methcla_RequestId requestId, const void* packet, size_t size)
     {
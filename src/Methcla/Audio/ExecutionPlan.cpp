@@ -0,0 +1,434 @@
+// Copyright 2012-2014 Samplecount S.L.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Methcla/Audio/ExecutionPlan.hpp"
+#include "Methcla/Audio/Engine.hpp"
+#include "Methcla/Audio/Group.hpp"
+#include "Methcla/Audio/Synth.hpp"
+#include "Methcla/Audio/ThreadPool.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace Methcla::Audio;
+
+ExecutionPlan::ExecutionPlan(size_t maxNumNodes, size_t blockSize, bool parallel, size_t numScratchBuffers)
+    : m_parallel(parallel)
+    , m_valid(false)
+    , m_stamp(0)
+    , m_chunkStamp(0)
+    , m_minLevel(0)
+    , m_numLevels(0)
+    , m_levelBegin(0)
+    , m_numFrames(0)
+{
+    m_steps.reserve(maxNumNodes);
+    m_levels.reserve(maxNumNodes);
+    m_order.reserve(maxNumNodes);
+    m_levelEnd.reserve(maxNumNodes);
+    m_levelChunks.reserve(maxNumNodes);
+    if (parallel) {
+        for (size_t i=0; i < kMaxNumChunksPerLevel; i++) {
+            m_chunkContexts.emplace_back(new ProcessContext(kMaxNumPartialSums, blockSize));
+        }
+    } else {
+        // Synths in a parallel plan may be processed through any context, so scratch buffers are only used serially.
+        m_directContext.allocScratchBuffers(numScratchBuffers, blockSize);
+    }
+}
+
+void ExecutionPlan::addStep(Node* node, uint32_t numNodes, bool isChunk, uint32_t level)
+{
+    Step step;
+    step.node = node;
+    step.process = isChunk ? processNodes : processSynth;
+    step.numNodes = numNodes;
+    // Chunk indices are assigned per level when sorting.
+    step.chunk = isChunk ? 0 : -1;
+    m_steps.push_back(step);
+    m_levels.push_back(level);
+    if (isChunk) {
+        if (level >= m_levelChunks.size())
+            m_levelChunks.resize(level + 1, 0);
+        m_levelChunks[level]++;
+    }
+    m_numLevels = std::max(m_numLevels, level + 1);
+}
+
+void ExecutionPlan::collect(Group* group)
+{
+    Node* node = group->first();
+    while (node != nullptr) {
+        // Store pointer to next node because current node might be freed.
+        Node* nextNode = node->next();
+        if (node->isDone()) {
+            node->free();
+        } else if (!node->isRunning()) {
+            // Paused nodes are not part of the plan, but done nodes in paused groups are still freed.
+            if (node->isGroup())
+                freeDone(static_cast<Group*>(node));
+        } else if (node->isGroup()) {
+            Group* subGroup = static_cast<Group*>(node);
+            if (m_parallel && subGroup->isParallel())
+                collectParallel(subGroup);
+            else
+                collect(subGroup);
+        } else if (node->isSynth()) {
+            Synth* synth = static_cast<Synth*>(node);
+            if (synth->isActive()) {
+                uint32_t level = 0;
+                if (!m_parallel) {
+                    // All synths are processed in tree order.
+                } else if (isBarrier(synth)) {
+                    level = m_numLevels;
+                    m_minLevel = level + 1;
+                } else {
+                    level = levelOf(synth, m_minLevel);
+                }
+                if (m_parallel)
+                    updateBuses(synth, level);
+                addStep(synth, 1, false, level);
+            }
+        }
+        node = nextNode;
+    }
+}
+
+void ExecutionPlan::freeDone(Group* group)
+{
+    Node* node = group->first();
+    while (node != nullptr) {
+        Node* nextNode = node->next();
+        if (node->isDone())
+            node->free();
+        else if (node->isGroup())
+            freeDone(static_cast<Group*>(node));
+        node = nextNode;
+    }
+}
+
+void ExecutionPlan::collectParallel(Group* group)
+{
+    // The group as a whole depends on all buses accessed in its sub-tree.
+    uint32_t level = m_minLevel;
+    size_t numNodes = 0;
+    Node* node = group->first();
+    while (node != nullptr) {
+        Node* nextNode = node->next();
+        if (node->isDone()) {
+            node->free();
+        } else {
+            // Free done nodes in sub-groups, including paused ones that are not processed.
+            if (node->isGroup())
+                freeDone(static_cast<Group*>(node));
+            level = levelOf(node, level);
+            numNodes++;
+        }
+        node = nextNode;
+    }
+
+    // Split children into chunks of consecutive nodes; the chunk boundaries only depend on the number of children.
+    const size_t numChunks = std::min(numNodes, kMaxNumChunksPerGroup);
+    if (!fitsChunks(group, numNodes, numChunks, level)) {
+        // Processing the children in tree order gives the same result as processing them in parallel.
+        collect(group);
+        return;
+    }
+    node = group->first();
+    for (size_t i=0; i < numChunks; i++) {
+        const size_t chunkSize = (i + 1) * numNodes / numChunks - i * numNodes / numChunks;
+        addStep(node, chunkSize, true, level);
+        for (size_t k=0; k < chunkSize; k++) {
+            updateBuses(node, level);
+            node = node->next();
+        }
+    }
+}
+
+bool ExecutionPlan::fitsChunks(Group* group, size_t numNodes, size_t numChunks, uint32_t level)
+{
+    const size_t numLevelChunks = level < m_levelChunks.size() ? m_levelChunks[level] : 0;
+    if (numLevelChunks + numChunks > kMaxNumChunksPerLevel)
+        return false;
+    Node* node = group->first();
+    for (size_t i=0; i < numChunks; i++) {
+        const size_t chunkSize = (i + 1) * numNodes / numChunks - i * numNodes / numChunks;
+        if (++m_chunkStamp == 0) m_chunkStamp = 1;
+        size_t numBuses = 0;
+        for (size_t k=0; k < chunkSize; k++) {
+            // Done actions of a barrier modify nodes in other chunks, which are processed concurrently.
+            if (containsBarrier(node))
+                return false;
+            numBuses = countOutputBuses(node, numBuses);
+            node = node->next();
+        }
+        if (numBuses > kMaxNumPartialSums)
+            return false;
+    }
+    return true;
+}
+
+size_t ExecutionPlan::countOutputBuses(const Node* node, size_t count)
+{
+    if (node->isDone() || !node->isRunning()) {
+        return count;
+    } else if (node->isGroup()) {
+        for (const Node* child = static_cast<const Group*>(node)->first(); child != nullptr; child = child->next()) {
+            count = countOutputBuses(child, count);
+        }
+    } else if (node->isSynth()) {
+        const Synth* synth = static_cast<const Synth*>(node);
+        if (synth->isActive()) {
+            for (Methcla_PortCount i=0; i < synth->numConnectedAudioOutputs(); i++) {
+                AudioBus* bus = synth->audioOutputConnection(i).bus();
+                if (bus != nullptr && bus->m_scheduleChunk != m_chunkStamp) {
+                    bus->m_scheduleChunk = m_chunkStamp;
+                    count++;
+                }
+            }
+        }
+    }
+    return count;
+}
+
+bool ExecutionPlan::containsBarrier(const Node* node)
+{
+    if (node->isDone() || !node->isRunning()) {
+        return false;
+    } else if (node->isGroup()) {
+        for (const Node* child = static_cast<const Group*>(node)->first(); child != nullptr; child = child->next()) {
+            if (containsBarrier(child))
+                return true;
+        }
+    } else if (node->isSynth()) {
+        const Synth* synth = static_cast<const Synth*>(node);
+        return synth->isActive() && isBarrier(synth);
+    }
+    return false;
+}
+
+AudioBus* ExecutionPlan::touch(AudioBus* bus)
+{
+    // Reset dependency state of buses not seen since the last build.
+    if (bus->m_scheduleStamp != m_stamp) {
+        bus->m_scheduleStamp = m_stamp;
+        bus->m_scheduleReadLevel = 0;
+        bus->m_scheduleWriteLevel = 0;
+    }
+    return bus;
+}
+
+// Bus levels are stored as level + 1, zero meaning that the bus hasn't been accessed yet.
+
+uint32_t ExecutionPlan::levelOf(const Synth* synth, uint32_t minLevel)
+{
+    uint32_t level = minLevel;
+    for (Methcla_PortCount i=0; i < synth->numConnectedAudioInputs(); i++) {
+        AudioBus* bus = synth->audioInputConnection(i).bus();
+        if (bus != nullptr) {
+            touch(bus);
+            level = std::max(level, bus->m_scheduleWriteLevel);
+        }
+    }
+    for (Methcla_PortCount i=0; i < synth->numConnectedAudioOutputs(); i++) {
+        AudioBus* bus = synth->audioOutputConnection(i).bus();
+        if (bus != nullptr) {
+            touch(bus);
+            level = std::max(level, std::max(bus->m_scheduleWriteLevel, bus->m_scheduleReadLevel));
+        }
+    }
+    return level;
+}
+
+uint32_t ExecutionPlan::levelOf(const Node* node, uint32_t minLevel)
+{
+    uint32_t level = minLevel;
+    if (node->isDone() || !node->isRunning()) {
+        return level;
+    } else if (node->isGroup()) {
+        for (const Node* child = static_cast<const Group*>(node)->first(); child != nullptr; child = child->next()) {
+            level = levelOf(child, level);
+        }
+    } else if (node->isSynth()) {
+        const Synth* synth = static_cast<const Synth*>(node);
+        if (synth->isActive())
+            level = levelOf(synth, level);
+    }
+    return level;
+}
+
+void ExecutionPlan::updateBuses(const Synth* synth, uint32_t level)
+{
+    for (Methcla_PortCount i=0; i < synth->numConnectedAudioInputs(); i++) {
+        AudioBus* bus = synth->audioInputConnection(i).bus();
+        if (bus != nullptr) {
+            touch(bus);
+            bus->m_scheduleReadLevel = std::max(bus->m_scheduleReadLevel, level + 1);
+        }
+    }
+    for (Methcla_PortCount i=0; i < synth->numConnectedAudioOutputs(); i++) {
+        AudioBus* bus = synth->audioOutputConnection(i).bus();
+        if (bus != nullptr) {
+            touch(bus);
+            bus->m_scheduleWriteLevel = level + 1;
+        }
+    }
+}
+
+void ExecutionPlan::updateBuses(const Node* node, uint32_t level)
+{
+    if (node->isDone() || !node->isRunning()) {
+        return;
+    } else if (node->isGroup()) {
+        for (const Node* child = static_cast<const Group*>(node)->first(); child != nullptr; child = child->next()) {
+            updateBuses(child, level);
+        }
+    } else if (node->isSynth()) {
+        const Synth* synth = static_cast<const Synth*>(node);
+        if (synth->isActive())
+            updateBuses(synth, level);
+    }
+}
+
+bool ExecutionPlan::isBarrier(const Synth* synth)
+{
+    // Done actions other than freeing the synth itself affect other nodes and need to be ordered with respect to all preceding and following synths.
+    // Control port mappings aren't tracked per bus; synths with mapped control ports are ordered like barriers.
+    return (synth->doneFlags() & ~(kMethcla_NodeDoneFreeSelf | kMethcla_NodeDoneNotify)) != 0
+        || synth->hasControlMappings();
+}
+
+void ExecutionPlan::build(Group* root)
+{
+    m_steps.clear();
+    m_levels.clear();
+    m_order.clear();
+    m_levelEnd.clear();
+    m_levelChunks.clear();
+    m_minLevel = 0;
+    m_numLevels = 0;
+
+    if (++m_stamp == 0) m_stamp = 1;
+
+    collect(root);
+
+    // Sort steps by level, preserving tree order within each level.
+    m_levelEnd.assign(m_numLevels, 0);
+    for (uint32_t level : m_levels) {
+        m_levelEnd[level]++;
+    }
+    size_t offset = 0;
+    for (size_t& x : m_levelEnd) {
+        const size_t count = x;
+        x = offset;
+        offset += count;
+    }
+    m_order.resize(m_steps.size());
+    for (size_t i=0; i < m_steps.size(); i++) {
+        m_order[m_levelEnd[m_levels[i]]++] = m_steps[i];
+    }
+
+    // Assign chunk contexts in tree order within each level.
+    size_t begin = 0;
+    for (size_t end : m_levelEnd) {
+        int32_t chunk = 0;
+        for (size_t i=begin; i < end; i++) {
+            Step& step = m_order[i];
+            if (step.chunk >= 0) {
+                assert( (size_t)chunk < kMaxNumChunksPerLevel );
+                step.chunk = chunk++;
+            }
+        }
+        begin = end;
+    }
+}
+
+void ExecutionPlan::update(Group* root)
+{
+    if (!isValid()) {
+        build(root);
+        // Freeing done nodes while building invalidates the plan again.
+        m_valid.store(true, std::memory_order_relaxed);
+    }
+}
+
+void ExecutionPlan::processSynth(const Step& step, ProcessContext& context, size_t numFrames)
+{
+    // Synths might have been flagged by a done action earlier in the same block; they are freed when the plan is rebuilt.
+    if (!step.node->isDone()) {
+        static_cast<Synth*>(step.node)->Synth::doProcess(context, numFrames);
+    }
+}
+
+void ExecutionPlan::processNodes(const Step& step, ProcessContext& context, size_t numFrames)
+{
+    Node* node = step.node;
+    for (uint32_t i=0; i < step.numNodes; i++) {
+        if (!node->isDone() && node->isRunning()) {
+            node->doProcess(context, numFrames);
+        }
+        node = node->next();
+    }
+}
+
+inline void ExecutionPlan::processStep(const Step& step)
+{
+    ProcessContext& context = step.chunk < 0 ? m_directContext : *m_chunkContexts[step.chunk];
+    step.process(step, context, m_numFrames);
+}
+
+void ExecutionPlan::processTask(void* data, size_t index)
+{
+    ExecutionPlan* self = static_cast<ExecutionPlan*>(data);
+    self->processStep(self->m_order[self->m_levelBegin + index]);
+}
+
+void ExecutionPlan::process(const Environment& env, ThreadPool* pool, size_t numFrames)
+{
+    m_numFrames = numFrames;
+    m_levelBegin = 0;
+
+    bool awake = false;
+
+    for (size_t levelEnd : m_levelEnd) {
+        const size_t numSteps = levelEnd - m_levelBegin;
+        if (pool == nullptr || numSteps == 1) {
+            for (size_t i=m_levelBegin; i < levelEnd; i++) {
+                processStep(m_order[i]);
+            }
+        } else {
+            if (!awake) {
+                pool->wakeup();
+                awake = true;
+            }
+            pool->run(processTask, this, numSteps);
+        }
+
+        // Sum up partial results in chunk order
+        if (m_parallel) {
+            for (size_t i=m_levelBegin; i < levelEnd; i++) {
+                const int32_t chunk = m_order[i].chunk;
+                if (chunk >= 0) {
+                    m_chunkContexts[chunk]->reduce(env, numFrames);
+                }
+            }
+        }
+
+        m_levelBegin = levelEnd;
+    }
+
+    if (awake) {
+        pool->sleep();
+    }
+}
@@ -0,0 +1,151 @@
+// Copyright 2012-2014 Samplecount S.L.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef METHCLA_AUDIO_EXECUTIONPLAN_HPP_INCLUDED
+#define METHCLA_AUDIO_EXECUTIONPLAN_HPP_INCLUDED
+
+#include "Methcla/Audio/ProcessContext.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Methcla { namespace Audio {
+
+class AudioBus;
+class Environment;
+class Group;
+class Node;
+class Synth;
+class ThreadPool;
+
+//* Flattened representation of the node tree used for processing.
+//
+// The plan is a contiguous array of processing steps in node tree order, so that processing doesn't need to chase pointers through the tree or check groups that are done. It is rebuilt before processing only after it has been invalidated by a change to the node tree, to the state of a node or to the bus mappings of a synth.
+//
+// When processing in parallel, synths are assigned to levels based on the buses they read from and write to: A synth is placed in a level after all preceding synths (in node tree order) that write to a bus it reads or writes, and after all preceding synths that read from a bus it writes to. Synths within a level are independent of each other and can be processed in any order, while the relative order of dependent synths is preserved. Processing the levels in order therefore yields the same result as processing the tree serially.
+//
+// The children of a parallel group are declared independent by the client; they are all placed in the same level, after any synths the group as a whole depends on. The children are split into a fixed number of chunks of consecutive nodes, each of which is processed serially as a single task. Every chunk accumulates its outputs into partial sums, which are reduced into the buses in chunk order after the level has finished, so that the result doesn't depend on the number of threads or on the order in which tasks are executed. A parallel group whose chunks would need more partial sums than are available, or that contains a synth with done actions affecting other nodes or with mapped control ports, is scheduled like a plain group.
+class ExecutionPlan
+{
+public:
+    //* Create a plan for up to `maxNumNodes` nodes and blocks of up to `blockSize` frames.
+    //
+    // If `parallel` is true, the plan is prepared for processing with a thread pool. Otherwise all steps are processed through a single context with `numScratchBuffers` scratch buffers for staging synth audio ports.
+    ExecutionPlan(size_t maxNumNodes, size_t blockSize, bool parallel, size_t numScratchBuffers=0);
+
+    ExecutionPlan(const ExecutionPlan&) = delete;
+    ExecutionPlan& operator=(const ExecutionPlan&) = delete;
+
+    //* Mark the plan as out of date.
+    //
+    // Context: RT (any processing thread)
+    void invalidate()
+    {
+        m_valid.store(false, std::memory_order_relaxed);
+    }
+
+    //* Return true if the plan is up to date.
+    bool isValid() const
+    {
+        return m_valid.load(std::memory_order_relaxed);
+    }
+
+    //* Free nodes that are done and rebuild the plan for the tree rooted at `root` if it has been invalidated.
+    //
+    // The whole plan is rebuilt, in time linear in the number of nodes, because a change to the buses accessed by one synth can move any of the synths following it to a different level.
+    //
+    // Context: RT
+    void update(Group* root);
+
+    //* Process the plan, distributing independent steps over the threads in `pool` in parallel mode.
+    //
+    // Context: RT
+    void process(const Environment& env, ThreadPool* pool, size_t numFrames);
+
+    //* Return number of steps in the plan.
+    size_t numSteps() const
+    {
+        return m_steps.size();
+    }
+
+    //* Return number of levels in the plan.
+    size_t numLevels() const
+    {
+        return m_levelEnd.size();
+    }
+
+    //* Maximum number of chunks a parallel group is split into.
+    static const size_t kMaxNumChunksPerGroup = 16;
+    //* Maximum number of chunks per level.
+    static const size_t kMaxNumChunksPerLevel = 32;
+    //* Maximum number of distinct buses a chunk can write to.
+    static const size_t kMaxNumPartialSums = 4;
+
+private:
+    struct Step;
+    typedef void (*ProcessFunc)(const Step& step, ProcessContext& context, size_t numFrames);
+
+    struct Step
+    {
+        // First node and number of consecutive sibling nodes to process
+        Node*       node;
+        ProcessFunc process;
+        uint32_t    numNodes;
+        // Index of the chunk context or -1 if the step writes to buses directly
+        int32_t     chunk;
+    };
+
+    void build(Group* root);
+    void collect(Group* group);
+    void collectParallel(Group* group);
+    void freeDone(Group* group);
+    bool fitsChunks(Group* group, size_t numNodes, size_t numChunks, uint32_t level);
+    size_t countOutputBuses(const Node* node, size_t count);
+    static bool containsBarrier(const Node* node);
+    void addStep(Node* node, uint32_t numNodes, bool isChunk, uint32_t level);
+    uint32_t levelOf(const Synth* synth, uint32_t minLevel);
+    uint32_t levelOf(const Node* node, uint32_t minLevel);
+    void updateBuses(const Synth* synth, uint32_t level);
+    void updateBuses(const Node* node, uint32_t level);
+    AudioBus* touch(AudioBus* bus);
+    static bool isBarrier(const Synth* synth);
+    static void processSynth(const Step& step, ProcessContext& context, size_t numFrames);
+    static void processNodes(const Step& step, ProcessContext& context, size_t numFrames);
+    void processStep(const Step& step);
+    static void processTask(void* data, size_t index);
+
+private:
+    const bool              m_parallel;
+    std::atomic<bool>       m_valid;
+    std::vector<Step>       m_steps;
+    std::vector<uint32_t>   m_levels;
+    std::vector<Step>       m_order;
+    std::vector<size_t>     m_levelEnd;
+    std::vector<uint32_t>   m_levelChunks;
+    ProcessContext          m_directContext;
+    std::vector<std::unique_ptr<ProcessContext>> m_chunkContexts;
+    uint32_t                m_stamp;
+    uint32_t                m_chunkStamp;
+    uint32_t                m_minLevel;
+    uint32_t                m_numLevels;
+    size_t                  m_levelBegin;
+    size_t                  m_numFrames;
+};
+
+} }
+
+#endif // METHCLA_AUDIO_EXECUTIONPLAN_HPP_INCLUDED
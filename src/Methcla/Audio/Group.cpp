@@ -41,7 +41,37 @@ Group::Group(Environment& env, NodeId nodeId)
 
 Group::~Group()
 {
-    freeAll();
+    // Children are handed over to deferred destruction by destroy.
+    BOOST_ASSERT(isEmpty());
+}
+
+#if METHCLA_PROFILING
+Methcla::Utility::Profile::Counter Group::profile() const
+{
+    Methcla::Utility::Profile::Counter result;
+    for (const Node* node = m_first; node != nullptr; node = node->m_next) {
+        result += node->profile();
+    }
+    return result;
+}
+#endif
+
+void Group::end()
+{
+    Node::end();
+    for (Node* node = m_first; node != nullptr; node = node->m_next) {
+        node->end();
+    }
+}
+
+void Group::destroy()
+{
+    while (m_first != nullptr) {
+        Node* node = m_first;
+        remove(node);
+        env().destroyLater(node);
+    }
+    Node::destroy();
 }
 
 Group* Group::construct(Environment& env, NodeId nodeId)
@@ -49,13 +79,13 @@ Group* Group::construct(Environment& env, NodeId nodeId)
     return new (env.rtMem().alloc(sizeof(Group))) Group(env, nodeId);
 }
 
-void Group::doProcess(size_t numFrames)
+void Group::doProcess(ProcessContext& context, size_t numFrames)
 {
     Node* node = m_first;
     while (node != nullptr) {
         // Store pointer to next node because current node might be destroyed by done action after process.
         Node* nextNode = node->m_next;
-        node->process(numFrames);
+        node->process(context, numFrames);
         node = nextNode;
     }
 }
@@ -78,6 +108,8 @@ void Group::addToHead(Node* node)
     }
 
     METHCLA_ASSERT_NODE_IS_LINKED(node);
+
+    env().invalidateExecutionPlan();
 }
 
 void Group::addToTail(Node* node)
@@ -98,6 +130,8 @@ void Group::addToTail(Node* node)
     }
 
     METHCLA_ASSERT_NODE_IS_LINKED(node);
+
+    env().invalidateExecutionPlan();
 }
 
 void Group::addBefore(Node* target, Node* node)
@@ -119,6 +153,8 @@ void Group::addBefore(Node* target, Node* node)
     }
 
     METHCLA_ASSERT_NODE_IS_LINKED(node);
+
+    env().invalidateExecutionPlan();
 }
 
 void Group::addAfter(Node* target, Node* node)
@@ -140,6 +176,8 @@ void Group::addAfter(Node* target, Node* node)
     }
 
     METHCLA_ASSERT_NODE_IS_LINKED(node);
+
+    env().invalidateExecutionPlan();
 }
 
 void Group::remove(Node* node)
@@ -167,6 +205,8 @@ void Group::remove(Node* node)
     node->m_parent = nullptr;
     node->m_prev = nullptr;
     node->m_next = nullptr;
+
+    env().invalidateExecutionPlan();
 }
 
 bool Group::isEmpty() const
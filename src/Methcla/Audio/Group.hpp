@@ -31,6 +31,9 @@ public:
 
     virtual bool isGroup() const override { return true; }
 
+    //* Return true if the children of this group may be processed concurrently.
+    virtual bool isParallel() const { return false; }
+
     bool isEmpty() const;
 
     void addToHead(Node* node);
@@ -40,11 +43,22 @@ public:
 
     void freeAll();
 
-private:
+#if METHCLA_PROFILING
+    virtual Utility::Profile::Counter profile() const override;
+#endif
+
+protected:
     Group(Environment& env, NodeId nodeId);
     ~Group();
 
-    virtual void doProcess(size_t numFrames) override;
+    //* End this group and all nodes in its sub-tree.
+    virtual void end() override;
+
+    //* Queue the children for deferred destruction and destroy the group.
+    virtual void destroy() override;
+
+private:
+    virtual void doProcess(ProcessContext& context, size_t numFrames) override;
 
 private:
     friend class Node;
@@ -0,0 +1,71 @@
+// Copyright 2012-2014 Samplecount S.L.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Methcla/Audio/LoadMeter.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Methcla::Audio;
+
+// Time constant in seconds of the smoothed load.
+static const double kLoadTimeConstant = 1.;
+
+LoadMeter::LoadMeter()
+    : m_load(0.)
+    , m_peakLoad(0.)
+    , m_numCallbacks(0)
+    , m_numXruns(0)
+{
+    for (auto& bin : m_histogram)
+        bin.store(0, std::memory_order_relaxed);
+}
+
+void LoadMeter::update(Clock::time_point begin, double duration)
+{
+    if (duration <= 0.)
+        return;
+
+    const double elapsed = std::chrono::duration<double>(Clock::now() - begin).count();
+    const double load = elapsed / duration;
+
+    // Only the audio thread writes, so relaxed loads and stores are sufficient.
+    const double coeff = 1. - std::exp(-duration / kLoadTimeConstant);
+    const double prevLoad = m_load.load(std::memory_order_relaxed);
+    m_load.store(prevLoad + coeff * (load - prevLoad), std::memory_order_relaxed);
+
+    if (load > m_peakLoad.load(std::memory_order_relaxed))
+        m_peakLoad.store(load, std::memory_order_relaxed);
+
+    m_numCallbacks.fetch_add(1, std::memory_order_relaxed);
+
+    if (load >= 1.)
+        m_numXruns.fetch_add(1, std::memory_order_relaxed);
+
+    // Bins of equal width cover loads in [0,1), the last bin counts overruns.
+    const size_t bin = std::min<size_t>(load * (kHistogramSize - 1), kHistogramSize - 1);
+    m_histogram[bin].fetch_add(1, std::memory_order_relaxed);
+}
+
+Methcla_EngineLoadStatistics LoadMeter::statistics() const
+{
+    Methcla_EngineLoadStatistics result;
+    result.load = m_load.load(std::memory_order_relaxed);
+    result.peak_load = m_peakLoad.load(std::memory_order_relaxed);
+    result.num_callbacks = m_numCallbacks.load(std::memory_order_relaxed);
+    result.num_xruns = m_numXruns.load(std::memory_order_relaxed);
+    for (size_t i=0; i < kHistogramSize; i++)
+        result.histogram[i] = m_histogram[i].load(std::memory_order_relaxed);
+    return result;
+}
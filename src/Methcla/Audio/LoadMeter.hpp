@@ -0,0 +1,61 @@
+// Copyright 2012-2014 Samplecount S.L.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef METHCLA_AUDIO_LOADMETER_HPP_INCLUDED
+#define METHCLA_AUDIO_LOADMETER_HPP_INCLUDED
+
+#include <methcla/engine.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace Methcla { namespace Audio {
+
+//* Measure the DSP load of the audio callback.
+//
+// The load is the wall clock time spent processing a buffer relative to the duration of the audio it contains. Measurements are written by the audio thread and can be read concurrently from any other thread.
+class LoadMeter
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    static const size_t kHistogramSize = kMethcla_EngineLoadHistogramSize;
+
+    LoadMeter();
+
+    LoadMeter(const LoadMeter&) = delete;
+    LoadMeter& operator=(const LoadMeter&) = delete;
+
+    //* Record a callback that started at `begin` and processed `duration` seconds of audio.
+    //
+    // Context: RT
+    void update(Clock::time_point begin, double duration);
+
+    //* Return a snapshot of the load statistics.
+    //
+    // Counters are read individually and might be slightly out of sync with each other.
+    Methcla_EngineLoadStatistics statistics() const;
+
+private:
+    std::atomic<double>     m_load;
+    std::atomic<double>     m_peakLoad;
+    std::atomic<uint64_t>   m_numCallbacks;
+    std::atomic<uint64_t>   m_numXruns;
+    std::atomic<uint64_t>   m_histogram[kHistogramSize];
+};
+
+} }
+
+#endif // METHCLA_AUDIO_LOADMETER_HPP_INCLUDED
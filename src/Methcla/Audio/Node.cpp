@@ -26,6 +26,7 @@ Node::Node(Environment& env, NodeId nodeId)
     , m_next(nullptr)
     , m_doneFlags(kMethcla_NodeDoneDoNothing)
     , m_done(false)
+    , m_running(true)
 {
 }
 
@@ -40,26 +41,61 @@ Node::~Node()
     BOOST_ASSERT(m_next == nullptr);
 }
 
-void Node::process(size_t numFrames)
+void Node::process(ProcessContext& context, size_t numFrames)
 {
     if (m_done) {
         free();
-    } else {
-        doProcess(numFrames);
+    } else if (m_running) {
+        doProcess(context, numFrames);
     }
 }
 
 void Node::free()
 {
-    Environment* pEnv = &env();
+    end();
+    if (m_parent) {
+        m_parent->remove(this);
+    }
+    env().destroyLater(this);
+}
+
+void Node::end()
+{
     // Send /node/ended notification
-    pEnv->nodeEnded(id());
+    env().nodeEnded(id());
+}
+
+void Node::destroy()
+{
+    Environment* pEnv = &env();
     this->~Node();
     pEnv->rtMem().free(this);
 }
 
-void Node::doProcess(size_t)
+#if METHCLA_PROFILING
+Methcla::Utility::Profile::Counter Node::profile() const
+{
+    return Methcla::Utility::Profile::Counter();
+}
+#endif
+
+void Node::doProcess(ProcessContext&, size_t)
+{
+}
+
+void Node::setRunning(bool running)
+{
+    if (running != m_running) {
+        m_running = running;
+        env().invalidateExecutionPlan();
+    }
+}
+
+void Node::setDoneFlags(Methcla_NodeDoneFlags flags)
 {
+    m_doneFlags = flags;
+    // Done flags determine the ordering constraints of parallel processing.
+    env().invalidateExecutionPlan();
 }
 
 inline static void setDoneFreeSelf(Node* node)
@@ -114,6 +150,7 @@ void Node::setDone()
         if (flags & kMethcla_NodeDoneFreeSelf)
         {
             m_done = true;
+            env().invalidateExecutionPlan();
         }
     }
 
@@ -17,6 +17,8 @@
 
 #include <methcla/types.h>
 
+#include "Methcla/Utility/Profile.hpp"
+
 #include <boost/serialization/strong_typedef.hpp>
 #include <cstdint>
 
@@ -27,6 +29,8 @@ namespace Methcla { namespace Audio {
 
     class Environment;
     class Group;
+    class ExecutionPlan;
+    class ProcessContext;
 
     class Node
     {
@@ -58,31 +62,69 @@ namespace Methcla { namespace Audio {
         Node* next() { return m_next; }
 
         // Process a number of frames.
-        void process(size_t numFrames);
+        void process(ProcessContext& context, size_t numFrames);
 
         Methcla_NodeDoneFlags doneFlags() const
         {
             return m_doneFlags;
         }
 
-        void setDoneFlags(Methcla_NodeDoneFlags flags)
+        void setDoneFlags(Methcla_NodeDoneFlags flags);
+
+        void setDone();
+
+        //* Return true if the node has been flagged to be freed.
+        bool isDone() const
         {
-            m_doneFlags = flags;
+            return m_done;
         }
 
-        void setDone();
+        //* Return true if the node is processed, false if it has been paused.
+        bool isRunning() const
+        {
+            return m_running;
+        }
+
+        //* Pause or resume processing of the node.
+        //
+        // A paused node keeps all of its state and resources. Pausing a group pauses its whole sub-tree.
+        //
+        // Context: RT
+        void setRunning(bool running);
 
         //* Free a node.
+        //
+        // The node is unlinked from the tree and its id is released immediately, sending `/node/ended` notifications for the node and its whole sub-tree. Destroying the node and releasing its memory is deferred and spread over subsequent blocks, so that freeing large sub-trees doesn't cause dropouts.
+        //
+        // Context: RT
         void free();
 
+#if METHCLA_PROFILING
+        //* Return the DSP time accumulated by this node.
+        //
+        // Groups report the sum over all synths in their sub-tree.
+        //
+        // Context: RT
+        virtual Utility::Profile::Counter profile() const;
+#endif
+
     protected:
         Node(Environment& env, NodeId nodeId);
         virtual ~Node();
 
-        virtual void doProcess(size_t numFrames);
+        virtual void doProcess(ProcessContext& context, size_t numFrames);
+
+        //* Release the node's id and send a `/node/ended` notification.
+        virtual void end();
+
+        //* Destroy the node and release its memory.
+        virtual void destroy();
 
     protected:
         friend class Group;
+        friend class ExecutionPlan;
+        // Destroys freed nodes; unlinked nodes are queued through m_next.
+        friend class EnvironmentImpl;
 
         Environment&            m_env;
         NodeId                  m_id;
@@ -93,6 +135,7 @@ namespace Methcla { namespace Audio {
 
         Methcla_NodeDoneFlags   m_doneFlags;
         bool                    m_done;
+        bool                    m_running;
     };
 } }
 
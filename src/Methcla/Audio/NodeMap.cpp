@@ -0,0 +1,233 @@
+// Copyright 2012-2014 Samplecount S.L.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Methcla/Audio/NodeMap.hpp"
+#include "Methcla/Audio/Engine.hpp"
+#include "Methcla/Memory.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <exception>
+
+using namespace Methcla::Audio;
+
+// Allocate spare pages on the worker thread and hand them to the realtime thread.
+class NodeMap::RefillCommand
+{
+public:
+    RefillCommand(NodeMap* map, size_t numPages)
+        : m_map(map)
+        , m_numPages(numPages)
+        , m_numAllocated(0)
+    {
+        assert( numPages <= kMaxNumSparePages );
+    }
+
+    // Context: NRT
+    static void perform_alloc(Environment* env, void* data)
+    {
+        RefillCommand* self = static_cast<RefillCommand*>(data);
+        while (self->m_numAllocated < self->m_numPages) {
+            self->m_pages[self->m_numAllocated++] = allocPage();
+        }
+        env->sendFromWorker(perform_add, self);
+    }
+
+    // Context: RT
+    static void perform_add(Environment* env, void* data)
+    {
+        RefillCommand* self = static_cast<RefillCommand*>(data);
+        if (self->m_map != nullptr)
+            self->m_map->addSparePages(self->m_pages, self->m_numAllocated);
+        env->rtMem().free(self);
+    }
+
+    //* Free the pages allocated so far and disconnect the command from its map.
+    //
+    // Context: NRT, with the worker stopped
+    void detach()
+    {
+        for (size_t i=0; i < m_numAllocated; i++) {
+            freePage(m_pages[i]);
+        }
+        m_numAllocated = 0;
+        m_map = nullptr;
+    }
+
+private:
+    NodeMap*    m_map;
+    size_t      m_numPages;
+    size_t      m_numAllocated;
+    Page*       m_pages[kMaxNumSparePages];
+};
+
+NodeMap::NodeMap(Environment& env)
+    : m_env(env)
+    , m_size(0)
+    , m_numSparePages(0)
+    , m_refillCommand(nullptr)
+{
+    std::fill(m_directory, m_directory + kDirectorySize, nullptr);
+    while (m_numSparePages < kMaxNumSparePages) {
+        m_sparePages[m_numSparePages++] = allocPage();
+    }
+}
+
+NodeMap::~NodeMap()
+{
+    // A refill still in flight is never performed once the worker has been stopped.
+    if (m_refillCommand != nullptr)
+        m_refillCommand->detach();
+    for (size_t i=0; i < kDirectorySize; i++) {
+        Page* table = m_directory[i];
+        if (table != nullptr) {
+            for (size_t k=0; k < kPageSize; k++) {
+                if (table->entries[k] != nullptr)
+                    freePage(static_cast<Page*>(table->entries[k]));
+            }
+            freePage(table);
+        }
+    }
+    for (size_t i=0; i < m_numSparePages; i++) {
+        freePage(m_sparePages[i]);
+    }
+}
+
+NodeMap::Page* NodeMap::allocPage()
+{
+    Page* page = Memory::allocOf<Page>();
+    memset(page, 0, sizeof(Page));
+    return page;
+}
+
+void NodeMap::freePage(Page* page)
+{
+    Memory::free(page);
+}
+
+void NodeMap::perform_freePage(Environment*, void* data)
+{
+    freePage(static_cast<Page*>(data));
+}
+
+void NodeMap::refill()
+{
+    if (m_numSparePages < kMinNumSparePages && m_refillCommand == nullptr) {
+        RefillCommand* command = nullptr;
+        try {
+            command = m_env.rtMem().construct<RefillCommand>(this, kMaxNumSparePages - m_numSparePages);
+            m_env.sendToWorker(RefillCommand::perform_alloc, command);
+            m_refillCommand = command;
+        } catch (std::exception&) {
+            // Retried on the next call, the spare pages left are still usable.
+            if (command != nullptr)
+                m_env.rtMem().free(command);
+        }
+    }
+}
+
+NodeMap::Page* NodeMap::takePage()
+{
+    assert( m_numSparePages > 0 );
+    return m_sparePages[--m_numSparePages];
+}
+
+void NodeMap::releasePage(Page* page)
+{
+    assert( page->count == 0 );
+    if (m_numSparePages < kMaxNumSparePages) {
+        // Empty pages are all zeros and can be reused as they are.
+        m_sparePages[m_numSparePages++] = page;
+    } else {
+        m_env.sendToWorker(perform_freePage, page);
+    }
+}
+
+void NodeMap::addSparePages(Page** pages, size_t numPages)
+{
+    for (size_t i=0; i < numPages; i++) {
+        releasePage(pages[i]);
+    }
+    m_refillCommand = nullptr;
+}
+
+size_t NodeMap::numPagesNeeded(NodeId nodeId) const
+{
+    const uint32_t id = nodeId;
+    const Page* table = m_directory[id >> (2 * kPageBits)];
+    if (table == nullptr)
+        return 2;
+    return table->entries[(id >> kPageBits) & kPageMask] == nullptr ? 1 : 0;
+}
+
+void NodeMap::insert(NodeId nodeId, Node* node)
+{
+    assert( isValid(nodeId) );
+    assert( node != nullptr );
+    assert( lookup(nodeId) == nullptr );
+    assert( canInsert(nodeId) );
+
+    const uint32_t id = nodeId;
+    const size_t tableIndex = id >> (2 * kPageBits);
+    const size_t pageIndex = (id >> kPageBits) & kPageMask;
+
+    Page* table = m_directory[tableIndex];
+    Page* page = table == nullptr ? nullptr : static_cast<Page*>(table->entries[pageIndex]);
+
+    if (table == nullptr) {
+        table = takePage();
+        m_directory[tableIndex] = table;
+    }
+    if (page == nullptr) {
+        page = takePage();
+        table->entries[pageIndex] = page;
+        table->count++;
+    }
+
+    page->entries[id & kPageMask] = node;
+    page->count++;
+    m_size++;
+}
+
+void NodeMap::remove(NodeId nodeId)
+{
+    if (!isValid(nodeId))
+        return;
+
+    const uint32_t id = nodeId;
+    const size_t tableIndex = id >> (2 * kPageBits);
+    const size_t pageIndex = (id >> kPageBits) & kPageMask;
+
+    Page* table = m_directory[tableIndex];
+    if (table == nullptr)
+        return;
+    Page* page = static_cast<Page*>(table->entries[pageIndex]);
+    if (page == nullptr || page->entries[id & kPageMask] == nullptr)
+        return;
+
+    page->entries[id & kPageMask] = nullptr;
+    page->count--;
+    m_size--;
+
+    if (page->count == 0) {
+        table->entries[pageIndex] = nullptr;
+        table->count--;
+        releasePage(page);
+        if (table->count == 0) {
+            m_directory[tableIndex] = nullptr;
+            releasePage(table);
+        }
+    }
+}
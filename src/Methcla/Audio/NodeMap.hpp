@@ -0,0 +1,143 @@
+// Copyright 2012-2014 Samplecount S.L.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef METHCLA_AUDIO_NODEMAP_HPP_INCLUDED
+#define METHCLA_AUDIO_NODEMAP_HPP_INCLUDED
+
+#include "Methcla/Audio/Node.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Methcla { namespace Audio {
+
+class Environment;
+
+//* Sparse map from node ids to nodes.
+//
+// Node ids can be any non-negative 32 bit integer. Ids are mapped to nodes through a fixed directory and two levels of pages that are only present while ids in their range are in use, so that memory usage is proportional to the number of ids in use rather than to the size of the id space.
+//
+// Pages are never allocated or freed on the realtime thread: Pages needed for inserting nodes are taken from a pool of spare pages that is refilled asynchronously by the worker thread, and pages that become empty are put back into the pool or handed to the worker thread for freeing.
+//
+// The worker thread must be stopped before the map is destroyed.
+class NodeMap
+{
+public:
+    //* Create an empty map with a full pool of spare pages.
+    //
+    // Context: NRT
+    NodeMap(Environment& env);
+    ~NodeMap();
+
+    NodeMap(const NodeMap&) = delete;
+    NodeMap& operator=(const NodeMap&) = delete;
+
+    //* Return true if `nodeId` is within the range of valid node ids.
+    static bool isValid(NodeId nodeId)
+    {
+        return nodeId >= 0;
+    }
+
+    //* Return number of nodes in the map.
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    //* Return the node with id `nodeId` or nullptr if there is no such node; the id must be valid.
+    //
+    // Context: RT
+    Node* lookup(NodeId nodeId) const
+    {
+        const uint32_t id = nodeId;
+        const Page* table = m_directory[id >> (2 * kPageBits)];
+        if (table == nullptr)
+            return nullptr;
+        const Page* page = static_cast<const Page*>(table->entries[(id >> kPageBits) & kPageMask]);
+        if (page == nullptr)
+            return nullptr;
+        return static_cast<Node*>(page->entries[id & kPageMask]);
+    }
+
+    //* Return true if there are enough spare pages for inserting a node with id `nodeId`.
+    //
+    // Context: RT
+    bool canInsert(NodeId nodeId) const
+    {
+        return numPagesNeeded(nodeId) <= m_numSparePages;
+    }
+
+    //* Insert `node` with id `nodeId`; the id must be valid and not be in use and `canInsert` must return true.
+    //
+    // Context: RT
+    void insert(NodeId nodeId, Node* node);
+
+    //* Remove the node with id `nodeId` if present.
+    //
+    // Context: RT
+    void remove(NodeId nodeId);
+
+    //* Request spare pages from the worker thread if running low and no request is pending.
+    //
+    // Pages arrive with the worker's replies; a request that cannot be sent is retried on the next call.
+    //
+    // Context: RT
+    void refill();
+
+    //* Return number of spare pages available for inserting nodes.
+    size_t numSparePages() const
+    {
+        return m_numSparePages;
+    }
+
+private:
+    static const size_t kPageBits = 10;
+    static const size_t kPageSize = size_t(1) << kPageBits;
+    static const uint32_t kPageMask = kPageSize - 1;
+    // Node ids are 31 bits wide.
+    static const size_t kDirectorySize = size_t(1) << (31 - 2 * kPageBits);
+    //* Maximum number of spare pages.
+    static const size_t kMaxNumSparePages = 8;
+    //* A refill is requested when less than this many spare pages are left.
+    static const size_t kMinNumSparePages = 4;
+
+    struct Page
+    {
+        // Pointers to pages in the first level, pointers to nodes in the second level.
+        void*  entries[kPageSize];
+        size_t count;
+    };
+
+    class RefillCommand;
+
+    size_t numPagesNeeded(NodeId nodeId) const;
+    static Page* allocPage();
+    static void freePage(Page* page);
+    Page* takePage();
+    void releasePage(Page* page);
+    void addSparePages(Page** pages, size_t numPages);
+    static void perform_freePage(Environment*, void* data);
+
+private:
+    Environment&    m_env;
+    Page*           m_directory[kDirectorySize];
+    size_t          m_size;
+    Page*           m_sparePages[kMaxNumSparePages];
+    size_t          m_numSparePages;
+    RefillCommand*  m_refillCommand;
+};
+
+} }
+
+#endif // METHCLA_AUDIO_NODEMAP_HPP_INCLUDED
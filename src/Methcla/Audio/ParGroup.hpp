@@ -0,0 +1,39 @@
+// Copyright 2012-2014 Samplecount S.L.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef METHCLA_AUDIO_PARGROUP_HPP_INCLUDED
+#define METHCLA_AUDIO_PARGROUP_HPP_INCLUDED
+
+#include "Methcla/Audio/Group.hpp"
+
+namespace Methcla { namespace Audio {
+
+//* Group whose children are independent of each other and may be processed concurrently.
+//
+// When the engine has been configured with helper threads, the children of a parallel group (synths or whole sub-trees) are split into chunks that are processed as separate tasks; otherwise a parallel group behaves like an ordinary group. Children may write to shared buses (see ExecutionPlan).
+class ParGroup : public Group
+{
+public:
+    static ParGroup* construct(Environment& env, NodeId nodeId);
+
+    virtual bool isParallel() const override { return true; }
+
+private:
+    ParGroup(Environment& env, NodeId nodeId);
+};
+
+} }
+
+#endif // METHCLA_AUDIO_PARGROUP_HPP_INCLUDED
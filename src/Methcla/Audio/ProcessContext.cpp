@@ -0,0 +1,130 @@
+// Copyright 2012-2014 Samplecount S.L.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "Methcla/Audio/ProcessContext.hpp"
+#include "Methcla/Audio/AudioBus.hpp"
+#include "Methcla/Audio/DSP.h"
+#include "Methcla/Audio/Engine.hpp"
+#include "Methcla/Memory.hpp"
+
+#include <cassert>
+#include <cstring>
+
+using namespace Methcla::Audio;
+using namespace Methcla::Memory;
+
+ProcessContext::ProcessContext()
+    : m_concurrent(false)
+    , m_maxNumBuses(0)
+    , m_blockSize(0)
+    , m_numBuses(0)
+    , m_partialSums(nullptr)
+    , m_buffers(nullptr)
+    , m_numScratchBuffers(0)
+    , m_scratchBuffers(nullptr)
+    , m_silentBuffer(nullptr)
+{
+}
+
+ProcessContext::ProcessContext(size_t maxNumBuses, size_t blockSize)
+    : m_concurrent(true)
+    , m_maxNumBuses(maxNumBuses)
+    , m_blockSize(blockSize)
+    , m_numBuses(0)
+    , m_partialSums(nullptr)
+    , m_buffers(nullptr)
+    , m_numScratchBuffers(0)
+    , m_scratchBuffers(nullptr)
+    , m_silentBuffer(nullptr)
+{
+    if (maxNumBuses > 0)
+    {
+        m_partialSums = allocOf<PartialSum>(maxNumBuses);
+        m_buffers = allocAlignedOf<sample_t>(kSIMDAlignment, maxNumBuses * blockSize);
+    }
+}
+
+ProcessContext::~ProcessContext()
+{
+    Methcla::Memory::free(m_partialSums);
+    Methcla::Memory::freeAligned(m_buffers);
+    Methcla::Memory::freeAligned(m_scratchBuffers);
+}
+
+void ProcessContext::allocScratchBuffers(size_t numBuffers, size_t blockSize)
+{
+    assert( m_scratchBuffers == nullptr );
+    if (numBuffers > 0)
+    {
+        // The silent buffer follows the scratch buffers.
+        m_numScratchBuffers = numBuffers;
+        m_scratchBuffers = allocAlignedOf<sample_t>(kSIMDAlignment, (numBuffers + 1) * blockSize);
+        m_silentBuffer = m_scratchBuffers + numBuffers * blockSize;
+        methcla_dsp_zero(m_scratchBuffers, (numBuffers + 1) * blockSize);
+    }
+}
+
+ProcessContext::PartialSum& ProcessContext::acquirePartialSum(AudioBus* bus)
+{
+    for (size_t i=0; i < m_numBuses; i++) {
+        if (m_partialSums[i].bus == bus)
+            return m_partialSums[i];
+    }
+    // The execution plan makes sure that a task doesn't write to more buses than there are partial sums.
+    assert( m_numBuses < m_maxNumBuses );
+    PartialSum& partial = m_partialSums[m_numBuses];
+    partial.bus = bus;
+    partial.data = m_buffers + m_numBuses * m_blockSize;
+    partial.replace = false;
+    partial.silent = false;
+    methcla_dsp_zero(partial.data, m_blockSize);
+    m_numBuses++;
+    return partial;
+}
+
+void ProcessContext::replaceWithSilence(PartialSum& partial) const
+{
+    methcla_dsp_zero(partial.data, m_blockSize);
+    partial.replace = true;
+    partial.silent = true;
+}
+
+void ProcessContext::read(const Environment& env, const PartialSum& partial, size_t numFrames, sample_t* dst) const
+{
+    AudioBus* bus = partial.bus;
+    methcla_dsp_copy(dst, partial.data, numFrames);
+    // Unless replaced, the data is added to what has been written to the bus before the task.
+    if (!partial.replace && bus->epoch() == env.epoch() && !bus->isSilent())
+        methcla_dsp_accumulate(dst, bus->data(), numFrames);
+}
+
+void ProcessContext::reduce(const Environment& env, size_t numFrames)
+{
+    for (size_t i=0; i < m_numBuses; i++) {
+        const PartialSum& partial = m_partialSums[i];
+        AudioBus* bus = partial.bus;
+        if (partial.silent) {
+            bus->setEpoch(env.epoch());
+            bus->setSilent(true);
+        } else if (!partial.replace && bus->epoch() == env.epoch() && !bus->isSilent()) {
+            methcla_dsp_accumulate(bus->data(), partial.data, numFrames);
+        } else {
+            methcla_dsp_copy(bus->data(), partial.data, numFrames);
+            bus->setEpoch(env.epoch());
+            bus->setSilent(false);
+        }
+    }
+    m_numBuses = 0;
+}
@@ -0,0 +1,137 @@
+// Copyright 2012-2014 Samplecount S.L.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef METHCLA_AUDIO_PROCESSCONTEXT_HPP_INCLUDED
+#define METHCLA_AUDIO_PROCESSCONTEXT_HPP_INCLUDED
+
+#include "Methcla/Audio.hpp"
+
+#include <cstddef>
+
+namespace Methcla { namespace Audio {
+
+class AudioBus;
+class Environment;
+
+//* State of the thread processing a part of the node tree.
+//
+// A concurrent context is used for processing children of a parallel group, which may write to the same buses at the same time. Outputs written through a concurrent context, including outputs that replace the bus contents, are collected in partial sum buffers private to the context and applied to the bus by `reduce` once all concurrent tasks have finished. A partial buffer counts as written in the current epoch from the first write until the next reduction. The execution plan only processes tasks through a concurrent context that write to no more buses than it has partial sum buffers.
+class ProcessContext
+{
+public:
+    //* Writes of a task to a single bus.
+    struct PartialSum
+    {
+        AudioBus*   bus;
+        sample_t*   data;
+        //* True if the data replaces the bus contents, otherwise it is added to the bus.
+        bool        replace;
+        //* True if the bus contents are replaced by silence; the data is zero in this case.
+        bool        silent;
+    };
+
+    //* Create a context that writes directly to buses.
+    ProcessContext();
+    //* Create a concurrent context with partial sum buffers for up to `maxNumBuses` buses of `blockSize` frames.
+    ProcessContext(size_t maxNumBuses, size_t blockSize);
+    ~ProcessContext();
+
+    ProcessContext(const ProcessContext&) = delete;
+    ProcessContext& operator=(const ProcessContext&) = delete;
+
+    //* Return true if buses written through this context might be written concurrently by other threads.
+    bool isConcurrent() const
+    {
+        return m_concurrent;
+    }
+
+    //* Return maximum number of buses that can be written through this context between reductions.
+    size_t maxNumBuses() const
+    {
+        return m_maxNumBuses;
+    }
+
+    //* Return the partial sum for `bus` or nullptr if `bus` hasn't been written to through this context.
+    //
+    // Context: RT
+    const PartialSum* partialSum(const AudioBus* bus) const
+    {
+        for (size_t i=0; i < m_numBuses; i++) {
+            if (m_partialSums[i].bus == bus)
+                return &m_partialSums[i];
+        }
+        return nullptr;
+    }
+
+    //* Return the partial sum for `bus`, zeroing its buffer when it is newly assigned.
+    //
+    // Context: RT
+    PartialSum& acquirePartialSum(AudioBus* bus);
+
+    //* Replace the bus contents by silence.
+    //
+    // Context: RT
+    void replaceWithSilence(PartialSum& partial) const;
+
+    //* Read `numFrames` frames of `partial` combined with the current contents of its bus into `dst`.
+    //
+    // Context: RT
+    void read(const Environment& env, const PartialSum& partial, size_t numFrames, sample_t* dst) const;
+
+    //* Apply partial sums to their buses and release them.
+    //
+    // Context: RT
+    void reduce(const Environment& env, size_t numFrames);
+
+    //* Allocate `numBuffers` scratch buffers of `blockSize` frames for staging synth audio ports.
+    //
+    // Scratch buffers are reused by every synth processed through this context, so that synths with few enough audio ports don't need to reserve buffers of their own. The context must not be used by more than one thread at a time.
+    //
+    // Context: NRT
+    void allocScratchBuffers(size_t numBuffers, size_t blockSize);
+
+    //* Return number of scratch buffers.
+    size_t numScratchBuffers() const
+    {
+        return m_numScratchBuffers;
+    }
+
+    //* Return the first scratch buffer; consecutive buffers are `blockSize` frames apart.
+    sample_t* scratchBuffers() const
+    {
+        return m_scratchBuffers;
+    }
+
+    //* Return a block of silence for connecting unmapped inputs staged in scratch buffers.
+    const sample_t* silentBuffer() const
+    {
+        return m_silentBuffer;
+    }
+
+private:
+    bool        m_concurrent;
+    size_t      m_maxNumBuses;
+    size_t      m_blockSize;
+    size_t      m_numBuses;
+    PartialSum* m_partialSums;
+    sample_t*   m_buffers;
+    size_t      m_numScratchBuffers;
+    sample_t*   m_scratchBuffers;
+    sample_t*   m_silentBuffer;
+};
+
+} }
+
+#endif // METHCLA_AUDIO_PROCESSCONTEXT_HPP_INCLUDED
@@ -15,6 +15,7 @@
 #include "Methcla/Audio/Synth.hpp"
 
 #include <algorithm>
+#include <cmath>
 #include <boost/type_traits/alignment_of.hpp>
 
 using namespace Methcla::Audio;
@@ -32,6 +33,7 @@ Synth::Synth( Environment& env
             , Methcla_Synth* synth
             , AudioInputConnection* audioInputConnections
             , AudioOutputConnection* audioOutputConnections
+            , ControlConnection* controlConnections
             , sample_t* controlBuffers
             , sample_t* audioBuffers
             )
@@ -41,10 +43,17 @@ Synth::Synth( Environment& env
     , m_numControlOutputs(numControlOutputs)
     , m_numAudioInputs(numAudioInputs)
     , m_numAudioOutputs(numAudioOutputs)
-    , m_sampleOffset(0.)
+    , m_silentFrames(0)
+    , m_tailFrames(0)
+    , m_batch(nullptr)
     , m_synth(synth)
     , m_audioInputConnections(audioInputConnections)
     , m_audioOutputConnections(audioOutputConnections)
+    , m_numConnectedAudioInputs(0)
+    , m_numConnectedAudioOutputs(0)
+    , m_controlConnections(controlConnections)
+    , m_numControlMappings(0)
+    , m_numControlUpdates(0)
     , m_controlBuffers(controlBuffers)
     , m_audioBuffers(audioBuffers)
 {
@@ -60,6 +69,8 @@ Synth::Synth( Environment& env
                                  (uintptr_t)m_audioInputConnections) );
     assert( Alignment::isAligned(boost::alignment_of<AudioOutputConnection>::value,
                                  (uintptr_t)m_audioOutputConnections) );
+    assert( Alignment::isAligned(boost::alignment_of<ControlConnection>::value,
+                                 (uintptr_t)m_controlConnections) );
     assert( Alignment::isAligned(boost::alignment_of<sample_t>::value,
                                  (uintptr_t)m_controlBuffers) );
     assert( kBufferAlignment.isAligned(m_audioBuffers) );
@@ -70,16 +81,14 @@ Synth::~Synth()
     m_synthDef.destroy(env(), m_synth);
 }
 
-Synth* Synth::construct(Environment& env, NodeId nodeId, const SynthDef& synthDef, OSCPP::Server::ArgStream controls, OSCPP::Server::ArgStream options)
+Synth::Layout::Layout(const Environment& env, const SynthDef& synthDef, const Methcla_SynthOptions* synthOptions)
+    : numControlInputs(0)
+    , numControlOutputs(0)
+    , numAudioInputs(0)
+    , numAudioOutputs(0)
+    , numAudioRateControlInputs(0)
+    , scratchBuffers(false)
 {
-    // Get synth options
-    const Methcla_SynthOptions* synthOptions = synthDef.configure(options);
-
-    Methcla_PortCount numControlInputs  = 0;
-    Methcla_PortCount numControlOutputs = 0;
-    Methcla_PortCount numAudioInputs    = 0;
-    Methcla_PortCount numAudioOutputs   = 0;
-
     // Get port counts.
     Methcla_PortDescriptor port;
     for (size_t i=0; synthDef.portDescriptor(synthOptions, i, &port); i++) {
@@ -98,6 +107,8 @@ Synth* Synth::construct(Environment& env, NodeId nodeId, const SynthDef& synthDe
                 switch (port.direction) {
                     case kMethcla_Input:
                         numControlInputs++;
+                        if (port.flags & kMethcla_AudioRate)
+                            numAudioRateControlInputs++;
                         break;
                     case kMethcla_Output:
                         numControlOutputs++;
@@ -106,42 +117,68 @@ Synth* Synth::construct(Environment& env, NodeId nodeId, const SynthDef& synthDe
         }
     }
 
-    // const size_t numControlInputs           = synthDef.numControlInputs();
-    // const size_t numControlOutputs          = synthDef.numControlOutputs();
-    // const size_t numAudioInputs             = synthDef.numAudioInputs();
-    // const size_t numAudioOutputs            = synthDef.numAudioOutputs();
     const size_t blockSize                  = env.blockSize();
+    const size_t numAudioPorts              = numAudioInputs + numAudioOutputs;
+    scratchBuffers                          = numAudioPorts > 0 && numAudioPorts <= env.numSynthScratchBuffers();
 
     const size_t synthAllocSize             = sizeof(Synth) + synthDef.instanceSize();
-    const size_t audioInputOffset           = synthAllocSize;
+    audioInputOffset                        = synthAllocSize;
     const size_t audioInputAllocSize        = numAudioInputs * sizeof(AudioInputConnection);
-    const size_t audioOutputOffset          = audioInputOffset + audioInputAllocSize;
+    audioOutputOffset                       = audioInputOffset + audioInputAllocSize;
     const size_t audioOutputAllocSize       = numAudioOutputs * sizeof(AudioOutputConnection);
-    const size_t controlBufferOffset        = audioOutputOffset + audioOutputAllocSize;
+    controlConnectionOffset                 = audioOutputOffset + audioOutputAllocSize;
+    const size_t controlConnectionAllocSize = (numControlInputs + numControlOutputs) * sizeof(ControlConnection);
+    controlBufferOffset                     = controlConnectionOffset + controlConnectionAllocSize;
     const size_t controlBufferAllocSize     = (numControlInputs + numControlOutputs) * sizeof(sample_t);
-    const size_t audioBufferOffset          = controlBufferOffset + controlBufferAllocSize;
-    const size_t audioBufferAllocSize       = (numAudioInputs + numAudioOutputs) * blockSize * sizeof(sample_t);
-    const size_t allocSize                  = audioBufferOffset + audioBufferAllocSize + kBufferAlignment /* alignment margin */;
+    audioBufferOffset                       = controlBufferOffset + controlBufferAllocSize;
+    const size_t audioBufferAllocSize       = ((scratchBuffers ? 0 : numAudioPorts) + numAudioRateControlInputs) * blockSize * sizeof(sample_t);
+    // Rounded up so that consecutive instances in a batch are aligned.
+    allocSize                               = kBufferAlignment.align(audioBufferOffset + audioBufferAllocSize + kBufferAlignment /* alignment margin */);
+}
+
+Synth* Synth::construct(Environment& env, NodeId nodeId, const SynthDef& synthDef, OSCPP::Server::ArgStream controls, OSCPP::Server::ArgStream options)
+{
+    // Get synth options
+    const Methcla_SynthOptions* synthOptions = synthDef.configure(options);
+    const Layout layout(env, synthDef, synthOptions);
+
+    // Recycle memory of freed instances of the same definition if possible.
+    char* mem = static_cast<char*>(synthDef.instancePool().alloc(layout.allocSize));
 
-    char* mem = env.rtMem().allocOf<char>(allocSize);
+    return construct(env, nodeId, synthDef, synthOptions, layout, mem, nullptr, controls);
+}
 
+Synth* Synth::construct( Environment& env
+                       , NodeId nodeId
+                       , const SynthDef& synthDef
+                       , const Methcla_SynthOptions* synthOptions
+                       , const Layout& layout
+                       , char* mem
+                       , Batch* batch
+                       , OSCPP::Server::ArgStream& controls )
+{
     // Instantiate synth
     Synth* synth =
         new (mem) Synth(
             env,
             nodeId,
             synthDef,
-            numControlInputs,
-            numControlOutputs,
-            numAudioInputs,
-            numAudioOutputs,
+            layout.numControlInputs,
+            layout.numControlOutputs,
+            layout.numAudioInputs,
+            layout.numAudioOutputs,
             reinterpret_cast<Methcla_Synth*>(mem + sizeof(Synth)),
-            reinterpret_cast<AudioInputConnection*>(mem + audioInputOffset),
-            reinterpret_cast<AudioOutputConnection*>(mem + audioOutputOffset),
-            reinterpret_cast<sample_t*>(mem + controlBufferOffset),
-            reinterpret_cast<sample_t*>(mem + audioBufferOffset)
+            reinterpret_cast<AudioInputConnection*>(mem + layout.audioInputOffset),
+            reinterpret_cast<AudioOutputConnection*>(mem + layout.audioOutputOffset),
+            reinterpret_cast<ControlConnection*>(mem + layout.controlConnectionOffset),
+            reinterpret_cast<sample_t*>(mem + layout.controlBufferOffset),
+            reinterpret_cast<sample_t*>(mem + layout.audioBufferOffset)
         );
 
+    synth->m_batch = batch;
+    synth->m_allocSize = layout.allocSize;
+    synth->m_flags.scratchBuffers = layout.scratchBuffers;
+
     // Construct synth
     synth->construct(synthOptions);
 
@@ -151,6 +188,73 @@ Synth* Synth::construct(Environment& env, NodeId nodeId, const SynthDef& synthDe
     return synth;
 }
 
+Synth::Batch* Synth::Batch::alloc(Environment& env, const Layout& layout, size_t numSynths)
+{
+    const size_t headerSize = kBufferAlignment.align(sizeof(Batch));
+    char* mem = env.rtMem().allocOf<char>(headerSize + numSynths * layout.allocSize);
+    Batch* batch = new (mem) Batch;
+    batch->m_memory = mem + headerSize;
+    batch->m_instanceSize = layout.allocSize;
+    batch->m_numSynths = 0;
+    return batch;
+}
+
+void Synth::Batch::free(Environment& env, Batch* batch)
+{
+    assert( batch->m_numSynths == 0 );
+    batch->~Batch();
+    env.rtMem().free(batch);
+}
+
+Synth* Synth::Batch::construct( Environment& env
+                              , NodeId nodeId
+                              , const SynthDef& synthDef
+                              , const Methcla_SynthOptions* synthOptions
+                              , const Layout& layout
+                              , OSCPP::Server::ArgStream& controls )
+{
+    assert( layout.allocSize == m_instanceSize );
+    Synth* synth = Synth::construct(env, nodeId, synthDef, synthOptions, layout, m_memory + m_numSynths * m_instanceSize, this, controls);
+    m_numSynths++;
+    return synth;
+}
+
+void Synth::Batch::destroy(Environment& env)
+{
+    const size_t numSynths = m_numSynths;
+    if (numSynths == 0) {
+        free(env, this);
+    } else {
+        // Destroying the last synth frees the batch.
+        for (size_t i=numSynths; i > 0; i--) {
+            synth(i-1)->destroy();
+        }
+    }
+}
+
+Synth* Synth::Batch::synth(size_t index)
+{
+    return reinterpret_cast<Synth*>(m_memory + index * m_instanceSize);
+}
+
+void Synth::destroy()
+{
+    if (m_batch == nullptr) {
+        const SynthDef& synthDef = m_synthDef;
+        const size_t allocSize = m_allocSize;
+        this->~Synth();
+        synthDef.instancePool().free(this, allocSize);
+    } else {
+        // The batch memory is freed with its last synth.
+        Environment& env = this->env();
+        Batch* batch = m_batch;
+        this->~Synth();
+        if (--batch->m_numSynths == 0) {
+            Batch::free(env, batch);
+        }
+    }
+}
+
 Synth* Synth::fromSynth(Methcla_Synth* synth)
 {
     // NOTE: This needs to be adapted if Synth memory layout is changed!
@@ -162,26 +266,39 @@ void Synth::construct(const Methcla_SynthOptions* synthOptions)
     m_synthDef.construct(env(), synthOptions, m_synth);
 }
 
-void Synth::connectPorts(const Methcla_SynthOptions* synthOptions, OSCPP::Server::ArgStream controls)
+void Synth::connectPorts(const Methcla_SynthOptions* synthOptions, OSCPP::Server::ArgStream& controls)
 {
     Methcla_PortDescriptor port;
     Methcla_PortCount controlInputIndex  = 0;
     Methcla_PortCount controlOutputIndex = 0;
     Methcla_PortCount audioInputIndex    = 0;
     Methcla_PortCount audioOutputIndex   = 0;
+    // Block buffers of audio rate control inputs follow the audio port buffers.
+    sample_t* audioRateBuffer = m_flags.scratchBuffers
+                                    ? m_audioBuffers
+                                    : m_audioBuffers + (numAudioInputs() + numAudioOutputs()) * env().blockSize();
     for (size_t i=0; m_synthDef.portDescriptor(synthOptions, i, &port); i++) {
         switch (port.type) {
         case kMethcla_ControlPort:
             switch (port.direction) {
             case kMethcla_Input: {
                 // Initialize with control value
-                m_controlBuffers[controlInputIndex] = controls.next<float>();
-                sample_t* buffer = &m_controlBuffers[controlInputIndex];
-                m_synthDef.connect(m_synth, i, buffer);
+                const float value = controls.next<float>();
+                m_controlBuffers[controlInputIndex] = value;
+                if (port.flags & kMethcla_AudioRate) {
+                    new (&m_controlConnections[controlInputIndex]) ControlConnection(controlInputIndex, i, audioRateBuffer);
+                    std::fill(audioRateBuffer, audioRateBuffer + env().blockSize(), value);
+                    m_synthDef.connect(m_synth, i, audioRateBuffer);
+                    audioRateBuffer += env().blockSize();
+                } else {
+                    new (&m_controlConnections[controlInputIndex]) ControlConnection(controlInputIndex, i);
+                    m_synthDef.connect(m_synth, i, &m_controlBuffers[controlInputIndex]);
+                }
                 controlInputIndex++;
                 };
                 break;
             case kMethcla_Output: {
+                new (&m_controlConnections[numControlInputs() + controlOutputIndex]) ControlConnection(numControlInputs() + controlOutputIndex, i);
                 sample_t* buffer = &m_controlBuffers[numControlInputs() + controlOutputIndex];
                 m_synthDef.connect(m_synth, i, buffer);
                 controlOutputIndex++;
@@ -192,18 +309,30 @@ void Synth::connectPorts(const Methcla_SynthOptions* synthOptions, OSCPP::Server
         case kMethcla_AudioPort:
             switch (port.direction) {
             case kMethcla_Input: {
-                new (&m_audioInputConnections[audioInputIndex]) AudioInputConnection(audioInputIndex);
-                sample_t* buffer = m_audioBuffers + audioInputIndex * env().blockSize();
-                assert( kBufferAlignment.isAligned(buffer) );
-                m_synthDef.connect(m_synth, i, buffer);
+                if (m_flags.scratchBuffers) {
+                    // Connected to a scratch buffer when processing
+                    new (&m_audioInputConnections[audioInputIndex]) AudioInputConnection(audioInputIndex, i);
+                } else {
+                    sample_t* buffer = m_audioBuffers + audioInputIndex * env().blockSize();
+                    assert( kBufferAlignment.isAligned(buffer) );
+                    new (&m_audioInputConnections[audioInputIndex]) AudioInputConnection(audioInputIndex, i, buffer);
+                    // Unmapped inputs are not processed and need to stay silent.
+                    methcla_dsp_zero(buffer, env().blockSize());
+                    m_synthDef.connect(m_synth, i, buffer);
+                }
                 audioInputIndex++;
                 };
                 break;
             case kMethcla_Output: {
-                new (&m_audioOutputConnections[audioOutputIndex]) AudioOutputConnection(audioOutputIndex);
-                sample_t* buffer = m_audioBuffers + (numAudioInputs() + audioOutputIndex) * env().blockSize();
-                assert( kBufferAlignment.isAligned(buffer) );
-                m_synthDef.connect(m_synth, i, buffer);
+                if (m_flags.scratchBuffers) {
+                    // Connected to a scratch buffer when processing
+                    new (&m_audioOutputConnections[audioOutputIndex]) AudioOutputConnection(audioOutputIndex, i);
+                } else {
+                    sample_t* buffer = m_audioBuffers + (numAudioInputs() + audioOutputIndex) * env().blockSize();
+                    assert( kBufferAlignment.isAligned(buffer) );
+                    new (&m_audioOutputConnections[audioOutputIndex]) AudioOutputConnection(audioOutputIndex, i, buffer);
+                    m_synthDef.connect(m_synth, i, buffer);
+                }
                 audioOutputIndex++;
                 };
                 break;
@@ -238,49 +367,397 @@ struct ByBusId
     }
 };
 
-void Synth::mapInput(Methcla_PortCount index, const AudioBusId& busId, Methcla_BusMappingFlags flags)
+//* Move connections mapped to a bus to the front, ordered by port index, and return their number.
+template <class T>
+static Methcla_PortCount partitionConnected(T* begin, T* end)
+{
+    T* const connectedEnd = std::partition(begin, end, [](const T& x) { return x.bus() != nullptr; });
+    // Bundles are found among consecutive ports
+    std::sort(begin, connectedEnd, [](const T& a, const T& b) { return a.index() < b.index(); });
+    return connectedEnd - begin;
+}
+
+//* Split the first `numConnected` connections into runs of connections for which `sameBundle` holds pairwise.
+template <class T, class F>
+static void findBundles(T* connections, Methcla_PortCount numConnected, Methcla_PortCount numConnections, F sameBundle)
+{
+    for (Methcla_PortCount i=0; i < numConnections; i++) {
+        connections[i].setNumChannels(1);
+    }
+    for (Methcla_PortCount i=0; i < numConnected; ) {
+        Methcla_PortCount n = 1;
+        while (i + n < numConnected
+               && connections[i+n].index() == connections[i+n-1].index() + 1
+               && sameBundle(connections[i+n-1], connections[i+n]))
+            n++;
+        connections[i].setNumChannels(n);
+        i += n;
+    }
+}
+
+//* Copy `numChannels` planar channels; channels laid out back to back in both buffers are copied at once.
+static void copyChannels(sample_t* dst, size_t dstStride, const sample_t* src, size_t srcStride, size_t numChannels, size_t numFrames)
+{
+    if (dstStride == srcStride && dstStride == numFrames) {
+        methcla_dsp_copy(dst, src, numChannels * numFrames);
+    } else {
+        for (size_t c=0; c < numChannels; c++) {
+            methcla_dsp_copy(dst + c * dstStride, src + c * srcStride, numFrames);
+        }
+    }
+}
+
+//* Mix `numChannels` planar channels into `dst`; channels laid out back to back in both buffers are mixed at once.
+static void accumulateChannels(sample_t* dst, size_t dstStride, const sample_t* src, size_t srcStride, size_t numChannels, size_t numFrames)
+{
+    if (dstStride == srcStride && dstStride == numFrames) {
+        methcla_dsp_accumulate(dst, src, numChannels * numFrames);
+    } else {
+        for (size_t c=0; c < numChannels; c++) {
+            methcla_dsp_accumulate(dst + c * dstStride, src + c * srcStride, numFrames);
+        }
+    }
+}
+
+void Synth::mapInputs(Methcla_PortCount index, const AudioBusId& busId, Methcla_PortCount numChannels, Methcla_BusMappingFlags flags)
 {
     AudioInputConnection* const begin = m_audioInputConnections;
     AudioInputConnection* const end = begin + numAudioInputs();
+    bool changed = false;
+
+    for (Methcla_PortCount c=0; c < numChannels; c++) {
+        AudioInputConnection* conn =
+            std::find_if(begin, end, IfIndex<AudioInputConnection>(index + c));
+
+        if (conn != end) {
+            const AudioBusId channelBusId(static_cast<uint32_t>(busId) + c);
+            AudioBus* bus = flags & kMethcla_BusMappingExternal
+                                ? env().externalAudioInput(channelBusId)
+                                : env().audioBus(channelBusId);
+            conn->connect(bus, flags);
+            // Unmapped ports using scratch buffers are rebound when processing.
+            if (bus == nullptr && !m_flags.scratchBuffers) {
+                sample_t* buffer = m_audioBuffers + (index + c) * env().blockSize();
+                methcla_dsp_zero(buffer, env().blockSize());
+                bindPort(*conn, buffer);
+            }
+            changed = true;
+        }
+    }
 
-    AudioInputConnection* conn =
-        std::find_if(begin, end, IfIndex<AudioInputConnection>(index));
-
-    if (conn != end) {
-        AudioBus* bus = flags & kMethcla_BusMappingExternal
-                            ? env().externalAudioInput(busId)
-                            : env().audioBus(busId);
-        conn->connect(bus, flags);
+    if (changed) {
+        m_numConnectedAudioInputs = partitionConnected(begin, end);
+        updateSharedBuses();
+        env().invalidateExecutionPlan();
     }
 }
 
-void Synth::mapOutput(Methcla_PortCount index, const AudioBusId& busId, Methcla_BusMappingFlags flags)
+void Synth::mapOutputs(Methcla_PortCount index, const AudioBusId& busId, Methcla_PortCount numChannels, Methcla_BusMappingFlags flags)
 {
     AudioOutputConnection* const begin = m_audioOutputConnections;
     AudioOutputConnection* const end = begin + numAudioOutputs();
+    bool changed = false;
+
+    for (Methcla_PortCount c=0; c < numChannels; c++) {
+        AudioOutputConnection* conn =
+            std::find_if(begin, end, IfIndex<AudioOutputConnection>(index + c));
+
+        if (conn != end) {
+            const AudioBusId channelBusId(static_cast<uint32_t>(busId) + c);
+            AudioBus* bus = flags & kMethcla_BusMappingExternal
+                                ? env().externalAudioOutput(channelBusId)
+                                : env().audioBus(channelBusId);
+            conn->connect(bus, flags);
+            if (bus == nullptr && !m_flags.scratchBuffers)
+                bindPort(*conn, m_audioBuffers + (numAudioInputs() + index + c) * env().blockSize());
+            changed = true;
+        }
+    }
+
+    if (changed) {
+        m_numConnectedAudioOutputs = partitionConnected(begin, end);
+        updateSharedBuses();
+        env().invalidateExecutionPlan();
+    }
+}
+
+float Synth::controlValue(Methcla_PortCount index) const
+{
+    const ControlConnection& conn = m_controlConnections[index];
+    if (conn.bus() != nullptr)
+        return *conn.bus();
+    else if (conn.buffer() != nullptr)
+        return conn.buffer()[0];
+    else
+        return m_controlBuffers[index];
+}
+
+void Synth::updateControlMappings()
+{
+    m_numControlMappings = 0;
+    m_numControlUpdates = 0;
+    for (size_t i=0; i < numControlInputs() + numControlOutputs(); i++) {
+        const ControlConnection& conn = m_controlConnections[i];
+        if (conn.isMapped())
+            m_numControlMappings++;
+        if (conn.needsUpdate())
+            m_numControlUpdates++;
+    }
+    // Synths sharing buses through control ports are ordered by the execution plan.
+    env().invalidateExecutionPlan();
+}
+
+void Synth::mapControlPort(Methcla_PortCount index, sample_t* bus)
+{
+    ControlConnection& conn = m_controlConnections[index];
+    if (bus == conn.bus() && conn.audioInput().bus() == nullptr)
+        return;
+
+    // Continue with the last value when unmapping
+    const float value = controlValue(index);
+    conn.audioInput().connect(nullptr, kMethcla_BusMappingInternal);
+    conn.connect(bus);
+
+    if (conn.buffer() != nullptr) {
+        // Audio rate inputs are filled from the control bus before processing
+        if (bus == nullptr)
+            std::fill(conn.buffer(), conn.buffer() + env().blockSize(), value);
+    } else if (bus == nullptr) {
+        m_controlBuffers[index] = value;
+        m_synthDef.connect(m_synth, conn.port(), &m_controlBuffers[index]);
+    } else {
+        m_synthDef.connect(m_synth, conn.port(), bus);
+    }
+
+    updateControlMappings();
+}
+
+void Synth::setControlInput(Methcla_PortCount index, float value)
+{
+    assert( index < numControlInputs() );
+    ControlConnection& conn = m_controlConnections[index];
+    if (conn.isMapped())
+        mapControlPort(index, nullptr);
+    m_controlBuffers[index] = value;
+    if (conn.buffer() != nullptr)
+        std::fill(conn.buffer(), conn.buffer() + env().blockSize(), value);
+}
+
+void Synth::mapControlInput(Methcla_PortCount index, sample_t* bus)
+{
+    assert( index < numControlInputs() );
+    mapControlPort(index, bus);
+}
+
+void Synth::mapControlInputToAudioBus(Methcla_PortCount index, AudioBus* bus, Methcla_BusMappingFlags flags)
+{
+    assert( index < numControlInputs() );
+    ControlConnection& conn = m_controlConnections[index];
+    if (conn.bus() != nullptr)
+        mapControlPort(index, nullptr);
+    if (bus == nullptr && conn.buffer() != nullptr) {
+        // Hold the last value
+        std::fill(conn.buffer(), conn.buffer() + env().blockSize(), conn.buffer()[0]);
+    }
+    conn.audioInput().connect(bus, flags);
+    updateControlMappings();
+    updateSharedBuses();
+}
+
+void Synth::updateSharedBuses()
+{
+    // Inputs can't read bus memory written by an output of the same synth, outputs can't write bus memory read or written by any other port.
+    for (size_t i=0; i < numConnectedAudioInputs(); i++) {
+        AudioInputConnection& x = m_audioInputConnections[i];
+        bool shared = false;
+        for (size_t k=0; k < numConnectedAudioOutputs() && !shared; k++)
+            shared = m_audioOutputConnections[k].bus() == x.bus();
+        x.setShared(shared);
+    }
+    for (size_t i=0; i < numConnectedAudioOutputs(); i++) {
+        AudioOutputConnection& x = m_audioOutputConnections[i];
+        bool shared = false;
+        for (size_t k=0; k < numConnectedAudioInputs() && !shared; k++)
+            shared = m_audioInputConnections[k].bus() == x.bus();
+        for (size_t k=0; k < numConnectedAudioOutputs() && !shared; k++)
+            shared = k != i && m_audioOutputConnections[k].bus() == x.bus();
+        for (size_t k=0; k < numControlInputs() && !shared; k++)
+            shared = m_controlConnections[k].audioInput().bus() == x.bus();
+        x.setShared(shared);
+    }
+    updateBundles();
+}
+
+void Synth::updateBundles()
+{
+    // Internal buses with consecutive ids are stored back to back (see AudioBusArena).
+    findBundles(m_audioInputConnections, numConnectedAudioInputs(), numAudioInputs(),
+        [](const AudioInputConnection& a, const AudioInputConnection& b) {
+            return (a.mode() == AudioInputConnection::kInternal || a.mode() == AudioInputConnection::kFeedback)
+                && b.mode() == a.mode()
+                && !a.isShared() && !b.isShared()
+                && b.bus() == a.bus() + 1;
+        });
+    findBundles(m_audioOutputConnections, numConnectedAudioOutputs(), numAudioOutputs(),
+        [](const AudioOutputConnection& a, const AudioOutputConnection& b) {
+            return !(a.flags() & kMethcla_BusMappingExternal) && !(b.flags() & kMethcla_BusMappingExternal)
+                && b.replaces() == a.replaces()
+                && !a.isShared() && !b.isShared()
+                && b.bus() == a.bus() + 1;
+        });
+}
+
+bool Synth::bindInputBundle(AudioInputConnection* x, size_t numFrames, sample_t* buffers)
+{
+    const Environment& env = this->env();
+    const Methcla_PortCount numChannels = x->numChannels();
+    AudioBus* const buses = x->bus();
+    const bool feedback = x->mode() == AudioInputConnection::kFeedback;
+
+    // Bus headers are stored back to back, checking all of them is cheap.
+    Methcla_PortCount numSilent = 0;
+    for (Methcla_PortCount c=0; c < numChannels; c++) {
+        const AudioBus& bus = buses[c];
+        if (bus.isSilent() || (!feedback && bus.epoch() != env.epoch()))
+            numSilent++;
+    }
+
+    const size_t blockSize = env.blockSize();
+    sample_t* const dst = buffers + x->index() * blockSize;
+
+    if (numSilent == numChannels) {
+        methcla_dsp_zero(dst, numChannels * blockSize);
+        for (Methcla_PortCount c=0; c < numChannels; c++)
+            bindPort(x[c], dst + c * blockSize);
+    } else if (numSilent == 0 && !feedback) {
+        // Read in place
+        for (Methcla_PortCount c=0; c < numChannels; c++)
+            bindPort(x[c], buses[c].data());
+    } else if (numSilent == 0) {
+        copyChannels(dst, blockSize, buses->data(), env.audioBusStride(), numChannels, numFrames);
+        for (Methcla_PortCount c=0; c < numChannels; c++)
+            bindPort(x[c], dst + c * blockSize);
+    } else {
+        return false;
+    }
+
+    return true;
+}
 
-    AudioOutputConnection* conn =
-        std::find_if(begin, end, IfIndex<AudioOutputConnection>(index));
+bool Synth::writeOutputBundle(AudioOutputConnection* x, size_t numFrames, const sample_t* buffers)
+{
+    const Environment& env = this->env();
+    const Methcla_PortCount numChannels = x->numChannels();
+    AudioBus* const buses = x->bus();
+
+    Methcla_PortCount numInPlace = 0;
+    for (Methcla_PortCount c=0; c < numChannels; c++) {
+        if (x[c].binding() == buses[c].data())
+            numInPlace++;
+    }
+
+    if (numInPlace == numChannels) {
+        for (Methcla_PortCount c=0; c < numChannels; c++)
+            x[c].writeInPlace(env);
+        return true;
+    }
+
+    if (numInPlace > 0 || x->replaces())
+        return false;
 
-    if (conn != end) {
-        AudioBus* bus = flags & kMethcla_BusMappingExternal
-                            ? env().externalAudioOutput(busId)
-                            : env().audioBus(busId);
-        conn->connect(bus, flags);
+    // Mix all channels at once if all buses have been written to in this block
+    for (Methcla_PortCount c=0; c < numChannels; c++) {
+        if (buses[c].epoch() != env.epoch() || buses[c].isSilent())
+            return false;
     }
+
+    const size_t blockSize = env.blockSize();
+    accumulateChannels(buses->data(), env.audioBusStride(), buffers + x->index() * blockSize, blockSize, numChannels, numFrames);
+
+    return true;
 }
 
-void Synth::activate(double sampleOffset)
+void Synth::mapControlOutput(Methcla_PortCount index, sample_t* bus)
+{
+    assert( index < numControlOutputs() );
+    mapControlPort(numControlInputs() + index, bus);
+}
+
+void Synth::updateControls(ProcessContext& context, size_t numFrames)
+{
+    const Environment& env = this->env();
+    for (size_t i=0; i < numControlInputs(); i++) {
+        ControlConnection& conn = m_controlConnections[i];
+        if (conn.audioInput().bus() != nullptr) {
+            if (conn.buffer() != nullptr) {
+                conn.audioInput().read(env, context, numFrames, conn.buffer());
+            } else {
+                // Downsample to the first frame of the block
+                conn.audioInput().read(env, context, 1, &m_controlBuffers[i]);
+            }
+        } else if (conn.bus() != nullptr && conn.buffer() != nullptr) {
+            std::fill(conn.buffer(), conn.buffer() + numFrames, *conn.bus());
+        }
+    }
+}
+
+void Synth::activate()
 {
     if (m_flags.state == kStateInactive)
     {
-        m_sampleOffset = sampleOffset;
         m_synthDef.activate(env(), m_synth);
-        m_flags.state = kStateActivating;
+        m_flags.state = kStateActive;
+        env().invalidateExecutionPlan();
+    }
+}
+
+bool Synth::audioInputsSilent(const ProcessContext& context) const
+{
+    if (numAudioInputs() == 0)
+        return false;
+    const Environment& env = this->env();
+    for (size_t i=0; i < numConnectedAudioInputs(); i++) {
+        if (!m_audioInputConnections[i].isSilent(env, context))
+            return false;
+    }
+    return true;
+}
+
+void Synth::updateTail(bool inputsSilent, size_t numFrames)
+{
+    if (!inputsSilent) {
+        m_silentFrames = 0;
+        m_flags.tailReleased = false;
+    } else if (!m_flags.tailReleased) {
+        Environment& env = this->env();
+        if (m_silentFrames == 0) {
+            // Query the tail length when the inputs become silent, it might depend on the synth's controls.
+            m_tailFrames = (size_t)std::ceil(std::max(0., m_synthDef.tailLength(env, m_synth)) * env.sampleRate());
+        }
+        m_silentFrames += numFrames;
+        if (m_silentFrames >= m_tailFrames) {
+            m_flags.tailReleased = true;
+            env.synthDone(this);
+        }
     }
 }
 
-void Synth::doProcess(size_t numFrames)
+void Synth::bindUnmappedToScratch(const ProcessContext& context, sample_t* outputBuffers)
+{
+    assert( context.numScratchBuffers() >= numAudioInputs() + numAudioOutputs() );
+    // Scratch buffers are overwritten by other synths, unmapped inputs read from the context's silent buffer.
+    sample_t* silence = const_cast<sample_t*>(context.silentBuffer());
+    for (size_t i=numConnectedAudioInputs(); i < numAudioInputs(); i++) {
+        bindPort(m_audioInputConnections[i], silence);
+    }
+    const size_t blockSize = env().blockSize();
+    for (size_t i=numConnectedAudioOutputs(); i < numAudioOutputs(); i++) {
+        AudioOutputConnection& x = m_audioOutputConnections[i];
+        bindPort(x, outputBuffers + x.index() * blockSize);
+    }
+}
+
+void Synth::doProcess(ProcessContext& context, size_t numFrames)
 {
     // Sort connections by bus id (if necessary)
     // Only needed for bus locking protocol in a parallel implementation
@@ -300,21 +777,68 @@ void Synth::doProcess(size_t numFrames)
     Environment& env = this->env();
     const size_t blockSize = env.blockSize();
 
-    sample_t* const inputBuffers = m_audioBuffers;
-    sample_t* const outputBuffers = m_audioBuffers + numAudioInputs() * blockSize;
+    sample_t* const inputBuffers = m_flags.scratchBuffers ? context.scratchBuffers() : m_audioBuffers;
+    sample_t* const outputBuffers = inputBuffers + numAudioInputs() * blockSize;
 
     if (m_flags.state == kStateActive) {
-        // TODO: Iterate only over connected connections (by tracking number of connections).
-        for (size_t i=0; i < numAudioInputs(); i++) {
+        if (m_synthDef.silentInputSilentOutput() || m_synthDef.hasTailLength()) {
+            const bool inputsSilent = audioInputsSilent(context);
+            if (m_synthDef.hasTailLength()) {
+                updateTail(inputsSilent, numFrames);
+            }
+            if (inputsSilent && m_synthDef.silentInputSilentOutput()) {
+                // Propagate silence without processing
+                for (size_t i=0; i < numConnectedAudioOutputs(); i++) {
+                    m_audioOutputConnections[i].writeSilence(env, context);
+                }
+                return;
+            }
+        }
+
+        if (m_numControlUpdates > 0)
+            updateControls(context, numFrames);
+
+        // Unmapped inputs are kept silent, unmapped outputs are discarded.
+        // Ports are connected to bus memory directly where possible, otherwise to the synth's own buffers.
+        for (size_t i=0; i < numConnectedAudioInputs(); ) {
             AudioInputConnection& x = m_audioInputConnections[i];
-            x.read(env, numFrames, inputBuffers + x.index() * blockSize);
+            if (x.numChannels() > 1 && !context.isConcurrent() && bindInputBundle(&x, numFrames, inputBuffers)) {
+                i += x.numChannels();
+                continue;
+            }
+            sample_t* data = x.inPlaceData(env, context);
+            if (data == nullptr) {
+                data = inputBuffers + x.index() * blockSize;
+                x.read(env, context, numFrames, data);
+            }
+            bindPort(x, data);
+            i++;
         }
 
+        for (size_t i=0; i < numConnectedAudioOutputs(); i++) {
+            AudioOutputConnection& x = m_audioOutputConnections[i];
+            sample_t* data = x.inPlaceData(env, context);
+            bindPort(x, data == nullptr ? outputBuffers + x.index() * blockSize : data);
+        }
+
+        if (m_flags.scratchBuffers)
+            bindUnmappedToScratch(context, outputBuffers);
+
+        METHCLA_PROFILE_BEGIN(processBegin);
         m_synthDef.process(env, m_synth, numFrames);
+        METHCLA_PROFILE_END(processBegin, m_profile, m_synthDef.profile());
 
-        for (size_t i=0; i < numAudioOutputs(); i++) {
+        for (size_t i=0; i < numConnectedAudioOutputs(); ) {
             AudioOutputConnection& x = m_audioOutputConnections[i];
-            x.write(env, numFrames, outputBuffers + x.index() * blockSize);
+            if (x.numChannels() > 1 && !context.isConcurrent() && writeOutputBundle(&x, numFrames, outputBuffers)) {
+                i += x.numChannels();
+                continue;
+            }
+            if (x.binding() == x.bus()->data())
+                x.writeInPlace(env);
+            else
+                x.write(env, context, numFrames, x.binding());
+            i++;
         }
     // Reset triggers
 //    if (m_flags.test(kHasTriggerInput)) {
@@ -324,23 +848,5 @@ void Synth::doProcess(size_t numFrames)
 //            }
 //        }
 //    }
-    } else if (m_flags.state == kStateActivating) {
-        const size_t sampleOffset = std::floor(m_sampleOffset);
-        assert( m_sampleOffset < (double)numFrames && sampleOffset < numFrames );
-        const size_t remainingFrames = numFrames - sampleOffset;
-
-        for (size_t i=0; i < numAudioInputs(); i++) {
-            AudioInputConnection& x = m_audioInputConnections[i];
-            x.read(env, remainingFrames, inputBuffers + x.index() * blockSize, sampleOffset);
-        }
-
-        m_synthDef.process(env, m_synth, remainingFrames);
-
-        for (size_t i=0; i < numAudioOutputs(); i++) {
-            AudioOutputConnection& x = m_audioOutputConnections[i];
-            x.write(env, remainingFrames, outputBuffers + x.index() * blockSize, sampleOffset);
-        }
-
-        m_flags.state = kStateActive;
     }
 }
@@ -16,8 +16,9 @@
 #define METHCLA_AUDIO_SYNTH_HPP_INCLUDED
 
 #include "Methcla/Audio/AudioBus.hpp"
-// #include "Methcla/Audio/DSP.h"
+#include "Methcla/Audio/DSP.h"
 #include "Methcla/Audio/Engine.hpp"
+#include "Methcla/Audio/ProcessContext.hpp"
 
 #include <cstdint>
 #include <methcla/plugin.h>
@@ -44,14 +45,22 @@ template <typename Bus>
 class Connection
 {
     Methcla_PortCount       m_index;
+    Methcla_PortCount       m_port;
     Methcla_BusMappingFlags m_flags;
     Bus*                    m_bus;
+    sample_t*               m_binding;
+    bool                    m_shared;
+    Methcla_PortCount       m_numChannels;
 
 public:
-    Connection(Methcla_PortCount index)
+    Connection(Methcla_PortCount index, Methcla_PortCount port=0, sample_t* binding=nullptr)
         : m_index(index)
+        , m_port(port)
         , m_flags(kMethcla_BusMappingInternal)
         , m_bus(nullptr)
+        , m_binding(binding)
+        , m_shared(false)
+        , m_numChannels(1)
     {}
 
     Methcla_PortCount index() const
@@ -59,6 +68,26 @@ public:
         return m_index;
     }
 
+    //* Return the index of the port in the synth definition's port descriptors.
+    Methcla_PortCount port() const
+    {
+        return m_port;
+    }
+
+    //* Return the memory the plugin port is currently connected to.
+    sample_t* binding() const { return m_binding; }
+    void setBinding(sample_t* binding) { m_binding = binding; }
+
+    //* Return true if another port of the same synth is mapped to the bus in a way that rules out binding the port to bus memory.
+    bool isShared() const { return m_shared; }
+    void setShared(bool shared) { m_shared = shared; }
+
+    //* Return the number of channels of the bus bundle starting with this connection.
+    //
+    // A bundle is a run of connections of consecutive ports mapped to consecutive internal buses in the same way; it is processed as a single block of planar channel data. Connections that aren't the first of a bundle have one channel.
+    Methcla_PortCount numChannels() const { return m_numChannels; }
+    void setNumChannels(Methcla_PortCount numChannels) { m_numChannels = numChannels; }
+
     bool connect(Bus* bus, Methcla_BusMappingFlags flags)
     {
         bool changed = false;
@@ -70,65 +99,284 @@ public:
         return changed;
     }
 
-protected:
     Methcla_BusMappingFlags flags() const { return m_flags; }
-    Bus* bus() { return m_bus; }
+    Bus* bus() const { return m_bus; }
 };
 
 class AudioInputConnection : public Connection<AudioBus>
 {
 public:
-    AudioInputConnection(Methcla_PortCount index)
-        : Connection<AudioBus>(index)
+    //* How the connection reads from its bus, resolved from the mapping flags when the connection is made.
+    enum Mode
+    {
+        kUnmapped,
+        kExternal,
+        kFeedback,
+        kInternal
+    };
+
+    AudioInputConnection(Methcla_PortCount index, Methcla_PortCount port=0, sample_t* binding=nullptr)
+        : Connection<AudioBus>(index, port, binding)
+        , m_mode(kUnmapped)
     { }
 
-    void read(const Environment& env, size_t numFrames, sample_t* dst, size_t offset=0)
+    bool connect(AudioBus* bus, Methcla_BusMappingFlags flags)
     {
-        if (bus() != nullptr) {
-            // std::lock_guard<AudioBus::Lock> lock(bus->lock());
-            if (   ((flags() & kMethcla_BusMappingExternal) == kMethcla_BusMappingExternal)
-                || ((flags() & kMethcla_BusMappingFeedback) == kMethcla_BusMappingFeedback)
-                || (bus()->epoch() == env.epoch())) {
-                const sample_t* buffer = bus()->data();
-                std::copy(buffer + offset, buffer + offset + numFrames, dst);
-            } else {
-                memset(dst, 0, numFrames * sizeof(sample_t));
-            }
-        } else {
-            memset(dst, 0, numFrames * sizeof(sample_t));
+        const bool changed = Connection<AudioBus>::connect(bus, flags);
+        if (bus == nullptr)
+            m_mode = kUnmapped;
+        else if ((flags & kMethcla_BusMappingExternal) == kMethcla_BusMappingExternal)
+            m_mode = kExternal;
+        else if ((flags & kMethcla_BusMappingFeedback) == kMethcla_BusMappingFeedback)
+            m_mode = kFeedback;
+        else
+            m_mode = kInternal;
+        return changed;
+    }
+
+    Mode mode() const { return m_mode; }
+
+    //* Return bus memory holding the current block if the port can read it in place, otherwise nullptr.
+    //
+    // Only possible for a whole block of a bus that isn't written by the same synth.
+    sample_t* inPlaceData(const Environment& env, const ProcessContext& context) const
+    {
+        if (isShared())
+            return nullptr;
+        switch (m_mode) {
+            case kExternal:
+                return bus()->data();
+            case kInternal:
+                if (context.isConcurrent() && context.partialSum(bus()) != nullptr)
+                    return nullptr;
+                if (bus()->epoch() == env.epoch() && !bus()->isSilent())
+                    return bus()->data();
+                return nullptr;
+            case kFeedback:
+            case kUnmapped:
+                break;
+        }
+        return nullptr;
+    }
+
+    void read(const Environment& env, const ProcessContext& context, size_t numFrames, sample_t* dst)
+    {
+        const ProcessContext::PartialSum* partial;
+        switch (m_mode) {
+            case kExternal:
+                methcla_dsp_copy(dst, bus()->data(), numFrames);
+                break;
+            case kFeedback:
+                if (bus()->isSilent())
+                    methcla_dsp_zero(dst, numFrames);
+                else
+                    methcla_dsp_copy(dst, bus()->data(), numFrames);
+                break;
+            case kInternal:
+                if (context.isConcurrent() && (partial = context.partialSum(bus())) != nullptr) {
+                    // Bus has been written to by a preceding synth in the same task; the bus holds what has been written before the task.
+                    context.read(env, *partial, numFrames, dst);
+                } else if (bus()->epoch() == env.epoch() && !bus()->isSilent()) {
+                    methcla_dsp_copy(dst, bus()->data(), numFrames);
+                } else {
+                    methcla_dsp_zero(dst, numFrames);
+                }
+                break;
+            case kUnmapped:
+                methcla_dsp_zero(dst, numFrames);
+                break;
+        }
+    }
+
+    //* Return true if reading from the connection would yield silence.
+    bool isSilent(const Environment& env, const ProcessContext& context) const
+    {
+        switch (m_mode) {
+            case kExternal:
+                return false;
+            case kFeedback:
+                return bus()->isSilent();
+            case kInternal:
+                if (context.isConcurrent()) {
+                    // A partial sum is only silent if it replaces the bus contents with silence.
+                    const ProcessContext::PartialSum* partial = context.partialSum(bus());
+                    if (partial != nullptr)
+                        return partial->silent;
+                }
+                return bus()->epoch() != env.epoch() || bus()->isSilent();
+            case kUnmapped:
+                break;
         }
+        return true;
     }
+
+private:
+    Mode m_mode;
 };
 
 class AudioOutputConnection : public Connection<AudioBus>
 {
 public:
-    AudioOutputConnection(Methcla_PortCount index)
-        : Connection<AudioBus>(index)
+    AudioOutputConnection(Methcla_PortCount index, Methcla_PortCount port=0, sample_t* binding=nullptr)
+        : Connection<AudioBus>(index, port, binding)
+        , m_replace(false)
     { }
 
-    void write(const Environment& env, size_t numFrames, const sample_t* src, size_t offset=0)
+    bool connect(AudioBus* bus, Methcla_BusMappingFlags flags)
+    {
+        const bool changed = Connection<AudioBus>::connect(bus, flags);
+        m_replace = (flags & kMethcla_BusMappingReplace) == kMethcla_BusMappingReplace;
+        return changed;
+    }
+
+    //* Return true if the output replaces the bus contents instead of accumulating.
+    bool replaces() const { return m_replace; }
+
+    //* Return bus memory the port can write the current block to in place, otherwise nullptr.
+    //
+    // Possible when the output is the only port of its synth mapped to the bus, the bus isn't written concurrently and writing would replace the bus contents anyway.
+    sample_t* inPlaceData(const Environment& env, const ProcessContext& context) const
+    {
+        if (isShared() || context.isConcurrent())
+            return nullptr;
+        if (m_replace || bus()->epoch() != env.epoch() || bus()->isSilent())
+            return bus()->data();
+        return nullptr;
+    }
+
+    //* Mark the bus as written after the port has written to it in place.
+    void writeInPlace(const Environment& env)
+    {
+        bus()->setEpoch(env.epoch());
+        bus()->setSilent(false);
+    }
+
+    void write(const Environment& env, ProcessContext& context, size_t numFrames, const sample_t* src)
     {
         if (bus() != nullptr) {
-            sample_t* buffer = bus()->data();
-            if (bus()->epoch() == env.epoch()) { // Bus has been written to in this epoch
-                if ((flags() & kMethcla_BusMappingReplace) == kMethcla_BusMappingReplace) { // Replace
-                    std::copy(src, src + numFrames, buffer + offset);
-                } else { // Accumulate
-                    sample_t* dst = buffer + offset;
-                    // accumulate(dst, src, numFrames);
-                    for (size_t i=0; i < numFrames; i++) {
-                        dst[i] += src[i];
-                    }
+            if (context.isConcurrent()) {
+                // Write to partial sum, applied to the bus in task order after all concurrent tasks have finished
+                ProcessContext::PartialSum& partial = context.acquirePartialSum(bus());
+                if (m_replace) {
+                    methcla_dsp_copy(partial.data, src, numFrames);
+                    partial.replace = true;
+                } else {
+                    methcla_dsp_accumulate(partial.data, src, numFrames);
                 }
-            } else { // Bus hasn't been written in this epoch
-                // Assign
-                memset(buffer, 0, offset * sizeof(sample_t));
-                std::copy(src, src + numFrames, buffer + offset);
-                bus()->setEpoch(env.epoch());
+                partial.silent = false;
+            } else {
+                write(env, numFrames, src);
             }
         }
     }
+
+    //* Write a silent block without touching the bus data.
+    void writeSilence(const Environment& env, ProcessContext& context)
+    {
+        if (bus() != nullptr) {
+            if (context.isConcurrent()) {
+                // Accumulating silence doesn't change the bus contents
+                if (m_replace)
+                    context.replaceWithSilence(context.acquirePartialSum(bus()));
+            } else {
+                writeSilence(env);
+            }
+        }
+    }
+
+private:
+    void write(const Environment& env, size_t numFrames, const sample_t* src)
+    {
+        sample_t* buffer = bus()->data();
+        if (bus()->epoch() == env.epoch() && !bus()->isSilent()) { // Bus has been written to in this epoch
+            if (m_replace) {
+                methcla_dsp_copy(buffer, src, numFrames);
+            } else {
+                methcla_dsp_accumulate(buffer, src, numFrames);
+            }
+        } else { // Bus hasn't been written in this epoch or is silent
+            // Assign
+            methcla_dsp_copy(buffer, src, numFrames);
+            bus()->setEpoch(env.epoch());
+            bus()->setSilent(false);
+        }
+    }
+
+    void writeSilence(const Environment& env)
+    {
+        if (bus()->epoch() != env.epoch() || m_replace) {
+            bus()->setEpoch(env.epoch());
+            bus()->setSilent(true);
+        }
+    }
+
+private:
+    bool m_replace;
+};
+
+//* Connection of a control port to a control bus or, for control inputs, to an audio bus.
+//
+// Ports mapped to a control bus are connected to the bus value itself, so that reading or writing a control bus doesn't involve any copying. Control inputs declared with `kMethcla_AudioRate` are connected to a block-length buffer instead of a single value.
+class ControlConnection
+{
+    Methcla_PortCount       m_port;
+    sample_t*               m_buffer;
+    sample_t*               m_bus;
+    AudioInputConnection    m_audioInput;
+
+public:
+    ControlConnection(Methcla_PortCount index, Methcla_PortCount port, sample_t* buffer=nullptr)
+        : m_port(port)
+        , m_buffer(buffer)
+        , m_bus(nullptr)
+        , m_audioInput(index)
+    {}
+
+    //* Return the index of the port in the synth definition's port descriptors.
+    Methcla_PortCount port() const
+    {
+        return m_port;
+    }
+
+    //* Return the block buffer of an audio rate control input or nullptr.
+    sample_t* buffer() const
+    {
+        return m_buffer;
+    }
+
+    //* Return the control bus the port is connected to or nullptr if the port is not mapped.
+    sample_t* bus() const
+    {
+        return m_bus;
+    }
+
+    void connect(sample_t* bus)
+    {
+        m_bus = bus;
+    }
+
+    //* Return the audio bus connection of a control input.
+    AudioInputConnection& audioInput()
+    {
+        return m_audioInput;
+    }
+
+    const AudioInputConnection& audioInput() const
+    {
+        return m_audioInput;
+    }
+
+    //* Return true if the port is mapped to a control bus or an audio bus.
+    bool isMapped() const
+    {
+        return m_bus != nullptr || m_audioInput.bus() != nullptr;
+    }
+
+    //* Return true if the port's value needs to be updated before processing a block.
+    bool needsUpdate() const
+    {
+        return m_audioInput.bus() != nullptr || (m_bus != nullptr && m_buffer != nullptr);
+    }
 };
 
 class Synth : public Node
@@ -144,14 +392,146 @@ protected:
          , Methcla_Synth* synth
          , AudioInputConnection* audioInputConnections
          , AudioOutputConnection* audioOutputConnections
+         , ControlConnection* controlConnections
          , sample_t* controlBuffers
          , sample_t* audioBuffers
          );
     ~Synth();
 
     void construct(const Methcla_SynthOptions* synthOptions);
-    void connectPorts(const Methcla_SynthOptions* synthOptions, OSCPP::Server::ArgStream controls);
-    virtual void doProcess(size_t numFrames) override;
+    void connectPorts(const Methcla_SynthOptions* synthOptions, OSCPP::Server::ArgStream& controls);
+    virtual void doProcess(ProcessContext& context, size_t numFrames) override;
+    virtual void destroy() override;
+
+    //* Return true if the synth has audio inputs and all of them are silent.
+    //
+    // Context: RT
+    bool audioInputsSilent(const ProcessContext& context) const;
+
+    //* Count frames of silent input and mark the synth as done when they exceed its tail length.
+    //
+    // Context: RT
+    void updateTail(bool inputsSilent, size_t numFrames);
+
+    //* Connect control port `index` (inputs followed by outputs) to `bus` or to its own buffer if `bus` is nullptr, removing any audio bus mapping.
+    void mapControlPort(Methcla_PortCount index, sample_t* bus);
+
+    //* Return the current value of control port `index` (inputs followed by outputs).
+    float controlValue(Methcla_PortCount index) const;
+
+    //* Recount mapped control ports after a mapping has changed.
+    void updateControlMappings();
+
+    //* Determine which audio connections share their bus with other ports after a mapping has changed.
+    //
+    // Also updates the bus bundles, which only contain connections that don't share their bus.
+    void updateSharedBuses();
+
+    //* Find the bus bundles among the connected audio ports.
+    void updateBundles();
+
+    //* Connect the ports of the input bundle starting with `x` for the current block if all of its buses are in the same state.
+    //
+    // Returns false if the channels need to be read one by one.
+    //
+    // Context: RT
+    bool bindInputBundle(AudioInputConnection* x, size_t numFrames, sample_t* buffers);
+
+    //* Write the output bundle starting with `x` to its buses if all of them are in the same state.
+    //
+    // Returns false if the channels need to be written one by one.
+    //
+    // Context: RT
+    bool writeOutputBundle(AudioOutputConnection* x, size_t numFrames, const sample_t* buffers);
+
+    //* Connect unmapped audio ports to the scratch buffers of `context`.
+    //
+    // Context: RT
+    void bindUnmappedToScratch(const ProcessContext& context, sample_t* outputBuffers);
+
+    //* Connect the plugin port of an audio connection to `data` if it isn't connected to it already.
+    //
+    // Context: RT
+    template <class T> void bindPort(T& connection, sample_t* data)
+    {
+        if (connection.binding() != data) {
+            m_synthDef.connect(m_synth, connection.port(), data);
+            connection.setBinding(data);
+        }
+    }
+
+    //* Read control inputs mapped to audio buses and fill audio rate inputs mapped to control buses.
+    //
+    // Context: RT
+    void updateControls(ProcessContext& context, size_t numFrames);
+
+    // Processes synths without virtual dispatch.
+    friend class ExecutionPlan;
+
+public:
+    //* Memory layout of a synth instance, shared by all instances of a synth definition created with the same options.
+    struct Layout
+    {
+        Layout(const Environment& env, const SynthDef& synthDef, const Methcla_SynthOptions* synthOptions);
+
+        Methcla_PortCount numControlInputs;
+        Methcla_PortCount numControlOutputs;
+        Methcla_PortCount numAudioInputs;
+        Methcla_PortCount numAudioOutputs;
+        //* Number of control inputs connected to a block buffer.
+        Methcla_PortCount numAudioRateControlInputs;
+        //* True if audio ports are staged in shared scratch buffers instead of buffers reserved in the instance.
+        bool scratchBuffers;
+        size_t audioInputOffset;
+        size_t audioOutputOffset;
+        size_t controlConnectionOffset;
+        size_t controlBufferOffset;
+        size_t audioBufferOffset;
+        //* Size of an instance in bytes, including alignment padding.
+        size_t allocSize;
+    };
+
+    //* Synths of the same definition allocated in a single block of memory.
+    //
+    // The block is freed when the last synth of the batch is freed.
+    class Batch
+    {
+    public:
+        //* Allocate memory for up to `numSynths` synths with `layout`.
+        //
+        // Context: RT
+        static Batch* alloc(Environment& env, const Layout& layout, size_t numSynths);
+
+        //* Construct the next synth of the batch, reading its control initializers from `controls`.
+        //
+        // Context: RT
+        Synth* construct(Environment& env, NodeId nodeId, const SynthDef& synthDef, const Methcla_SynthOptions* synthOptions, const Layout& layout, OSCPP::Server::ArgStream& controls);
+
+        //* Return number of synths constructed.
+        size_t size() const { return m_numSynths; }
+
+        //* Return synth at index.
+        Synth* synth(size_t index);
+
+        //* Destroy all synths constructed so far, which must not have been added to the node tree, and free the batch.
+        //
+        // Context: RT
+        void destroy(Environment& env);
+
+    private:
+        friend class Synth;
+
+        Batch() = default;
+        static void free(Environment& env, Batch* batch);
+
+        char*   m_memory;
+        size_t  m_instanceSize;
+        // Number of live synths
+        size_t  m_numSynths;
+    };
+
+protected:
+    static Synth* construct(Environment& env, NodeId nodeId, const SynthDef& synthDef, const Methcla_SynthOptions* synthOptions, const Layout& layout, char* mem, Batch* batch, OSCPP::Server::ArgStream& controls);
 
 public:
     static Synth* construct(Environment& env, NodeId nodeId, const SynthDef& synthDef, OSCPP::Server::ArgStream controls, OSCPP::Server::ArgStream args);
@@ -164,59 +544,121 @@ public:
     //* Return this synth's SynthDef.
     const SynthDef& synthDef() const { return m_synthDef; }
 
+#if METHCLA_PROFILING
+    virtual Utility::Profile::Counter profile() const override { return m_profile.value(); }
+#endif
+
     //* Return number of audio inputs.
     Methcla_PortCount numAudioInputs() const { return m_numAudioInputs; }
 
+    //* Return number of audio inputs that are mapped to a bus.
+    Methcla_PortCount numConnectedAudioInputs() const { return m_numConnectedAudioInputs; }
+
+    //* Return audio input connection at position.
+    //
+    // Connections are kept ordered such that the first numConnectedAudioInputs() connections are mapped to a bus; use AudioInputConnection::index() to get the port index.
+    const AudioInputConnection& audioInputConnection(Methcla_PortCount index) const
+    {
+        assert( index < numAudioInputs() );
+        return m_audioInputConnections[index];
+    }
+
     //* Map input to bus.
-    void mapInput(Methcla_PortCount input, const AudioBusId& busId, Methcla_BusMappingFlags flags);
+    void mapInput(Methcla_PortCount input, const AudioBusId& busId, Methcla_BusMappingFlags flags)
+    {
+        mapInputs(input, busId, 1, flags);
+    }
+
+    //* Map `numChannels` inputs starting at `input` to consecutive buses starting at `busId`.
+    void mapInputs(Methcla_PortCount input, const AudioBusId& busId, Methcla_PortCount numChannels, Methcla_BusMappingFlags flags);
 
     //* Return number of audio outputs.
     Methcla_PortCount numAudioOutputs() const { return m_numAudioOutputs; }
 
+    //* Return number of audio outputs that are mapped to a bus.
+    Methcla_PortCount numConnectedAudioOutputs() const { return m_numConnectedAudioOutputs; }
+
+    //* Return audio output connection at position.
+    //
+    // Connections are kept ordered such that the first numConnectedAudioOutputs() connections are mapped to a bus; use AudioOutputConnection::index() to get the port index.
+    const AudioOutputConnection& audioOutputConnection(Methcla_PortCount index) const
+    {
+        assert( index < numAudioOutputs() );
+        return m_audioOutputConnections[index];
+    }
+
     //* Map output to bus.
-    void mapOutput(Methcla_PortCount output, const AudioBusId& busId, Methcla_BusMappingFlags flags);
+    //
+    // Audio ports are connected to bus memory directly for blocks where that is equivalent to copying, e.g. for inputs reading a bus written earlier in the block and for outputs replacing a bus no other port of the synth uses. Plugins must thus not write to their audio inputs.
+    void mapOutput(Methcla_PortCount output, const AudioBusId& busId, Methcla_BusMappingFlags flags)
+    {
+        mapOutputs(output, busId, 1, flags);
+    }
+
+    //* Map `numChannels` outputs starting at `output` to consecutive buses starting at `busId`.
+    void mapOutputs(Methcla_PortCount output, const AudioBusId& busId, Methcla_PortCount numChannels, Methcla_BusMappingFlags flags);
 
     Methcla_PortCount numControlInputs() const { return m_numControlInputs; }
     Methcla_PortCount numControlOutputs() const { return m_numControlOutputs; }
 
+    //* Return control input value at index, read from the control bus if the input is mapped.
     float controlInput(Methcla_PortCount index) const
     {
         assert( index < numControlInputs() );
-        return m_controlBuffers[index];
+        return controlValue(index);
     }
 
-    float& controlInput(Methcla_PortCount index)
+    //* Return control output value at index, read from the control bus if the output is mapped.
+    float controlOutput(Methcla_PortCount index) const
     {
-        assert( index < numControlInputs() );
-        return m_controlBuffers[index];
+        assert( index < numControlOutputs() );
+        return controlValue(numControlInputs() + index);
     }
 
-    float controlOutput(Methcla_PortCount index) const
+    //* Set control input at index, unmapping it from a control bus.
+    void setControlInput(Methcla_PortCount index, float value);
+
+    //* Map control input to control bus or unmap it if `bus` is nullptr.
+    //
+    // The port is connected directly to the bus; when unmapping, the port is connected to its own buffer again, which is initialized with the last bus value.
+    void mapControlInput(Methcla_PortCount index, sample_t* bus);
+
+    //* Map control input to audio bus or unmap it if `bus` is nullptr.
+    //
+    // Audio rate inputs receive the bus contents for each frame, other inputs are updated with the first frame of each block.
+    void mapControlInputToAudioBus(Methcla_PortCount index, AudioBus* bus, Methcla_BusMappingFlags flags);
+
+    //* Map control output to control bus or unmap it if `bus` is nullptr.
+    void mapControlOutput(Methcla_PortCount index, sample_t* bus);
+
+    //* Return true if any control port is mapped to a control bus or an audio bus.
+    bool hasControlMappings() const
     {
-        assert( index < numControlOutputs() );
-        return m_controlBuffers[numControlInputs() + index];
+        return m_numControlMappings > 0;
     }
 
-    //* Activate synth.
-    void activate(double sampleOffset=0.);
+    //* Activate synth; it is processed from the start of the next block on.
+    void activate();
 
-    /// Sample offset for sample accurate synth scheduling.
-    float sampleOffset() const
+    //* Return true if the synth has been activated.
+    bool isActive() const
     {
-        return m_sampleOffset;
+        return m_flags.state != kStateInactive;
     }
 
 private:
     enum State
     {
         kStateInactive,
-        kStateActive,
-        kStateActivating
+        kStateActive
     };
 
     struct Flags
     {
-        unsigned int state : 2;
+        unsigned int state : 1;
+        unsigned int tailReleased : 1;
+        // Audio ports are staged in the scratch buffers of the processing context
+        unsigned int scratchBuffers : 1;
     };
 
     const SynthDef&         m_synthDef;
@@ -225,10 +667,21 @@ private:
     const Methcla_PortCount m_numAudioInputs;
     const Methcla_PortCount m_numAudioOutputs;
     Flags                   m_flags;
-    double                  m_sampleOffset;
+    size_t                  m_silentFrames;
+    size_t                  m_tailFrames;
+    Batch*                  m_batch;
+    size_t                  m_allocSize;
     Methcla_Synth*          m_synth;
     AudioInputConnection*   m_audioInputConnections;
     AudioOutputConnection*  m_audioOutputConnections;
+    Methcla_PortCount       m_numConnectedAudioInputs;
+    Methcla_PortCount       m_numConnectedAudioOutputs;
+    ControlConnection*      m_controlConnections;
+    Methcla_PortCount       m_numControlMappings;
+#if METHCLA_PROFILING
+    Utility::Profile::LocalCounter m_profile;
+#endif
+    Methcla_PortCount       m_numControlUpdates;
     sample_t*               m_controlBuffers;
     sample_t*               m_audioBuffers;
 };
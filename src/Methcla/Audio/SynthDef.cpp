@@ -21,8 +21,9 @@
 
 using namespace Methcla::Audio;
 
-SynthDef::SynthDef(const Methcla_SynthDef* synthDef)
+SynthDef::SynthDef(const Methcla_SynthDef* synthDef, Memory::RTMemoryManager& rtMem, size_t instancePoolSize)
     : m_descriptor(synthDef)
+    , m_instancePool(rtMem, instancePoolSize)
 {
     // Validate descriptor fields (some are optional)
     if (m_descriptor->uri == nullptr || m_descriptor->uri[0] == '\0')
@@ -19,8 +19,10 @@
 #include <methcla/plugin.h>
 
 #include "Methcla/Memory.hpp"
+#include "Methcla/Memory/Manager.hpp"
 #include "Methcla/Plugin/Loader.hpp"
 #include "Methcla/Utility/Hash.hpp"
+#include "Methcla/Utility/Profile.hpp"
 
 #include <cstring>
 #include <list>
@@ -36,7 +38,8 @@ class Synth;
 class SynthDef
 {
 public:
-    SynthDef(const Methcla_SynthDef* def);
+    //* Create a synth definition whose instances are recycled through a free list of up to `instancePoolSize` blocks allocated from `rtMem`.
+    SynthDef(const Methcla_SynthDef* def, Memory::RTMemoryManager& rtMem, size_t instancePoolSize);
     ~SynthDef();
 
     SynthDef(const SynthDef&) = delete;
@@ -46,6 +49,21 @@ public:
 
     inline size_t instanceSize () const { return m_descriptor->instance_size; }
 
+    //* Return true if silent audio inputs produce silent audio outputs.
+    inline bool silentInputSilentOutput() const
+    {
+        return (m_descriptor->flags & kMethcla_SynthDefSilentInputSilentOutput) == kMethcla_SynthDefSilentInputSilentOutput;
+    }
+
+    //* Return true if synth instances report a tail length.
+    inline bool hasTailLength() const { return m_descriptor->tail_length != nullptr; }
+
+    //* Return the tail length of a synth instance in seconds.
+    inline double tailLength(const Methcla_World* world, const Methcla_Synth* synth) const
+    {
+        return m_descriptor->tail_length(world, synth);
+    }
+
     // NOTE: Uses static data and should only be called from a single thread (normally the audio thread) at a time.
     const Methcla_SynthOptions* configure(OSCPP::Server::ArgStream options) const;
 
@@ -70,9 +88,29 @@ public:
         m_descriptor->process(world, synth, numFrames);
     }
 
+    //* Return the free list for instance memory.
+    Memory::RTFreeList& instancePool() const
+    {
+        return m_instancePool;
+    }
+
+#if METHCLA_PROFILING
+    //* Return the DSP time accumulated by all instances of this definition.
+    //
+    // Context: RT
+    Utility::Profile::SharedCounter& profile() const
+    {
+        return m_profile;
+    }
+#endif
+
 private:
     const Methcla_SynthDef* m_descriptor;
     Methcla_SynthOptions*   m_options; // Only access from one thread
+    mutable Memory::RTFreeList m_instancePool;
+#if METHCLA_PROFILING
+    mutable Utility::Profile::SharedCounter m_profile;
+#endif
 };
 
 typedef std::unordered_map<const char*,
@@ -0,0 +1,238 @@
+// Copyright 2012-2014 Samplecount S.L.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Methcla/Audio/ThreadPool.hpp"
+
+#include <cassert>
+
+#if defined(__APPLE__) || defined(__linux__)
+# define METHCLA_THREADPOOL_USE_PTHREAD 1
+# include <pthread.h>
+# include <sched.h>
+#endif
+
+using namespace Methcla::Audio;
+
+static const uint64_t kIndexBits = 24;
+static const uint64_t kIndexMask = (uint64_t(1) << kIndexBits) - 1;
+static const uint32_t kGenerationMask = 0xffff;
+
+static inline uint64_t packRange(uint64_t generation, uint64_t begin, uint64_t end)
+{
+    return (generation << (2 * kIndexBits)) | (begin << kIndexBits) | end;
+}
+
+static inline uint32_t rangeGeneration(uint64_t range)
+{
+    return range >> (2 * kIndexBits);
+}
+
+static inline uint64_t rangeBegin(uint64_t range)
+{
+    return (range >> kIndexBits) & kIndexMask;
+}
+
+static inline uint64_t rangeEnd(uint64_t range)
+{
+    return range & kIndexMask;
+}
+
+static inline void relax()
+{
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || (defined(__arm__) && defined(__ARM_ARCH_7A__))
+    __asm__ __volatile__("yield");
+#endif
+}
+
+ThreadPool::ThreadPool(size_t numHelperThreads)
+    : m_continue(true)
+    , m_awake(false)
+    , m_schedPolicy(0)
+    , m_schedPriority(0)
+    , m_schedGeneration(0)
+    , m_task(nullptr)
+    , m_data(nullptr)
+    , m_generation(0)
+    , m_pending(0)
+    , m_ranges(new Range[numHelperThreads + 1])
+{
+    for (size_t i=0; i <= numHelperThreads; i++) {
+        m_ranges[i].value.store(packRange(0, 0, 0), std::memory_order_relaxed);
+    }
+
+    const unsigned numCores = std::thread::hardware_concurrency();
+
+    for (size_t i=1; i <= numHelperThreads; i++) {
+        m_threads.emplace_back([this,i](){ this->helper(i); });
+#if defined(__linux__)
+        // Pin helper threads to distinct cores, leaving the first one to the audio thread if possible.
+        if (numCores > 1) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(i % numCores, &cpus);
+            pthread_setaffinity_np(m_threads.back().native_handle(), sizeof(cpu_set_t), &cpus);
+        }
+#else
+        (void)numCores;
+#endif
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    m_awake.store(false, std::memory_order_relaxed);
+    m_continue.store(false, std::memory_order_relaxed);
+    // Signal *all* threads
+    for (size_t i=0; i < m_threads.size(); i++) {
+        m_wakeup.post();
+    }
+    for (auto& t : m_threads) { t.join(); }
+}
+
+void ThreadPool::wakeup()
+{
+#if METHCLA_THREADPOOL_USE_PTHREAD
+    // Let helper threads inherit the audio thread's scheduling parameters.
+    int policy;
+    struct sched_param param;
+    if (pthread_getschedparam(pthread_self(), &policy, &param) == 0
+        && (policy != m_schedPolicy.load(std::memory_order_relaxed)
+            || param.sched_priority != m_schedPriority.load(std::memory_order_relaxed)))
+    {
+        m_schedPolicy.store(policy, std::memory_order_relaxed);
+        m_schedPriority.store(param.sched_priority, std::memory_order_relaxed);
+        m_schedGeneration.fetch_add(1, std::memory_order_release);
+    }
+#endif
+
+    m_awake.store(true, std::memory_order_release);
+    for (size_t i=0; i < m_threads.size(); i++) {
+        m_wakeup.post();
+    }
+}
+
+void ThreadPool::sleep()
+{
+    assert( m_pending.load(std::memory_order_relaxed) == 0 );
+    m_awake.store(false, std::memory_order_relaxed);
+}
+
+void ThreadPool::run(Task task, void* data, size_t numTasks)
+{
+    assert( numTasks <= kIndexMask );
+    assert( m_pending.load(std::memory_order_relaxed) == 0 );
+
+    if (numTasks == 0)
+        return;
+
+    const uint32_t generation = (m_generation.load(std::memory_order_relaxed) + 1) & kGenerationMask;
+    const size_t numThreads = this->numThreads();
+
+    m_task.store(task, std::memory_order_relaxed);
+    m_data.store(data, std::memory_order_relaxed);
+    m_pending.store(numTasks, std::memory_order_relaxed);
+
+    // Distribute tasks evenly
+    for (size_t i=0; i < numThreads; i++) {
+        m_ranges[i].value.store(
+            packRange(generation, i * numTasks / numThreads, (i + 1) * numTasks / numThreads),
+            std::memory_order_relaxed
+        );
+    }
+
+    // Publish job
+    m_generation.store(generation, std::memory_order_release);
+
+    // Take part in processing
+    while (performTask(0)) { }
+
+    // Wait for helper threads to finish their tasks
+    while (m_pending.load(std::memory_order_acquire) > 0) {
+        relax();
+    }
+}
+
+bool ThreadPool::performTask(size_t index)
+{
+    const uint32_t generation = m_generation.load(std::memory_order_acquire);
+    // Task and data are valid as long as a task of the current generation can be claimed.
+    Task task = m_task.load(std::memory_order_relaxed);
+    void* data = m_data.load(std::memory_order_relaxed);
+
+    // Pop task from the front of our own range.
+    std::atomic<uint64_t>& own = m_ranges[index].value;
+    uint64_t range = own.load(std::memory_order_acquire);
+    while (rangeGeneration(range) == generation && rangeBegin(range) < rangeEnd(range))
+    {
+        if (own.compare_exchange_weak(range, packRange(generation, rangeBegin(range) + 1, rangeEnd(range)), std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            task(data, rangeBegin(range));
+            m_pending.fetch_sub(1, std::memory_order_acq_rel);
+            return true;
+        }
+    }
+
+    // Steal task from the back of another thread's range.
+    const size_t numThreads = this->numThreads();
+    for (size_t i=1; i < numThreads; i++)
+    {
+        std::atomic<uint64_t>& victim = m_ranges[(index + i) % numThreads].value;
+        range = victim.load(std::memory_order_acquire);
+        while (rangeGeneration(range) == generation && rangeBegin(range) < rangeEnd(range))
+        {
+            if (victim.compare_exchange_weak(range, packRange(generation, rangeBegin(range), rangeEnd(range) - 1), std::memory_order_acq_rel, std::memory_order_acquire))
+            {
+                task(data, rangeEnd(range) - 1);
+                m_pending.fetch_sub(1, std::memory_order_acq_rel);
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::helper(size_t index)
+{
+    uint32_t schedGeneration = 0;
+
+    for (;;)
+    {
+        m_wakeup.wait();
+
+        if (!m_continue.load(std::memory_order_relaxed))
+            break;
+
+#if METHCLA_THREADPOOL_USE_PTHREAD
+        const uint32_t curSchedGeneration = m_schedGeneration.load(std::memory_order_acquire);
+        if (curSchedGeneration != schedGeneration)
+        {
+            struct sched_param param;
+            param.sched_priority = m_schedPriority.load(std::memory_order_relaxed);
+            pthread_setschedparam(pthread_self(), m_schedPolicy.load(std::memory_order_relaxed), &param);
+            schedGeneration = curSchedGeneration;
+        }
+#else
+        (void)schedGeneration;
+#endif
+
+        while (m_awake.load(std::memory_order_acquire))
+        {
+            if (!performTask(index))
+                relax();
+        }
+    }
+}
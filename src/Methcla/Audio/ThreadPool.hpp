@@ -0,0 +1,102 @@
+// Copyright 2012-2014 Samplecount S.L.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef METHCLA_AUDIO_THREADPOOL_HPP_INCLUDED
+#define METHCLA_AUDIO_THREADPOOL_HPP_INCLUDED
+
+#include "Methcla/Utility/Semaphore.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace Methcla { namespace Audio {
+
+//* Pool of realtime helper threads for processing parts of the DSP graph in parallel.
+//
+// Helper threads sleep on a semaphore between audio blocks. The audio thread wakes them up when it is about to process parallel work, and while awake they spin waiting for tasks. The audio thread takes part in executing tasks and `run` only returns when all tasks have finished.
+//
+// The tasks of a job are split into contiguous ranges, one per thread. Each thread takes tasks from the front of its own range and, when it runs out of work, steals single tasks from the back of the other threads' ranges. On Linux helper threads are pinned to a fixed CPU core.
+class ThreadPool
+{
+public:
+    typedef void (*Task)(void* data, size_t index);
+
+    //* Create a pool with `numHelperThreads` helper threads.
+    ThreadPool(size_t numHelperThreads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    //* Return the number of threads executing tasks, including the audio thread.
+    size_t numThreads() const
+    {
+        return m_threads.size() + 1;
+    }
+
+    //* Wake up helper threads.
+    //
+    // Context: RT
+    void wakeup();
+
+    //* Send helper threads back to sleep.
+    //
+    // Context: RT
+    void sleep();
+
+    //* Call `task` with indices [0, numTasks) distributed over all threads and return when all tasks are done.
+    //
+    // Context: RT
+    void run(Task task, void* data, size_t numTasks);
+
+private:
+    void helper(size_t index);
+    bool performTask(size_t index);
+
+private:
+    std::vector<std::thread>    m_threads;
+    Utility::Semaphore          m_wakeup;
+    std::atomic<bool>           m_continue;
+    std::atomic<bool>           m_awake;
+
+    // Scheduling parameters of the audio thread, applied to helper threads when they wake up.
+    std::atomic<int>            m_schedPolicy;
+    std::atomic<int>            m_schedPriority;
+    std::atomic<uint32_t>       m_schedGeneration;
+
+    // Current job
+    std::atomic<Task>           m_task;
+    std::atomic<void*>          m_data;
+    std::atomic<uint32_t>       m_generation;
+    std::atomic<size_t>         m_pending;
+
+    // Task range of each thread (index 0 is the audio thread)
+    struct Range
+    {
+        // Generation (16 bits), begin (24 bits) and end (24 bits).
+        std::atomic<uint64_t>   value;
+        // Avoid false sharing between threads
+        char                    padding[64 - sizeof(std::atomic<uint64_t>)];
+    };
+
+    std::unique_ptr<Range[]>    m_ranges;
+};
+
+} }
+
+#endif // METHCLA_AUDIO_THREADPOOL_HPP_INCLUDED
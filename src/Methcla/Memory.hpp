@@ -104,6 +104,9 @@ private:
 //* Alignment needed for data accessed by SIMD instructions.
 static const Alignment kSIMDAlignment(16);
 
+//* Alignment that keeps data from sharing a cache line with unrelated data.
+static const Alignment kCacheLineAlignment(64);
+
 //* Allocate memory of `size` bytes.
 //
 // @throw std::invalid_argument
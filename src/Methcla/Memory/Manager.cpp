@@ -14,6 +14,7 @@
 
 #include "Methcla/Memory/Manager.hpp"
 #include <stdexcept>    // std::invalid_argument
+#include <mutex>        // std::lock_guard
 #include <new>          // std::bad_alloc
 
 // Set to 1 to disable the realtime memory manager.
@@ -25,11 +26,15 @@ using namespace Methcla::Memory;
 RTMemoryManager::RTMemoryManager(size_t)
     : m_memory(nullptr)
     , m_pool(nullptr)
+    , m_freeListHits(0)
+    , m_freeListMisses(0)
 { }
 #else
 RTMemoryManager::RTMemoryManager(size_t poolSize)
     : m_memory(nullptr)
     , m_pool(nullptr)
+    , m_freeListHits(0)
+    , m_freeListMisses(0)
 {
     const size_t allocSize = tlsf_overhead() + poolSize;
     m_memory = Memory::alloc(allocSize);
@@ -57,7 +62,11 @@ void* RTMemoryManager::alloc(size_t size)
 #else
     if (size == 0)
         throw std::invalid_argument("allocation size must be greater than zero");
-    void* ptr = tlsf_malloc(m_pool, size);
+    void* ptr;
+    {
+        std::lock_guard<Utility::Spinlock> lock(m_lock);
+        ptr = tlsf_malloc(m_pool, size);
+    }
     if (ptr == nullptr)
         throw std::bad_alloc();
     return ptr;
@@ -69,8 +78,10 @@ void RTMemoryManager::free(void* ptr) noexcept
 #if METHCLA_NO_RT_MEMORY
     Methcla::Memory::free(ptr);
 #else
-    if (ptr != nullptr)
+    if (ptr != nullptr) {
+        std::lock_guard<Utility::Spinlock> lock(m_lock);
         tlsf_free(m_pool, ptr);
+    }
 #endif
 }
 
@@ -81,7 +92,11 @@ void* RTMemoryManager::allocAligned(Alignment align, size_t size)
 #else
     if (size == 0)
         throw std::invalid_argument("allocation size must be greater than zero");
-    void* ptr = tlsf_memalign(m_pool, align, size);
+    void* ptr;
+    {
+        std::lock_guard<Utility::Spinlock> lock(m_lock);
+        ptr = tlsf_memalign(m_pool, align, size);
+    }
     if (ptr == nullptr)
         throw std::bad_alloc();
     return ptr;
@@ -93,8 +108,10 @@ void RTMemoryManager::freeAligned(void* ptr) noexcept
 #if METHCLA_NO_RT_MEMORY
     Methcla::Memory::freeAligned(ptr);
 #else
-    if (ptr != nullptr)
+    if (ptr != nullptr) {
+        std::lock_guard<Utility::Spinlock> lock(m_lock);
         tlsf_free(m_pool, ptr);
+    }
 #endif
 }
 
@@ -112,8 +129,78 @@ RTMemoryManager::Statistics RTMemoryManager::statistics() const
     Statistics stats;
     stats.freeNumBytes = 0;
     stats.usedNumBytes = 0;
+    stats.freeListHits = m_freeListHits.load(std::memory_order_relaxed);
+    stats.freeListMisses = m_freeListMisses.load(std::memory_order_relaxed);
 #if !METHCLA_NO_RT_MEMORY
+    std::lock_guard<Utility::Spinlock> lock(m_lock);
     tlsf_walk_heap(m_pool, collectStatistics, &stats);
 #endif
     return stats;
 }
+
+RTFreeList::RTFreeList(RTMemoryManager& memory, size_t capacity)
+    : m_memory(memory)
+    , m_capacity(capacity)
+    , m_blockSize(0)
+    , m_head(nullptr)
+    , m_size(0)
+{
+}
+
+RTFreeList::~RTFreeList()
+{
+    while (m_head != nullptr) {
+        Block* block = m_head;
+        m_head = block->next;
+        m_memory.free(block);
+    }
+}
+
+void RTFreeList::push(void* ptr)
+{
+    Block* block = static_cast<Block*>(ptr);
+    block->next = m_head;
+    m_head = block;
+    m_size++;
+}
+
+void* RTFreeList::alloc(size_t size)
+{
+    {
+        std::lock_guard<Utility::Spinlock> lock(m_lock);
+        if (m_blockSize == 0 && m_capacity > 0 && size >= sizeof(Block)) {
+            // The first allocation determines the block size; reserve blocks in one go.
+            m_blockSize = size;
+            try {
+                while (m_size < m_capacity) {
+                    push(m_memory.alloc(size));
+                }
+            } catch (std::bad_alloc&) {
+                // Continue with the blocks reserved so far
+            }
+        }
+        if (size == m_blockSize && m_head != nullptr) {
+            Block* block = m_head;
+            m_head = block->next;
+            m_size--;
+            m_memory.m_freeListHits.fetch_add(1, std::memory_order_relaxed);
+            return block;
+        }
+    }
+    m_memory.m_freeListMisses.fetch_add(1, std::memory_order_relaxed);
+    return m_memory.alloc(size);
+}
+
+void RTFreeList::free(void* ptr, size_t size) noexcept
+{
+    if (ptr != nullptr) {
+        {
+            std::lock_guard<Utility::Spinlock> lock(m_lock);
+            if (size == m_blockSize && m_size < m_capacity) {
+                push(ptr);
+                return;
+            }
+        }
+        m_memory.free(ptr);
+    }
+}
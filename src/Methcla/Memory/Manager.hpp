@@ -16,10 +16,12 @@
 #define METHCLA_MEMORY_MANAGER_HPP_INCLUDED
 
 #include "Methcla/Memory.hpp"
+#include "Methcla/Utility/Spinlock.hpp"
 
 #include <boost/type_traits/alignment_of.hpp>
 #include <boost/type_traits/aligned_storage.hpp>
 
+#include <atomic>
 #include <cassert>
 #include <cstddef>
 #include <tlsf.h>
@@ -97,13 +99,70 @@ public:
     {
         size_t freeNumBytes;
         size_t usedNumBytes;
+        //* Number of allocations served from a free list.
+        size_t freeListHits;
+        //* Number of free list allocations that fell back to the heap.
+        size_t freeListMisses;
     };
 
     Statistics statistics() const;
 
 private:
-    void*       m_memory;
-    tlsf_pool   m_pool;
+    friend class RTFreeList;
+
+    void*               m_memory;
+    tlsf_pool           m_pool;
+    // Protects the pool when allocating from realtime helper threads.
+    mutable Utility::Spinlock m_lock;
+    std::atomic<size_t> m_freeListHits;
+    std::atomic<size_t> m_freeListMisses;
+};
+
+//* Free list of equally sized memory blocks in front of a realtime memory manager.
+//
+// The block size is fixed by the first allocation, at which point `capacity` blocks are reserved from the heap. Blocks of that size are recycled in constant time and up to `capacity` freed blocks are kept for reuse, which avoids fragmenting the heap when objects of the same size are allocated and freed at a high rate. Allocations of other sizes are passed through to the heap.
+class RTFreeList
+{
+public:
+    RTFreeList(RTMemoryManager& memory, size_t capacity);
+    ~RTFreeList();
+
+    RTFreeList(const RTFreeList&) = delete;
+    RTFreeList& operator=(const RTFreeList&) = delete;
+
+    //* Allocate a block of `size` bytes.
+    //
+    // @throw std::bad_alloc
+    //
+    // Context: RT
+    void* alloc(size_t size);
+
+    //* Free a block of `size` bytes returned by `alloc`.
+    //
+    // Context: RT
+    void free(void* ptr, size_t size) noexcept;
+
+    //* Return the number of free blocks in the list.
+    size_t size() const
+    {
+        return m_size;
+    }
+
+private:
+    struct Block
+    {
+        Block* next;
+    };
+
+    void push(void* ptr);
+
+    RTMemoryManager&    m_memory;
+    const size_t        m_capacity;
+    size_t              m_blockSize;
+    Block*              m_head;
+    size_t              m_size;
+    // Synths may be freed from realtime helper threads.
+    Utility::Spinlock   m_lock;
 };
 
 template <class T, class Allocator> class AllocatedBase
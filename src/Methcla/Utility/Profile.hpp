@@ -0,0 +1,144 @@
+// Copyright 2012-2014 Samplecount S.L.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef METHCLA_UTILITY_PROFILE_HPP_INCLUDED
+#define METHCLA_UTILITY_PROFILE_HPP_INCLUDED
+
+// DSP time accounting is only compiled in when METHCLA_PROFILING is defined to a non-zero value.
+#if !defined(METHCLA_PROFILING)
+# define METHCLA_PROFILING 0
+#endif
+
+#if METHCLA_PROFILING
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#if defined(__i386__) || defined(__x86_64__)
+# include <x86intrin.h>
+#endif
+
+namespace Methcla { namespace Utility { namespace Profile {
+
+//* Return the current value of a cheap, monotonically increasing cycle counter.
+//
+// Ticks are only meaningful relative to each other; on x86 they count CPU cycles, elsewhere nanoseconds.
+inline uint64_t ticks()
+{
+#if defined(__i386__) || defined(__x86_64__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t value;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(value));
+    return value;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+//* Accumulated ticks and number of measurements.
+struct Counter
+{
+    Counter()
+        : ticks(0)
+        , calls(0)
+    { }
+
+    Counter& operator+=(const Counter& other)
+    {
+        ticks += other.ticks;
+        calls += other.calls;
+        return *this;
+    }
+
+    uint64_t ticks;
+    uint64_t calls;
+};
+
+//* Counter updated by a single thread at a time.
+class LocalCounter
+{
+public:
+    void add(uint64_t ticks)
+    {
+        m_counter.ticks += ticks;
+        m_counter.calls++;
+    }
+
+    Counter value() const { return m_counter; }
+
+private:
+    Counter m_counter;
+};
+
+//* Counter that can be updated concurrently from several threads.
+class SharedCounter
+{
+public:
+    SharedCounter()
+        : m_ticks(0)
+        , m_calls(0)
+    { }
+
+    SharedCounter(const SharedCounter&) = delete;
+    SharedCounter& operator=(const SharedCounter&) = delete;
+
+    void add(uint64_t ticks)
+    {
+        m_ticks.fetch_add(ticks, std::memory_order_relaxed);
+        m_calls.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Counter value() const
+    {
+        Counter result;
+        result.ticks = m_ticks.load(std::memory_order_relaxed);
+        result.calls = m_calls.load(std::memory_order_relaxed);
+        return result;
+    }
+
+private:
+    std::atomic<uint64_t> m_ticks;
+    std::atomic<uint64_t> m_calls;
+};
+
+} } }
+
+//* Declare a tick counter stamp named `name`.
+# define METHCLA_PROFILE_BEGIN(name) \
+    const uint64_t name = Methcla::Utility::Profile::ticks()
+//* Add the ticks elapsed since `name` to each of the given counters.
+# define METHCLA_PROFILE_END(name, ...) \
+    Methcla::Utility::Profile::detail::addElapsed(Methcla::Utility::Profile::ticks() - name, __VA_ARGS__)
+
+namespace Methcla { namespace Utility { namespace Profile { namespace detail {
+    inline void addElapsed(uint64_t) { }
+
+    template <class C, class... Cs> inline void addElapsed(uint64_t ticks, C& counter, Cs&... counters)
+    {
+        counter.add(ticks);
+        addElapsed(ticks, counters...);
+    }
+} } } }
+
+#else // !METHCLA_PROFILING
+
+# define METHCLA_PROFILE_BEGIN(name)
+# define METHCLA_PROFILE_END(name, ...)
+
+#endif // METHCLA_PROFILING
+
+#endif // METHCLA_UTILITY_PROFILE_HPP_INCLUDED
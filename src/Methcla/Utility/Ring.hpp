@@ -0,0 +1,191 @@
+// Copyright 2012-2014 Samplecount S.L.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef METHCLA_UTILITY_RING_HPP_INCLUDED
+#define METHCLA_UTILITY_RING_HPP_INCLUDED
+
+#include "Methcla/Memory.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+namespace Methcla { namespace Utility {
+
+//* Bounded lock-free ring buffer with multiple writers and a single reader.
+//
+// Each slot carries a sequence number that tells writers whether the slot is free and the reader whether it has been written, so that neither side needs a lock. The slots are allocated once, in a single cache line aligned block.
+template <typename T> class Ring
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Ring elements must be trivially copyable");
+
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        T                   value;
+    };
+
+public:
+    //* Construct a ring with room for at least `capacity` elements.
+    Ring(size_t capacity)
+        : m_capacity(roundUpToPowerOfTwo(capacity))
+        , m_slots(Memory::allocAlignedOf<Slot>(Memory::kCacheLineAlignment, m_capacity))
+        , m_writePos(0)
+        , m_readPos(0)
+    {
+        for (size_t i=0; i < m_capacity; i++)
+        {
+            new (&m_slots[i].sequence) std::atomic<size_t>(i);
+        }
+    }
+
+    ~Ring()
+    {
+        Memory::freeAligned(m_slots);
+    }
+
+    Ring(const Ring&) = delete;
+    Ring& operator=(const Ring&) = delete;
+
+    size_t capacity() const
+    {
+        return m_capacity;
+    }
+
+    //* Append value and return true, or return false if the ring is full.
+    //
+    // Context: any thread
+    bool push(const T& value)
+    {
+        size_t pos = m_writePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Slot& slot = m_slots[pos & (m_capacity - 1)];
+            const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            const intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+            if (diff == 0)
+            {
+                // The slot is free; claim it by advancing the write position.
+                if (m_writePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    slot.value = value;
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                // The slot still holds a value that hasn't been read.
+                return false;
+            }
+            else
+            {
+                // Another writer claimed the slot.
+                pos = m_writePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    //* Append `n` values and return true, or return false without appending any value if the ring doesn't have room for all of them.
+    //
+    // The values are read in order, without values from other writers in between.
+    //
+    // Context: any thread
+    bool pushAll(const T* values, size_t n)
+    {
+        if (n == 0)
+            return true;
+        if (n > m_capacity)
+            return false;
+        size_t pos = m_writePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            const size_t sequence = m_slots[pos & (m_capacity - 1)].sequence.load(std::memory_order_acquire);
+            const intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+            if (diff == 0)
+            {
+                // The reader frees slots in order, so all slots up to the last one are free if the last one is.
+                const size_t last = pos + n - 1;
+                if (m_slots[last & (m_capacity - 1)].sequence.load(std::memory_order_acquire) != last)
+                    return false;
+                if (m_writePos.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed))
+                {
+                    for (size_t i=0; i < n; i++)
+                    {
+                        Slot& slot = m_slots[(pos + i) & (m_capacity - 1)];
+                        slot.value = values[i];
+                        slot.sequence.store(pos + i + 1, std::memory_order_release);
+                    }
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                // The slot still holds a value that hasn't been read.
+                return false;
+            }
+            else
+            {
+                // Another writer claimed the slot.
+                pos = m_writePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    //* Return the oldest value or nullptr if the ring is empty.
+    //
+    // Context: reader thread
+    const T* front() const
+    {
+        const Slot& slot = m_slots[m_readPos & (m_capacity - 1)];
+        return slot.sequence.load(std::memory_order_acquire) == m_readPos + 1
+                ? &slot.value
+                : nullptr;
+    }
+
+    //* Remove the value returned by front.
+    //
+    // Context: reader thread
+    void pop()
+    {
+        assert(front() != nullptr);
+        Slot& slot = m_slots[m_readPos & (m_capacity - 1)];
+        slot.sequence.store(m_readPos + m_capacity, std::memory_order_release);
+        m_readPos++;
+    }
+
+private:
+    static size_t roundUpToPowerOfTwo(size_t n)
+    {
+        size_t result = 1;
+        while (result < n)
+            result <<= 1;
+        return result;
+    }
+
+    const size_t        m_capacity;
+    Slot*               m_slots;
+    // Keep the positions updated by writers and reader on separate cache lines.
+    char                m_padding0[64];
+    std::atomic<size_t> m_writePos;
+    char                m_padding1[64];
+    size_t              m_readPos;
+};
+
+} }
+
+#endif // METHCLA_UTILITY_RING_HPP_INCLUDED
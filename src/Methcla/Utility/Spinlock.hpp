@@ -0,0 +1,57 @@
+// Copyright 2012-2014 Samplecount S.L.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef METHCLA_UTILITY_SPINLOCK_HPP_INCLUDED
+#define METHCLA_UTILITY_SPINLOCK_HPP_INCLUDED
+
+#include <atomic>
+
+namespace Methcla { namespace Utility {
+
+//* Busy-waiting lock for very short critical sections on the realtime threads.
+//
+// Satisfies the Lockable concept and can be used with std::lock_guard.
+class Spinlock
+{
+public:
+    Spinlock()
+    {
+        m_flag.clear();
+    }
+
+    Spinlock(const Spinlock&) = delete;
+    Spinlock& operator=(const Spinlock&) = delete;
+
+    void lock()
+    {
+        while (m_flag.test_and_set(std::memory_order_acquire)) { }
+    }
+
+    bool try_lock()
+    {
+        return !m_flag.test_and_set(std::memory_order_acquire);
+    }
+
+    void unlock()
+    {
+        m_flag.clear(std::memory_order_release);
+    }
+
+private:
+    std::atomic_flag m_flag;
+};
+
+} }
+
+#endif // METHCLA_UTILITY_SPINLOCK_HPP_INCLUDED
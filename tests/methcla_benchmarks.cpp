@@ -0,0 +1,176 @@
+// Copyright 2012-2014 Samplecount S.L.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks are disabled by default; run them with
+//
+//     methcla-tests --gtest_also_run_disabled_tests --gtest_filter='*Benchmark*'
+
+#include "methcla_tests.hpp"
+
+#include "Methcla/Audio/Engine.hpp"
+#include "Methcla/Audio/Group.hpp"
+#include "Methcla/Audio/ProcessContext.hpp"
+
+#include <methcla/plugins/node-control.h>
+#include <oscpp/client.hpp>
+
+#include <chrono>
+#include <functional>
+
+namespace test_Methcla_Audio_Benchmarks
+{
+    using Methcla::Audio::Environment;
+
+    static const size_t kNumGroups = 32;
+    static const size_t kNumSynthsPerGroup = 31;
+    static const size_t kNumNodes = kNumGroups * (kNumSynthsPerGroup + 1);
+    static const size_t kNumBlocks = 2000;
+
+    // Create a node tree of groups containing synths that don't do any DSP.
+    static void createNodes(Environment& env, size_t numGroups=kNumGroups)
+    {
+        auto send = [&env](std::function<void(OSCPP::Client::Packet&)> func) {
+            OSCPP::Client::DynamicPacket packet(1024);
+            func(packet);
+            env.send(packet.data(), packet.size());
+        };
+
+        int32_t nodeId = 1;
+
+        for (size_t i=0; i < numGroups; i++)
+        {
+            const int32_t groupId = nodeId++;
+            send([&](OSCPP::Client::Packet& packet) {
+                packet.openMessage("/group/new", 3)
+                    .int32(groupId).int32(0).int32(kMethcla_NodePlacementTailOfGroup)
+                    .closeMessage();
+            });
+            for (size_t k=0; k < kNumSynthsPerGroup; k++)
+            {
+                const int32_t synthId = nodeId++;
+                send([&](OSCPP::Client::Packet& packet) {
+                    packet.openMessage("/synth/new", 4 + OSCPP::Tags::array(0) + OSCPP::Tags::array(1))
+                        .string(METHCLA_PLUGINS_DONE_AFTER_URI)
+                        .int32(synthId).int32(groupId).int32(kMethcla_NodePlacementTailOfGroup)
+                        .openArray().closeArray()
+                        .openArray().float32(1e6f).closeArray()
+                        .closeMessage();
+                });
+                send([&](OSCPP::Client::Packet& packet) {
+                    packet.openMessage("/synth/activate", 1)
+                        .int32(synthId)
+                        .closeMessage();
+                });
+            }
+
+            // Execute commands before the request queue fills up
+            env.process(0, env.blockSize(), nullptr, nullptr);
+        }
+    }
+
+    // Return average processing time per node in nanoseconds.
+    static double measure(std::function<void(size_t)> process, size_t numNodes=kNumNodes)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i=0; i < kNumBlocks; i++)
+        {
+            process(i);
+        }
+        const auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double,std::nano>(end - start).count() / (kNumBlocks * numNodes);
+    }
+};
+
+TEST(Methcla_Audio_Benchmarks, DISABLED_Execution_plan_per_node_overhead)
+{
+    using namespace test_Methcla_Audio_Benchmarks;
+
+    Environment::Options options;
+    options.mode = Environment::kNonRealtimeMode;
+    options.numHardwareInputChannels = 0;
+    options.numHardwareOutputChannels = 0;
+    options.maxNumNodes = 2 * kNumNodes;
+    options.pluginLibraries.push_back(methcla_plugins_node_control);
+
+    Environment env(
+        [](Methcla_LogLevel, const char*){},
+        [](Methcla_RequestId, const void*, size_t){},
+        options
+    );
+
+    createNodes(env);
+
+    const size_t blockSize = env.blockSize();
+
+    // Recursive traversal of the node tree.
+    Methcla::Audio::ProcessContext context;
+    const double treeTime = measure([&](size_t) {
+        env.rootNode()->process(context, blockSize);
+    });
+
+    // Flattened execution plan, including the engine's per-block overhead.
+    const double planTime = measure([&](size_t i) {
+        env.process((i + 1) * blockSize / env.sampleRate(), blockSize, nullptr, nullptr);
+    });
+
+    TEST_COUT << kNumNodes << " nodes: tree " << treeTime << " ns/node, plan " << planTime << " ns/node" << std::endl;
+}
+
+TEST(Methcla_Audio_Benchmarks, DISABLED_Execution_plan_rebuild)
+{
+    using namespace test_Methcla_Audio_Benchmarks;
+
+    for (size_t numHelperThreads : { 0, 2 })
+    {
+        for (size_t numGroups : { 8, 32, 128 })
+        {
+            const size_t numNodes = numGroups * (kNumSynthsPerGroup + 1);
+
+            Environment::Options options;
+            options.mode = Environment::kNonRealtimeMode;
+            options.numHardwareInputChannels = 0;
+            options.numHardwareOutputChannels = 0;
+            options.realtimeMemorySize = numNodes * 1024;
+            options.maxNumNodes = 2 * numNodes;
+            options.numHelperThreads = numHelperThreads;
+            options.pluginLibraries.push_back(methcla_plugins_node_control);
+
+            Environment env(
+                [](Methcla_LogLevel, const char*){},
+                [](Methcla_RequestId, const void*, size_t){},
+                options
+            );
+
+            createNodes(env, numGroups);
+
+            const size_t blockSize = env.blockSize();
+            size_t block = 0;
+            auto process = [&](bool invalidate) {
+                if (invalidate)
+                    env.invalidateExecutionPlan();
+                block++;
+                env.process(block * blockSize / env.sampleRate(), blockSize, nullptr, nullptr);
+            };
+
+            const double validTime = measure([&](size_t) { process(false); }, numNodes);
+            const double rebuildTime = measure([&](size_t) { process(true); }, numNodes);
+            const double rebuildCost = (rebuildTime - validTime) * numNodes * 1e-3;
+            const double blockDuration = blockSize / env.sampleRate() * 1e6;
+
+            TEST_COUT << numNodes << " nodes, " << numHelperThreads << " helper threads: "
+                      << "rebuild " << rebuildCost << " us "
+                      << "(" << 100 * rebuildCost / blockDuration << "% of a block of " << blockSize << " frames)" << std::endl;
+        }
+    }
+}
@@ -21,6 +21,10 @@
 
 #include "gtest/gtest.h"
 
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
 using namespace Methcla::Tests;
 
 TEST(Methcla_Engine, Creation_and_destruction)
@@ -184,3 +188,54 @@ TEST(Methcla_Engine, Node_ended_notification)
     ASSERT_EQ( engine->getNodeTreeStatistics().numSynths, 0ul );
     ASSERT_EQ( engine->nodeIdAllocator().getStatistics().allocated(), 0ul );
 }
+
+TEST(Methcla_Engine, Synths_in_parallel_group_should_be_processed_and_freed)
+{
+    Methcla::EngineOptions options;
+    options.addLibrary(methcla_plugins_sine)
+           .addLibrary(methcla_plugins_node_control);
+    options.numHelperThreads = 2;
+
+    // Declared before the engine, whose notification handlers refer to them
+    std::mutex mutex;
+    std::condition_variable cond;
+    size_t numEnded = 0;
+
+    auto engine = std::unique_ptr<Methcla::Engine>(new Methcla::Engine(options));
+
+    engine->start();
+
+    const size_t numSynths = 32;
+
+    auto whenEnded = [&](Methcla::NodeId) {
+        std::lock_guard<std::mutex> lock(mutex);
+        numEnded++;
+        cond.notify_one();
+    };
+
+    {
+        Methcla::Request request(*engine);
+        request.openBundle();
+        Methcla::GroupId group = request.parGroup(engine->root());
+        for (size_t i=0; i < numSynths; i++)
+        {
+            Methcla::SynthId synth = request.synth(METHCLA_PLUGINS_DONE_AFTER_URI, group, {}, { Methcla::Value(0.01f) });
+            request.whenDone(synth, Methcla::kNodeDoneFreeSelf);
+            request.activate(synth);
+            engine->addNotificationHandler(engine->freeNodeIdHandler(synth, whenEnded));
+        }
+        request.closeBundle();
+        request.send();
+    }
+
+    const Methcla::NodeTreeStatistics stats = engine->getNodeTreeStatistics();
+    EXPECT_EQ( stats.numGroups, 2ul );
+    EXPECT_EQ( stats.numSynths, numSynths );
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        const bool allEnded = cond.wait_for(lock, std::chrono::seconds(10), [&]() { return numEnded == numSynths; });
+        ASSERT_TRUE( allEnded );
+    }
+    ASSERT_EQ( engine->getNodeTreeStatistics().numSynths, 0ul );
+}
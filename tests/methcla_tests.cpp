@@ -17,10 +17,14 @@
 #include "Methcla/Utility/MessageQueue.hpp"
 #include "Methcla/Utility/Semaphore.hpp"
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <functional>
 #include <iostream>
 #include <mutex>
 #include <thread>
+#include <unordered_map>
 
 static std::string gInputFileDirectory = "tests/input";
 static std::string gOutputFileDirectory = "tests/output";
@@ -171,6 +175,122 @@ TEST(Methcla_Utility_WorkerThread, All_commands_should_be_executed)
     }
 }
 
+#include "Methcla/Utility/Ring.hpp"
+
+TEST(Methcla_Utility_Ring, Values_from_all_writers_should_be_read_once_in_order)
+{
+    const size_t numWriters = 4;
+    const uint32_t numValues = 100000;
+
+    Methcla::Utility::Ring<uint64_t> ring(100);
+    EXPECT_EQ( ring.capacity(), 128u );
+
+    // A full ring rejects values
+    for (size_t i=0; i < ring.capacity(); i++)
+        EXPECT_TRUE( ring.push(i) );
+    EXPECT_FALSE( ring.push(0) );
+    for (size_t i=0; i < ring.capacity(); i++) {
+        ASSERT_TRUE( ring.front() != nullptr );
+        EXPECT_EQ( *ring.front(), i );
+        ring.pop();
+    }
+    EXPECT_TRUE( ring.front() == nullptr );
+
+    std::vector<std::thread> writers;
+    for (uint64_t writer=0; writer < numWriters; writer++) {
+        writers.push_back(std::thread([&ring,writer,numValues]() {
+            for (uint64_t i=0; i < numValues; i++) {
+                while (!ring.push((writer << 32) | i))
+                    std::this_thread::yield();
+            }
+        }));
+    }
+
+    std::vector<uint64_t> next(numWriters, 0);
+    for (size_t n=0; n < numWriters * numValues; ) {
+        const uint64_t* value = ring.front();
+        if (value == nullptr) {
+            std::this_thread::yield();
+        } else {
+            const uint64_t writer = *value >> 32;
+            ASSERT_LT( writer, numWriters );
+            ASSERT_EQ( *value & 0xffffffff, next[writer] );
+            next[writer]++;
+            ring.pop();
+            n++;
+        }
+    }
+
+    for (auto& writer : writers)
+        writer.join();
+
+    EXPECT_TRUE( ring.front() == nullptr );
+}
+
+TEST(Methcla_Utility_Ring, Values_pushed_together_should_be_read_together)
+{
+    const size_t numWriters = 4;
+    const uint32_t numBatches = 20000;
+    const size_t batchSize = 5;
+
+    Methcla::Utility::Ring<uint64_t> ring(16);
+
+    // A batch that doesn't fit is rejected as a whole
+    uint64_t batch[batchSize] = { 0, 1, 2, 3, 4 };
+    for (size_t i=0; i < 3; i++)
+        EXPECT_TRUE( ring.pushAll(batch, batchSize) );
+    EXPECT_FALSE( ring.pushAll(batch, batchSize) );
+    EXPECT_TRUE( ring.push(5) );
+    for (size_t i=0; i < 3 * batchSize; i++) {
+        ASSERT_TRUE( ring.front() != nullptr );
+        EXPECT_EQ( *ring.front(), i % batchSize );
+        ring.pop();
+    }
+    EXPECT_EQ( *ring.front(), 5u );
+    ring.pop();
+    EXPECT_FALSE( ring.pushAll(batch, ring.capacity() + 1) );
+    EXPECT_TRUE( ring.front() == nullptr );
+
+    std::vector<std::thread> writers;
+    for (uint64_t writer=0; writer < numWriters; writer++) {
+        writers.push_back(std::thread([&ring,writer,numBatches,batchSize]() {
+            uint64_t values[batchSize];
+            for (uint64_t i=0; i < numBatches; i++) {
+                for (size_t k=0; k < batchSize; k++)
+                    values[k] = (writer << 32) | (i * batchSize + k);
+                while (!ring.pushAll(values, batchSize))
+                    std::this_thread::yield();
+            }
+        }));
+    }
+
+    // Values of a batch are not interleaved with values from other writers
+    uint64_t writer = numWriters;
+    uint64_t next = 0;
+    for (size_t n=0; n < numWriters * numBatches * batchSize; ) {
+        const uint64_t* value = ring.front();
+        if (value == nullptr) {
+            std::this_thread::yield();
+        } else {
+            if (n % batchSize == 0) {
+                writer = *value >> 32;
+                next = *value & 0xffffffff;
+                ASSERT_LT( writer, numWriters );
+                ASSERT_EQ( next % batchSize, 0u );
+            }
+            ASSERT_EQ( *value, (writer << 32) | next );
+            next++;
+            ring.pop();
+            n++;
+        }
+    }
+
+    for (auto& thread : writers)
+        thread.join();
+
+    EXPECT_TRUE( ring.front() == nullptr );
+}
+
 #include "Methcla/Memory/Manager.hpp"
 
 TEST(Methcla_Memory_Manager, Alloc_free_should_be_noop)
@@ -188,3 +308,1785 @@ TEST(Methcla_Memory_Manager, Alloc_free_should_be_noop)
     ASSERT_EQ(stats.freeNumBytes, memSize);
     ASSERT_EQ(stats.usedNumBytes, 0u);
 }
+
+TEST(Methcla_Memory_RTFreeList, Freed_blocks_should_be_recycled)
+{
+    const size_t memSize = 8192;
+    const size_t allocSize = 100;
+    Methcla::Memory::RTMemoryManager mem(memSize);
+    {
+        Methcla::Memory::RTFreeList freeList(mem, 2);
+
+        // First allocation reserves the pool and is served from it.
+        void* a = freeList.alloc(allocSize);
+        void* b = freeList.alloc(allocSize);
+        void* c = freeList.alloc(allocSize);
+        EXPECT_EQ( mem.statistics().freeListHits, 2u );
+        EXPECT_EQ( mem.statistics().freeListMisses, 1u );
+
+        // Blocks are recycled up to the pool capacity.
+        freeList.free(c, allocSize);
+        freeList.free(b, allocSize);
+        freeList.free(a, allocSize);
+        EXPECT_EQ( freeList.size(), 2u );
+        EXPECT_EQ( freeList.alloc(allocSize), b );
+        EXPECT_EQ( mem.statistics().freeListHits, 3u );
+        freeList.free(b, allocSize);
+
+        // Other sizes are passed through to the memory manager.
+        void* d = freeList.alloc(2 * allocSize);
+        EXPECT_EQ( mem.statistics().freeListMisses, 2u );
+        freeList.free(d, 2 * allocSize);
+        EXPECT_EQ( freeList.size(), 2u );
+    }
+    EXPECT_EQ( mem.statistics().usedNumBytes, 0u );
+}
+
+#include "Methcla/Audio/DSP.h"
+
+TEST(Methcla_Audio_DSP, Kernels_should_handle_unaligned_buffers_of_any_length)
+{
+    methcla_dsp_init();
+
+    // Offsets and lengths that aren't multiples of the vector width exercise the scalar remainders.
+    for (size_t offset : { 0, 1, 3 }) {
+        for (size_t n : { 0, 1, 7, 8, 15, 16, 17, 63, 64, 65 }) {
+            std::vector<float> a(n + offset), b(n + offset), expected(n + offset);
+            for (size_t i=0; i < a.size(); i++) {
+                a[i] = expected[i] = (float)i;
+                b[i] = 0.5f * (float)i;
+            }
+            for (size_t i=offset; i < a.size(); i++) {
+                expected[i] += b[i];
+            }
+            methcla_dsp_accumulate(a.data() + offset, b.data() + offset, n);
+            EXPECT_EQ( a, expected );
+
+            methcla_dsp_copy(a.data() + offset, b.data() + offset, n);
+            std::copy(b.begin() + offset, b.end(), expected.begin() + offset);
+            EXPECT_EQ( a, expected );
+
+            methcla_dsp_zero(a.data() + offset, n);
+            std::fill(expected.begin() + offset, expected.end(), 0.f);
+            EXPECT_EQ( a, expected );
+        }
+    }
+}
+
+#include "Methcla/Audio/AudioBus.hpp"
+
+TEST(Methcla_Audio_AudioBusArena, Buses_should_be_aligned_and_prepared_on_demand)
+{
+    using Methcla::Audio::AudioBusId;
+
+    const size_t numBuses = 100;
+    const size_t blockSize = 17;
+    Methcla::Audio::AudioBusArena arena(numBuses, blockSize, 0);
+
+    ASSERT_EQ( arena.size(), numBuses );
+    EXPECT_EQ( arena.numPrepared(), 0u );
+
+    for (size_t i=0; i < numBuses; i++)
+    {
+        Methcla::Audio::AudioBus* bus = arena.bus(AudioBusId(i));
+        EXPECT_TRUE( Methcla::Memory::kCacheLineAlignment.isAligned(bus->data()) );
+        if (i > 0)
+        {
+            // Headers are packed, data slots don't overlap
+            EXPECT_EQ( bus, arena.bus(AudioBusId(i-1)) + 1 );
+            EXPECT_GE( bus->data(), arena.bus(AudioBusId(i-1))->data() + blockSize );
+        }
+    }
+
+    // Preparing buses doesn't change data written before
+    float* data = arena.bus(AudioBusId(50))->data();
+    std::fill(data, data + blockSize, 1.f);
+
+    arena.prepare(10);
+    EXPECT_EQ( arena.numPrepared(), 10u );
+    arena.prepare(2 * numBuses);
+    EXPECT_EQ( arena.numPrepared(), numBuses );
+
+    EXPECT_TRUE( std::all_of(data, data + blockSize, [](float x) { return x == 1.f; }) );
+}
+
+#include "Methcla/Audio/CommandTable.hpp"
+
+namespace test_Methcla_Audio_CommandTable
+{
+    static Methcla_ErrorCode perform(const Methcla_World*, void*, const void*, size_t, const void*, size_t)
+    {
+        return kMethcla_NoError;
+    }
+};
+
+TEST(Methcla_Audio_CommandTable, Registered_addresses_should_be_found_after_growing)
+{
+    using test_Methcla_Audio_CommandTable::perform;
+
+    Methcla::Audio::CommandTable table;
+
+    const Methcla::Audio::CommandTable::Entry* nodeSet = table.lookup("/node/set");
+    ASSERT_TRUE( nodeSet != nullptr );
+    EXPECT_EQ( nodeSet->id, Methcla::Audio::kCommand_NodeSet );
+    EXPECT_TRUE( table.lookup("/node/se") == nullptr );
+    EXPECT_TRUE( table.lookup("/node/set/") == nullptr );
+
+    // Builtin and plugin addresses cannot be registered twice.
+    EXPECT_FALSE( table.insert("/node/set", perform, nullptr) );
+
+    const size_t numBuiltins = table.size();
+    const size_t numCommands = 1000;
+    std::vector<int> data(numCommands);
+    for (size_t i=0; i < numCommands; i++) {
+        const std::string address = "/plugin/command/" + std::to_string(i);
+        EXPECT_TRUE( table.insert(address.c_str(), perform, &data[i]) );
+    }
+    EXPECT_FALSE( table.insert("/plugin/command/0", perform, nullptr) );
+    EXPECT_EQ( table.size(), numBuiltins + numCommands );
+
+    for (size_t i=0; i < numCommands; i++) {
+        const std::string address = "/plugin/command/" + std::to_string(i);
+        const Methcla::Audio::CommandTable::Entry* entry = table.lookup(address.c_str());
+        ASSERT_TRUE( entry != nullptr );
+        EXPECT_EQ( entry->id, Methcla::Audio::kCommand_Plugin );
+        EXPECT_EQ( entry->data, &data[i] );
+    }
+    EXPECT_EQ( table.lookup("/node/set")->id, Methcla::Audio::kCommand_NodeSet );
+}
+
+#include "Methcla/Audio/ThreadPool.hpp"
+
+namespace test_Methcla_Audio_ThreadPool
+{
+    struct Job
+    {
+        std::vector<std::atomic<size_t>>* counts;
+    };
+
+    static void countTask(void* data, size_t index)
+    {
+        (*static_cast<Job*>(data)->counts)[index]++;
+    }
+};
+
+TEST(Methcla_Audio_ThreadPool, All_tasks_should_be_executed_once)
+{
+    using test_Methcla_Audio_ThreadPool::Job;
+    using test_Methcla_Audio_ThreadPool::countTask;
+
+    const size_t numTasks = 100;
+    const size_t numJobs = 50;
+
+    for (size_t threadCount=0; threadCount <= 3; threadCount++) {
+        Methcla::Audio::ThreadPool pool(threadCount);
+        std::vector<std::atomic<size_t>> counts(numTasks);
+        for (auto& x : counts) x = 0;
+        Job job;
+        job.counts = &counts;
+
+        pool.wakeup();
+        for (size_t i=0; i < numJobs; i++) {
+            pool.run(countTask, &job, i % 2 == 0 ? numTasks : numTasks / 2);
+        }
+        pool.sleep();
+
+        for (size_t i=0; i < numTasks; i++) {
+            EXPECT_EQ(counts[i].load(), i < numTasks / 2 ? numJobs : numJobs / 2);
+        }
+    }
+}
+
+#include "Methcla/Audio/Engine.hpp"
+#include "Methcla/Audio/ExecutionPlan.hpp"
+#include "Methcla/Exception.hpp"
+
+#include <methcla/plugins/node-control.h>
+#include <methcla/plugins/patch-cable.h>
+#include <methcla/plugins/sine.h>
+#include <oscpp/client.hpp>
+#include "plugins/test-support.h"
+
+namespace test_Methcla_Audio_Environment
+{
+    //* Return options for a non-realtime environment with `numOutputs` hardware outputs, no hardware inputs and the given plugin libraries.
+    static Methcla::Audio::Environment::Options makeOptions(size_t numOutputs, std::initializer_list<Methcla_LibraryFunction> plugins)
+    {
+        Methcla::Audio::Environment::Options options;
+        options.mode = Methcla::Audio::Environment::kNonRealtimeMode;
+        options.numHardwareInputChannels = 0;
+        options.numHardwareOutputChannels = numOutputs;
+        options.pluginLibraries.assign(plugins.begin(), plugins.end());
+        return options;
+    }
+
+    // Constructed before the environment, which might log errors while starting up.
+    class ErrorCounter
+    {
+    public:
+        ErrorCounter()
+            : m_numErrors(0)
+        { }
+
+        //* Return number of errors logged so far.
+        size_t numErrors() const
+        {
+            return m_numErrors.load();
+        }
+
+    protected:
+        std::atomic<size_t> m_numErrors;
+    };
+
+    //* Environment driven by the test in non-realtime mode that counts the errors it logs.
+    class TestEnvironment : public ErrorCounter, public Methcla::Audio::Environment
+    {
+    public:
+        TestEnvironment(const Options& options, Methcla::Audio::PacketHandler packetHandler=[](Methcla_RequestId, const void*, size_t){})
+            : Environment(
+                [this](Methcla_LogLevel level, const char*) {
+                    if (level == kMethcla_LogError) m_numErrors++;
+                },
+                packetHandler,
+                options)
+            , m_discard(options.blockSize)
+            , m_outputs(options.numHardwareOutputChannels, m_discard.data())
+        { }
+
+        TestEnvironment(size_t numOutputs, std::initializer_list<Methcla_LibraryFunction> plugins)
+            : TestEnvironment(makeOptions(numOutputs, plugins))
+        { }
+
+        //* Send the packet built by `build`.
+        void sendPacket(std::function<void(OSCPP::Client::Packet&)> build)
+        {
+            OSCPP::Client::DynamicPacket packet(4096);
+            build(packet);
+            send(packet.data(), packet.size());
+        }
+
+        //* Send a message with int32 arguments.
+        void sendMessage(const char* address, std::initializer_list<int32_t> args)
+        {
+            sendPacket([&](OSCPP::Client::Packet& packet) {
+                packet.openMessage(address, args.size());
+                for (int32_t x : args) packet.int32(x);
+                packet.closeMessage();
+            });
+        }
+
+        //* Create a synth without audio rate control inputs.
+        void sendSynth(const char* synthDef, int32_t nodeId, int32_t targetId, std::initializer_list<float> controls)
+        {
+            sendPacket([&](OSCPP::Client::Packet& packet) {
+                packet
+                    .openMessage("/synth/new", 4 + OSCPP::Tags::array(controls.size()) + OSCPP::Tags::array(0))
+                        .string(synthDef)
+                        .int32(nodeId).int32(targetId).int32(kMethcla_NodePlacementTailOfGroup)
+                        .putArray(controls.begin(), controls.end())
+                        .openArray().closeArray()
+                    .closeMessage();
+            });
+        }
+
+        //* Process block number `block`, writing the first output channel to `output` if it isn't null and discarding all other output.
+        void processBlock(size_t block, Methcla::Audio::sample_t* output=nullptr)
+        {
+            if (!m_outputs.empty())
+                m_outputs[0] = output == nullptr ? m_discard.data() : output;
+            process(block * blockSize() / sampleRate(), blockSize(), nullptr, m_outputs.data());
+        }
+
+        //* Process `numBlocks` blocks starting at block number `block` into consecutive frames of `output`.
+        void render(size_t block, size_t numBlocks, std::vector<float>& output)
+        {
+            output.resize(std::max(output.size(), numBlocks * blockSize()));
+            for (size_t i=0; i < numBlocks; i++)
+                processBlock(block + i, output.data() + i * blockSize());
+        }
+
+    private:
+        std::vector<Methcla::Audio::sample_t>   m_discard;
+        std::vector<Methcla::Audio::sample_t*>  m_outputs;
+    };
+
+    static float maxAbs(const std::vector<float>& xs, size_t begin, size_t end)
+    {
+        float result = 0.f;
+        for (size_t i=begin; i < end; i++)
+            result = std::max(result, std::fabs(xs[i]));
+        return result;
+    }
+};
+
+namespace test_Methcla_Audio_ExecutionPlan
+{
+    using test_Methcla_Audio_Environment::TestEnvironment;
+    using test_Methcla_Audio_Environment::makeOptions;
+
+    static std::vector<float> renderParallelGroup(size_t numHelperThreads, size_t numSynths, size_t numBlocks)
+    {
+        Methcla::Audio::Environment::Options options = makeOptions(1, { methcla_plugins_sine });
+        options.numHelperThreads = numHelperThreads;
+        TestEnvironment env(options);
+
+        env.sendMessage("/pargroup/new", { 1, 0, kMethcla_NodePlacementTailOfGroup });
+
+        for (size_t i=0; i < numSynths; i++)
+        {
+            const int32_t nodeId = 2 + i;
+            env.sendSynth(METHCLA_PLUGINS_SINE_URI, nodeId, 1, { 100.f + 10.f * i, 1.f / numSynths });
+            env.sendMessage("/synth/map/output", { nodeId, 0, 0, kMethcla_BusMappingExternal });
+            env.sendMessage("/synth/activate", { nodeId });
+        }
+
+        std::vector<float> result;
+        env.render(0, numBlocks, result);
+        return result;
+    }
+};
+
+TEST(Methcla_Audio_ExecutionPlan, Parallel_group_output_should_not_depend_on_number_of_threads)
+{
+    using test_Methcla_Audio_ExecutionPlan::renderParallelGroup;
+
+    const size_t numSynths = 40;
+    const size_t numBlocks = 16;
+
+    const std::vector<float> serial = renderParallelGroup(0, numSynths, numBlocks);
+    const std::vector<float> parallel = renderParallelGroup(2, numSynths, numBlocks);
+
+    EXPECT_LT( Methcla::Tests::rmsError(serial, parallel), 1e-6 );
+    EXPECT_GT( *std::max_element(parallel.begin(), parallel.end()), 0.f );
+
+    for (size_t numThreads=1; numThreads <= 3; numThreads++)
+    {
+        EXPECT_TRUE( renderParallelGroup(numThreads, numSynths, numBlocks) == parallel );
+    }
+}
+
+namespace test_Methcla_Audio_ExecutionPlan
+{
+    // sine -> bus 0 -> parallel group with a child group that adds another sine to bus 0 and copies bus 0 to output 0, followed by two sines writing to output 0.
+    static std::vector<float> renderBusReadInParallelGroup(size_t numHelperThreads, size_t numBlocks)
+    {
+        Methcla::Audio::Environment::Options options = makeOptions(1, { methcla_plugins_sine, methcla_plugins_patch_cable });
+        options.numHelperThreads = numHelperThreads;
+        TestEnvironment env(options);
+
+        env.sendSynth(METHCLA_PLUGINS_SINE_URI, 1, 0, { 440.f, 0.5f });
+        env.sendMessage("/synth/map/output", { 1, 0, 0, kMethcla_BusMappingInternal });
+        env.sendMessage("/pargroup/new", { 2, 0, kMethcla_NodePlacementTailOfGroup });
+        env.sendMessage("/group/new", { 3, 2, kMethcla_NodePlacementTailOfGroup });
+        env.sendSynth(METHCLA_PLUGINS_SINE_URI, 4, 3, { 660.f, 0.25f });
+        env.sendMessage("/synth/map/output", { 4, 0, 0, kMethcla_BusMappingInternal });
+        env.sendSynth(METHCLA_PLUGINS_PATCH_CABLE_URI, 5, 3, { });
+        env.sendMessage("/synth/map/input", { 5, 0, 0, kMethcla_BusMappingInternal });
+        env.sendMessage("/synth/map/output", { 5, 0, 0, kMethcla_BusMappingExternal });
+        for (int32_t nodeId : { 6, 7 }) {
+            env.sendSynth(METHCLA_PLUGINS_SINE_URI, nodeId, 2, { 100.f * nodeId, 0.125f });
+            env.sendMessage("/synth/map/output", { nodeId, 0, 0, kMethcla_BusMappingExternal });
+        }
+        for (int32_t nodeId : { 1, 4, 5, 6, 7 })
+            env.sendMessage("/synth/activate", { nodeId });
+
+        std::vector<float> result;
+        env.render(0, numBlocks, result);
+        EXPECT_EQ( env.numErrors(), 0u );
+        return result;
+    }
+};
+
+TEST(Methcla_Audio_ExecutionPlan, Parallel_group_should_read_buses_written_before_and_within_a_task)
+{
+    using test_Methcla_Audio_ExecutionPlan::renderBusReadInParallelGroup;
+
+    const size_t numBlocks = 8;
+    const std::vector<float> serial = renderBusReadInParallelGroup(0, numBlocks);
+    EXPECT_GT( test_Methcla_Audio_Environment::maxAbs(serial, 0, serial.size()), 0.5f );
+
+    for (size_t numThreads=1; numThreads <= 3; numThreads++)
+    {
+        EXPECT_TRUE( renderBusReadInParallelGroup(numThreads, numBlocks) == serial );
+    }
+}
+
+namespace test_Methcla_Audio_ExecutionPlan
+{
+    static std::vector<float> renderSynthChains(size_t numHelperThreads, size_t numBlocks)
+    {
+        Methcla::Audio::Environment::Options options = makeOptions(1, { methcla_plugins_sine, methcla_plugins_patch_cable });
+        options.numHelperThreads = numHelperThreads;
+        TestEnvironment env(options);
+
+        auto sine = [&](int32_t nodeId, float freq, int32_t bus, int32_t flags) {
+            env.sendSynth(METHCLA_PLUGINS_SINE_URI, nodeId, 1, { freq, 0.125f });
+            env.sendMessage("/synth/map/output", { nodeId, 0, bus, flags });
+        };
+        auto patchCable = [&](int32_t nodeId, int32_t inputBus, int32_t outputBus, int32_t outputFlags) {
+            env.sendSynth(METHCLA_PLUGINS_PATCH_CABLE_URI, nodeId, 1, { });
+            env.sendMessage("/synth/map/input", { nodeId, 0, inputBus, kMethcla_BusMappingInternal });
+            env.sendMessage("/synth/map/output", { nodeId, 0, outputBus, outputFlags });
+        };
+
+        env.sendMessage("/group/new", { 1, 0, kMethcla_NodePlacementTailOfGroup });
+        // Two writers and a reader of bus 0
+        sine(10, 110.f, 0, kMethcla_BusMappingInternal);
+        sine(11, 220.f, 0, kMethcla_BusMappingInternal);
+        patchCable(12, 0, 0, kMethcla_BusMappingExternal);
+        // Independent of the other chains
+        sine(20, 330.f, 0, kMethcla_BusMappingExternal);
+        // Chain through buses 1 and 2
+        sine(30, 440.f, 1, kMethcla_BusMappingInternal);
+        patchCable(31, 1, 2, kMethcla_BusMappingInternal);
+        patchCable(32, 2, 0, kMethcla_BusMappingExternal);
+        // Replacing bus 0 after it has been read
+        sine(40, 550.f, 0, kMethcla_BusMappingInternal | kMethcla_BusMappingReplace);
+        patchCable(41, 0, 0, kMethcla_BusMappingExternal);
+
+        for (int32_t nodeId : { 10, 11, 12, 20, 30, 31, 32, 40, 41 })
+            env.sendMessage("/synth/activate", { nodeId });
+
+        std::vector<float> result;
+        env.render(0, numBlocks, result);
+        EXPECT_EQ( env.numErrors(), 0u );
+        return result;
+    }
+};
+
+TEST(Methcla_Audio_ExecutionPlan, Levels_of_a_group_should_render_like_serial_processing)
+{
+    using test_Methcla_Audio_ExecutionPlan::renderSynthChains;
+
+    const size_t numBlocks = 8;
+    const std::vector<float> serial = renderSynthChains(0, numBlocks);
+    EXPECT_GT( test_Methcla_Audio_Environment::maxAbs(serial, 0, serial.size()), 0.25f );
+    EXPECT_TRUE( renderSynthChains(2, numBlocks) == serial );
+}
+
+namespace test_Methcla_Audio_ExecutionPlan
+{
+    static void createDoneActionInParallelGroup(TestEnvironment& env)
+    {
+        env.sendMessage("/pargroup/new", { 1, 0, kMethcla_NodePlacementTailOfGroup });
+        // Frees its following sibling, which is processed in another task, in the middle of the third block
+        const float doneTime = 2.5f * env.blockSize() / env.sampleRate();
+        env.sendPacket([&](OSCPP::Client::Packet& packet) {
+            packet
+                .openMessage("/synth/new", 4 + OSCPP::Tags::array(0) + OSCPP::Tags::array(1))
+                    .string(METHCLA_PLUGINS_DONE_AFTER_URI)
+                    .int32(10).int32(1).int32(kMethcla_NodePlacementTailOfGroup)
+                    .openArray().closeArray()
+                    .openArray().float32(doneTime).closeArray()
+                .closeMessage();
+        });
+        env.sendMessage("/synth/property/doneFlags/set", { 10, kMethcla_NodeDoneFreeSelf | kMethcla_NodeDoneFreeFollowing });
+        for (int32_t nodeId : { 11, 12 }) {
+            env.sendSynth(METHCLA_PLUGINS_SINE_URI, nodeId, 1, { 100.f * nodeId, 0.25f });
+            env.sendMessage("/synth/map/output", { nodeId, 0, 0, kMethcla_BusMappingExternal });
+        }
+        for (int32_t nodeId : { 10, 11, 12 })
+            env.sendMessage("/synth/activate", { nodeId });
+    }
+
+    static std::vector<float> renderDoneActionInParallelGroup(size_t numHelperThreads, size_t numBlocks)
+    {
+        Methcla::Audio::Environment::Options options = makeOptions(1, { methcla_plugins_sine, methcla_plugins_node_control });
+        options.numHelperThreads = numHelperThreads;
+        TestEnvironment env(options);
+
+        createDoneActionInParallelGroup(env);
+
+        std::vector<float> result;
+        env.render(0, numBlocks, result);
+        EXPECT_EQ( env.numErrors(), 0u );
+        return result;
+    }
+};
+
+TEST(Methcla_Audio_ExecutionPlan, Parallel_group_child_should_free_its_following_sibling)
+{
+    using namespace test_Methcla_Audio_ExecutionPlan;
+
+    // The synth freeing its sibling is not processed concurrently with the other children
+    {
+        const Methcla::Audio::Environment::Options options = makeOptions(1, { methcla_plugins_sine, methcla_plugins_node_control });
+        TestEnvironment env(options);
+        createDoneActionInParallelGroup(env);
+        env.processBlock(0);
+        Methcla::Audio::ExecutionPlan plan(options.maxNumNodes, options.blockSize, true);
+        plan.update(env.rootNode());
+        EXPECT_EQ( plan.numSteps(), 3u );
+        EXPECT_GT( plan.numLevels(), 1u );
+    }
+
+    const size_t numBlocks = 8;
+    const std::vector<float> serial = renderDoneActionInParallelGroup(0, numBlocks);
+    EXPECT_GT( test_Methcla_Audio_Environment::maxAbs(serial, 0, serial.size()), 0.25f );
+
+    for (size_t numThreads=1; numThreads <= 3; numThreads++)
+    {
+        for (size_t i=0; i < 10; i++)
+            ASSERT_TRUE( renderDoneActionInParallelGroup(numThreads, numBlocks) == serial );
+    }
+}
+
+namespace test_Methcla_Audio_ExecutionPlan
+{
+    static std::vector<float> renderManyBusesInParallelGroup(size_t numHelperThreads, size_t numBlocks)
+    {
+        Methcla::Audio::Environment::Options options = makeOptions(1, { methcla_plugins_sine, methcla_plugins_patch_cable });
+        options.numHelperThreads = numHelperThreads;
+        TestEnvironment env(options);
+
+        // A task writing to more buses than it has partial sums for
+        env.sendMessage("/pargroup/new", { 1, 0, kMethcla_NodePlacementTailOfGroup });
+        env.sendMessage("/group/new", { 2, 1, kMethcla_NodePlacementTailOfGroup });
+        for (int32_t bus=0; bus < 6; bus++) {
+            const int32_t nodeId = 10 + bus;
+            env.sendSynth(METHCLA_PLUGINS_SINE_URI, nodeId, 2, { 100.f * (bus + 1), 0.125f });
+            env.sendMessage("/synth/map/output", { nodeId, 0, bus, kMethcla_BusMappingInternal });
+        }
+        for (int32_t bus=0; bus < 6; bus++) {
+            const int32_t nodeId = 20 + bus;
+            env.sendSynth(METHCLA_PLUGINS_PATCH_CABLE_URI, nodeId, 2, { });
+            env.sendMessage("/synth/map/input", { nodeId, 0, bus, kMethcla_BusMappingInternal });
+            env.sendMessage("/synth/map/output", { nodeId, 0, 0, kMethcla_BusMappingExternal });
+        }
+        env.sendSynth(METHCLA_PLUGINS_SINE_URI, 30, 1, { 1000.f, 0.25f });
+        env.sendMessage("/synth/map/output", { 30, 0, 0, kMethcla_BusMappingExternal });
+
+        // Tasks replacing the contents of a bus written by preceding tasks
+        env.sendMessage("/pargroup/new", { 3, 0, kMethcla_NodePlacementTailOfGroup });
+        for (int32_t nodeId : { 40, 41, 42 }) {
+            env.sendSynth(METHCLA_PLUGINS_SINE_URI, nodeId, 3, { 10.f * nodeId, 0.125f });
+            const int32_t flags = nodeId == 41 ? kMethcla_BusMappingExternal | kMethcla_BusMappingReplace
+                                               : kMethcla_BusMappingExternal;
+            env.sendMessage("/synth/map/output", { nodeId, 0, 0, flags });
+        }
+
+        for (int32_t nodeId : { 10, 11, 12, 13, 14, 15, 20, 21, 22, 23, 24, 25, 30, 40, 41, 42 })
+            env.sendMessage("/synth/activate", { nodeId });
+
+        std::vector<float> result;
+        env.render(0, numBlocks, result);
+        EXPECT_EQ( env.numErrors(), 0u );
+        return result;
+    }
+};
+
+TEST(Methcla_Audio_ExecutionPlan, Parallel_group_should_write_to_more_buses_than_partial_sums)
+{
+    using test_Methcla_Audio_ExecutionPlan::renderManyBusesInParallelGroup;
+
+    const size_t numBlocks = 8;
+    const std::vector<float> serial = renderManyBusesInParallelGroup(0, numBlocks);
+    EXPECT_GT( test_Methcla_Audio_Environment::maxAbs(serial, 0, serial.size()), 0.1f );
+
+    for (size_t numThreads=1; numThreads <= 3; numThreads++)
+    {
+        EXPECT_TRUE( renderManyBusesInParallelGroup(numThreads, numBlocks) == serial );
+    }
+}
+
+TEST(Methcla_Audio_NodeMap, Sparse_node_ids_should_be_mapped)
+{
+    test_Methcla_Audio_Environment::TestEnvironment env(0, { });
+
+    const int32_t nodeIds[] = { 5000000, 1 << 30, (1 << 30) + 1, std::numeric_limits<int32_t>::max() };
+
+    for (size_t k=0; k < 2; k++)
+    {
+        env.sendMessage("/group/new", { nodeIds[0], 0, kMethcla_NodePlacementTailOfGroup });
+        for (size_t i=1; i < 4; i++)
+        {
+            // Target must be found through the map
+            env.sendMessage("/group/new", { nodeIds[i], nodeIds[i-1], kMethcla_NodePlacementTailOfGroup });
+        }
+        env.processBlock(0);
+        EXPECT_EQ( env.numErrors(), k );
+
+        // Duplicate id
+        env.sendMessage("/group/new", { nodeIds[2], 0, kMethcla_NodePlacementTailOfGroup });
+        env.processBlock(0);
+        EXPECT_EQ( env.numErrors(), k + 1 );
+
+        // Freeing the outermost group frees all nodes and makes their ids available again.
+        env.sendMessage("/node/free", { nodeIds[0] });
+        env.processBlock(0);
+        EXPECT_EQ( env.numErrors(), k + 1 );
+    }
+
+    // Negative ids are out of range
+    env.sendMessage("/group/new", { -2, 0, kMethcla_NodePlacementTailOfGroup });
+    env.processBlock(0);
+    EXPECT_EQ( env.numErrors(), 3u );
+}
+
+#include <methcla/engine.hpp>
+
+TEST(Methcla_ResourceIdAllocator, Freed_ids_should_be_reused_after_delay)
+{
+    const size_t capacity = 16;
+    Methcla::NodeIdAllocator ids(1, capacity);
+
+    // A freed id isn't reused right away
+    const Methcla::NodeId first = ids.alloc();
+    ids.free(first);
+    EXPECT_NE( ids.alloc().id(), first.id() );
+    ids.free(Methcla::NodeId(2));
+
+    std::vector<int32_t> allocated;
+    for (size_t i=0; i < capacity; i++)
+    {
+        allocated.push_back(ids.alloc().id());
+    }
+    std::sort(allocated.begin(), allocated.end());
+    for (size_t i=0; i < capacity; i++)
+    {
+        EXPECT_EQ( allocated[i], (int32_t)i + 1 );
+    }
+    EXPECT_THROW( ids.alloc(), std::runtime_error );
+
+    // Double frees are ignored
+    ids.free(Methcla::NodeId(3));
+    ids.free(Methcla::NodeId(3));
+    ids.free(Methcla::NodeId(5));
+    EXPECT_EQ( ids.getStatistics().allocated(), capacity - 2 );
+
+    // Ids are reused in the order they were freed
+    EXPECT_EQ( ids.alloc().id(), 3 );
+    EXPECT_EQ( ids.alloc().id(), 5 );
+    EXPECT_THROW( ids.alloc(), std::runtime_error );
+}
+
+TEST(Methcla_Audio_Environment, Scheduled_commands_should_take_effect_on_their_frame)
+{
+    using test_Methcla_Audio_Environment::maxAbs;
+
+    test_Methcla_Audio_Environment::TestEnvironment env(1, { methcla_plugins_sine });
+
+    const double sampleRate = env.sampleRate();
+    const size_t blockSize = env.blockSize();
+
+    OSCPP::Client::DynamicPacket packet(4096);
+    packet
+        .openBundle(methcla_time_to_uint64(0))
+            .openMessage("/synth/new", 4 + OSCPP::Tags::array(2) + OSCPP::Tags::array(0))
+                .string(METHCLA_PLUGINS_SINE_URI)
+                .int32(1).int32(0).int32(kMethcla_NodePlacementTailOfGroup)
+                .openArray().float32(440.f).float32(1.f).closeArray()
+                .openArray().closeArray()
+            .closeMessage()
+            .openMessage("/synth/map/output", 4)
+                .int32(1).int32(0).int32(0).int32(kMethcla_BusMappingExternal)
+            .closeMessage()
+            .openMessage("/synth/activate", 1).int32(1).closeMessage()
+            // Within the first block
+            .openBundle(methcla_time_to_uint64(37 / sampleRate))
+                .openMessage("/node/set", 3).int32(1).int32(1).float32(0.f).closeMessage()
+            .closeBundle()
+            // Within the third block
+            .openBundle(methcla_time_to_uint64((2 * blockSize + 5) / sampleRate))
+                .openMessage("/node/set", 3).int32(1).int32(1).float32(1.f).closeMessage()
+            .closeBundle()
+            .openBundle(methcla_time_to_uint64((2 * blockSize + 50) / sampleRate))
+                .openMessage("/node/free", 1).int32(1).closeMessage()
+            .closeBundle()
+        .closeBundle();
+    env.send(packet.data(), packet.size());
+
+    std::vector<float> output;
+    env.render(0, 4, output);
+
+    EXPECT_GT( maxAbs(output, 0, 37), 0.f );
+    EXPECT_EQ( maxAbs(output, 37, 2 * blockSize + 5), 0.f );
+    EXPECT_GT( maxAbs(output, 2 * blockSize + 5, 2 * blockSize + 50), 0.f );
+    EXPECT_NE( output[2 * blockSize + 49], 0.f );
+    EXPECT_EQ( maxAbs(output, 2 * blockSize + 50, output.size()), 0.f );
+}
+
+TEST(Methcla_Audio_Environment, Binary_commands_should_take_effect_on_their_frame)
+{
+    using test_Methcla_Audio_Environment::maxAbs;
+
+    test_Methcla_Audio_Environment::TestEnvironment env(1, { methcla_plugins_sine });
+
+    const double sampleRate = env.sampleRate();
+    const size_t blockSize = env.blockSize();
+    const size_t numBlocks = 3;
+    std::vector<float> output(numBlocks * blockSize);
+
+    auto processBlock = [&](size_t i) {
+        env.processBlock(i, output.data() + i * blockSize);
+    };
+
+    auto command = [](Methcla_EngineCommandOpcode opcode, int32_t nodeId, int32_t index, float value, Methcla_Time time) {
+        Methcla_EngineCommand result;
+        result.opcode = opcode;
+        result.node_id = nodeId;
+        result.index = index;
+        result.value = value;
+        result.time = time;
+        return result;
+    };
+
+    env.sendSynth(METHCLA_PLUGINS_SINE_URI, 1, 0, { 440.f, 1.f });
+    env.sendMessage("/synth/map/output", { 1, 0, 0, kMethcla_BusMappingExternal });
+    env.sendMessage("/synth/activate", { 1 });
+
+    // Binary commands take effect at their frame
+    const Methcla_EngineCommand silence = command(kMethcla_EngineCommandNodeSet, 1, 1, 0.f, 37 / sampleRate);
+    env.sendCommands(&silence, 1);
+    processBlock(0);
+    EXPECT_GT( maxAbs(output, 0, 37), 0.5f );
+    EXPECT_EQ( maxAbs(output, 37, blockSize), 0.f );
+
+    // Immediate binary commands are executed after OSC requests sent before them
+    env.sendMessage("/synth/map/control/input", { 1, 1, 3 });
+    const Methcla_EngineCommand busSet = command(kMethcla_EngineCommandBusControlSet, 0, 3, 0.25f, 0.);
+    env.sendCommands(&busSet, 1);
+    processBlock(1);
+    EXPECT_GT( maxAbs(output, blockSize, 2 * blockSize), 0.f );
+    EXPECT_LE( maxAbs(output, blockSize, 2 * blockSize), 0.25f );
+    EXPECT_EQ( env.numErrors(), 0u );
+
+    // Invalid commands are rejected when sent, errors depending on the node tree are reported asynchronously
+    const Methcla_EngineCommand invalid[2] = {
+        command(kMethcla_EngineCommandNodeSet, 1, 1, 1.f, 0.),
+        command(kMethcla_EngineCommandBusControlSet, 0, -1, 0.f, 0.)
+    };
+    EXPECT_THROW( env.sendCommands(invalid, 2), Methcla::Error );
+    const Methcla_EngineCommand missingNode = command(kMethcla_EngineCommandNodeSet, 2, 1, 1.f, 0.);
+    env.sendCommands(&missingNode, 1);
+    // No command is sent if the ring buffer doesn't have room for all of them
+    const std::vector<Methcla_EngineCommand> tooMany(16385, command(kMethcla_EngineCommandNodeSet, 1, 1, 1.f, 0.));
+    EXPECT_ANY_THROW( env.sendCommands(tooMany.data(), tooMany.size()) );
+    processBlock(2);
+    EXPECT_LE( maxAbs(output, 2 * blockSize, 3 * blockSize), 0.25f );
+    EXPECT_EQ( env.numErrors(), 1u );
+}
+
+TEST(Methcla_Audio_Environment, Timed_binary_commands_should_not_delay_later_commands)
+{
+    using test_Methcla_Audio_Environment::maxAbs;
+
+    test_Methcla_Audio_Environment::TestEnvironment env(1, { methcla_plugins_sine });
+
+    const double sampleRate = env.sampleRate();
+    const size_t blockSize = env.blockSize();
+    const size_t numBlocks = 3;
+    std::vector<float> output(numBlocks * blockSize);
+
+    env.sendSynth(METHCLA_PLUGINS_SINE_URI, 1, 0, { 440.f, 1.f });
+    env.sendMessage("/synth/map/output", { 1, 0, 0, kMethcla_BusMappingExternal });
+    env.sendMessage("/synth/activate", { 1 });
+
+    Methcla_EngineCommand commands[2];
+    commands[0].opcode = kMethcla_EngineCommandNodeSet;
+    commands[0].node_id = 1;
+    commands[0].index = 1;
+    commands[0].value = 0.f;
+    commands[0].time = (2 * blockSize + 10) / sampleRate;
+    commands[1] = commands[0];
+    commands[1].value = 0.25f;
+    commands[1].time = 0.;
+    env.sendCommands(commands, 2);
+
+    for (size_t i=0; i < numBlocks; i++)
+        env.processBlock(i, output.data() + i * blockSize);
+
+    EXPECT_GT( maxAbs(output, 0, 2 * blockSize + 10), 0.f );
+    EXPECT_LE( maxAbs(output, 0, 2 * blockSize + 10), 0.25f );
+    EXPECT_EQ( maxAbs(output, 2 * blockSize + 10, output.size()), 0.f );
+    EXPECT_EQ( env.numErrors(), 0u );
+}
+
+TEST(Methcla_Audio_Environment, Invalid_requests_should_be_rejected_when_sent)
+{
+    test_Methcla_Audio_Environment::TestEnvironment env(1, { methcla_plugins_sine });
+
+    auto expectError = [&](const OSCPP::Client::Packet& packet, Methcla_ErrorCode code) {
+        try {
+            env.send(packet.data(), packet.size());
+            ADD_FAILURE() << "Request was not rejected";
+        } catch (Methcla::Error& e) {
+            EXPECT_EQ( e.errorCode(), code );
+        }
+    };
+
+    // No part of a bundle is executed if one of its messages is invalid
+    OSCPP::Client::DynamicPacket packet(4096);
+    packet
+        .openBundle(methcla_time_to_uint64(0))
+            .openMessage("/group/new", 3).int32(1).int32(0).int32(kMethcla_NodePlacementTailOfGroup).closeMessage()
+            .openMessage("/node/run", 2).int32(1).string("yes").closeMessage()
+        .closeBundle();
+    expectError(packet, kMethcla_ArgumentError);
+
+    packet.reset();
+    packet.openMessage("/node/run", 3).int32(1).int32(1).int32(1).closeMessage();
+    expectError(packet, kMethcla_ArgumentError);
+
+    packet.reset();
+    packet.openMessage("/bus/control/set", 1).int32(0).closeMessage();
+    expectError(packet, kMethcla_ArgumentError);
+
+    packet.reset();
+    packet
+        .openMessage("/synth/new", 4 + OSCPP::Tags::array(0) + OSCPP::Tags::array(0))
+            .string("nonexistent")
+            .int32(2).int32(0).int32(kMethcla_NodePlacementTailOfGroup)
+            .openArray().closeArray()
+            .openArray().closeArray()
+        .closeMessage();
+    expectError(packet, kMethcla_SynthDefNotFoundError);
+
+    packet.reset();
+    packet
+        .openMessage("/synth/new", 4 + OSCPP::Tags::array(1) + OSCPP::Tags::array(0))
+            .string(METHCLA_PLUGINS_SINE_URI)
+            .int32(2).int32(0).int32(kMethcla_NodePlacementTailOfGroup)
+            .openArray().string("440").closeArray()
+            .openArray().closeArray()
+        .closeMessage();
+    expectError(packet, kMethcla_ArgumentError);
+
+    const char garbage[] = "#bundle";
+    EXPECT_THROW( env.send(garbage, sizeof(garbage)), Methcla::Error );
+
+    // Unknown addresses are ignored
+    packet.reset();
+    packet.openMessage("/unknown", 1).int32(1).closeMessage();
+    env.send(packet.data(), packet.size());
+
+    env.processBlock(0);
+    EXPECT_EQ( env.numErrors(), 0u );
+
+    // The group was not created by the rejected bundle
+    env.sendMessage("/group/new", { 1, 0, kMethcla_NodePlacementTailOfGroup });
+    env.processBlock(1);
+    EXPECT_EQ( env.numErrors(), 0u );
+}
+
+namespace test_Methcla_Audio_Environment
+{
+    // Render a sine in buffers of bufferSize frames.
+    static std::vector<float> renderSine(size_t bufferSize, size_t numFrames)
+    {
+        TestEnvironment env(1, { methcla_plugins_sine });
+
+        OSCPP::Client::DynamicPacket packet(4096);
+        packet
+            .openBundle(methcla_time_to_uint64(0))
+                .openMessage("/synth/new", 4 + OSCPP::Tags::array(2) + OSCPP::Tags::array(0))
+                    .string(METHCLA_PLUGINS_SINE_URI)
+                    .int32(1).int32(0).int32(kMethcla_NodePlacementTailOfGroup)
+                    .openArray().float32(440.f).float32(1.f).closeArray()
+                    .openArray().closeArray()
+                .closeMessage()
+                .openMessage("/synth/map/output", 4)
+                    .int32(1).int32(0).int32(0).int32(kMethcla_BusMappingExternal)
+                .closeMessage()
+                .openMessage("/synth/activate", 1).int32(1).closeMessage()
+            .closeBundle();
+        env.send(packet.data(), packet.size());
+
+        std::vector<float> output(numFrames);
+
+        for (size_t frame=0; frame < numFrames; frame += bufferSize)
+        {
+            Methcla::Audio::sample_t* outputs[1] = { output.data() + frame };
+            env.process(frame / env.sampleRate(), std::min(bufferSize, numFrames - frame), nullptr, outputs);
+        }
+
+        return output;
+    }
+};
+
+TEST(Methcla_Audio_Environment, Output_should_not_depend_on_buffer_size)
+{
+    using test_Methcla_Audio_Environment::renderSine;
+
+    const size_t numFrames = 4000;
+    const std::vector<float> reference = renderSine(64, numFrames);
+
+    EXPECT_TRUE( renderSine(1000, numFrames) == reference );
+    EXPECT_TRUE( renderSine(17, numFrames) == reference );
+}
+
+TEST(Methcla_Audio_Environment, Silence_should_propagate_through_effects)
+{
+    using test_Methcla_Audio_Environment::maxAbs;
+    using Methcla::Audio::AudioBusId;
+
+    test_Methcla_Audio_Environment::TestEnvironment env(1, { methcla_plugins_sine, methcla_plugins_patch_cable });
+
+    const double sampleRate = env.sampleRate();
+    const size_t blockSize = env.blockSize();
+
+    // sine -> bus 0 -> amplifier -> bus 1 -> patch cable -> output 0
+    OSCPP::Client::DynamicPacket packet(4096);
+    packet
+        .openBundle(methcla_time_to_uint64(0))
+            .openMessage("/synth/new", 4 + OSCPP::Tags::array(2) + OSCPP::Tags::array(0))
+                .string(METHCLA_PLUGINS_SINE_URI)
+                .int32(1).int32(0).int32(kMethcla_NodePlacementTailOfGroup)
+                .openArray().float32(440.f).float32(1.f).closeArray()
+                .openArray().closeArray()
+            .closeMessage()
+            .openMessage("/synth/map/output", 4)
+                .int32(1).int32(0).int32(0).int32(kMethcla_BusMappingInternal)
+            .closeMessage()
+            .openMessage("/synth/new", 4 + OSCPP::Tags::array(1) + OSCPP::Tags::array(0))
+                .string(METHCLA_PLUGINS_AMPLIFIER_URI)
+                .int32(2).int32(0).int32(kMethcla_NodePlacementTailOfGroup)
+                .openArray().float32(0.5f).closeArray()
+                .openArray().closeArray()
+            .closeMessage()
+            .openMessage("/synth/map/input", 4)
+                .int32(2).int32(0).int32(0).int32(kMethcla_BusMappingInternal)
+            .closeMessage()
+            .openMessage("/synth/map/output", 4)
+                .int32(2).int32(0).int32(1).int32(kMethcla_BusMappingInternal)
+            .closeMessage()
+            .openMessage("/synth/new", 4 + OSCPP::Tags::array(0) + OSCPP::Tags::array(0))
+                .string(METHCLA_PLUGINS_PATCH_CABLE_URI)
+                .int32(3).int32(0).int32(kMethcla_NodePlacementTailOfGroup)
+                .openArray().closeArray()
+                .openArray().closeArray()
+            .closeMessage()
+            .openMessage("/synth/map/input", 4)
+                .int32(3).int32(0).int32(1).int32(kMethcla_BusMappingInternal)
+            .closeMessage()
+            .openMessage("/synth/map/output", 4)
+                .int32(3).int32(0).int32(0).int32(kMethcla_BusMappingExternal)
+            .closeMessage()
+            .openMessage("/synth/activate", 1).int32(1).closeMessage()
+            .openMessage("/synth/activate", 1).int32(2).closeMessage()
+            .openMessage("/synth/activate", 1).int32(3).closeMessage()
+            .openBundle(methcla_time_to_uint64((blockSize + 50) / sampleRate))
+                .openMessage("/node/free", 1).int32(1).closeMessage()
+            .closeBundle()
+        .closeBundle();
+    env.send(packet.data(), packet.size());
+
+    std::vector<float> output(4 * blockSize, 1.f);
+    env.render(0, 4, output);
+
+    EXPECT_GT( maxAbs(output, 0, blockSize + 50), 0.f );
+    EXPECT_LE( maxAbs(output, 0, blockSize + 50), 0.5f );
+    EXPECT_EQ( maxAbs(output, blockSize + 50, output.size()), 0.f );
+
+    // The effects have propagated silence instead of processing
+    EXPECT_TRUE( env.audioBus(AudioBusId(1))->isSilent() );
+    EXPECT_TRUE( env.externalAudioOutput(AudioBusId(0))->isSilent() );
+}
+
+TEST(Methcla_Audio_Environment, Ports_bound_to_bus_memory_should_not_change_output)
+{
+    using test_Methcla_Audio_Environment::renderSine;
+
+    test_Methcla_Audio_Environment::TestEnvironment env(1, { methcla_plugins_sine, methcla_plugins_patch_cable });
+
+    // sine -> bus 0 -> amplifier (in place on bus 0) -> patch cable -> bus 1 -> patch cable -> output 0
+    OSCPP::Client::DynamicPacket packet(4096);
+    packet
+        .openBundle(methcla_time_to_uint64(0))
+            .openMessage("/synth/new", 4 + OSCPP::Tags::array(2) + OSCPP::Tags::array(0))
+                .string(METHCLA_PLUGINS_SINE_URI)
+                .int32(1).int32(0).int32(kMethcla_NodePlacementTailOfGroup)
+                .openArray().float32(440.f).float32(1.f).closeArray()
+                .openArray().closeArray()
+            .closeMessage()
+            .openMessage("/synth/map/output", 4)
+                .int32(1).int32(0).int32(0).int32(kMethcla_BusMappingInternal)
+            .closeMessage()
+            .openMessage("/synth/new", 4 + OSCPP::Tags::array(1) + OSCPP::Tags::array(0))
+                .string(METHCLA_PLUGINS_AMPLIFIER_URI)
+                .int32(2).int32(0).int32(kMethcla_NodePlacementTailOfGroup)
+                .openArray().float32(0.5f).closeArray()
+                .openArray().closeArray()
+            .closeMessage()
+            .openMessage("/synth/map/input", 4)
+                .int32(2).int32(0).int32(0).int32(kMethcla_BusMappingInternal)
+            .closeMessage()
+            .openMessage("/synth/map/output", 4)
+                .int32(2).int32(0).int32(0).int32(kMethcla_BusMappingReplace)
+            .closeMessage()
+            .openMessage("/synth/new", 4 + OSCPP::Tags::array(0) + OSCPP::Tags::array(0))
+                .string(METHCLA_PLUGINS_PATCH_CABLE_URI)
+                .int32(3).int32(0).int32(kMethcla_NodePlacementTailOfGroup)
+                .openArray().closeArray()
+                .openArray().closeArray()
+            .closeMessage()
+            .openMessage("/synth/map/input", 4)
+                .int32(3).int32(0).int32(0).int32(kMethcla_BusMappingInternal)
+            .closeMessage()
+            .openMessage("/synth/map/output", 4)
+                .int32(3).int32(0).int32(1).int32(kMethcla_BusMappingReplace)
+            .closeMessage()
+            .openMessage("/synth/new", 4 + OSCPP::Tags::array(0) + OSCPP::Tags::array(0))
+                .string(METHCLA_PLUGINS_PATCH_CABLE_URI)
+                .int32(4).int32(0).int32(kMethcla_NodePlacementTailOfGroup)
+                .openArray().closeArray()
+                .openArray().closeArray()
+            .closeMessage()
+            .openMessage("/synth/map/input", 4)
+                .int32(4).int32(0).int32(1).int32(kMethcla_BusMappingInternal)
+            .closeMessage()
+            .openMessage("/synth/map/output", 4)
+                .int32(4).int32(0).int32(0).int32(kMethcla_BusMappingExternal)
+            .closeMessage()
+            .openMessage("/synth/activate", 1).int32(1).closeMessage()
+            .openMessage("/synth/activate", 1).int32(2).closeMessage()
+            .openMessage("/synth/activate", 1).int32(3).closeMessage()
+            .openMessage("/synth/activate", 1).int32(4).closeMessage()
+        .closeBundle();
+    env.send(packet.data(), packet.size());
+
+    const size_t blockSize = env.blockSize();
+    const size_t numFrames = 8 * blockSize;
+    std::vector<float> output;
+    env.render(0, 8, output);
+
+    const std::vector<float> reference = renderSine(blockSize, numFrames);
+    for (size_t i=0; i < numFrames; i++)
+    {
+        ASSERT_FLOAT_EQ( output[i], 0.5f * reference[i] );
+    }
+}
+
+namespace test_Methcla_Audio_Environment
+{
+    // Render two sines mixed through an amplifier with numSynthScratchBuffers and return the realtime memory in use.
+    static size_t renderMix(size_t numSynthScratchBuffers, size_t numFrames, std::vector<float>& output)
+    {
+        Methcla::Audio::Environment::Options options = makeOptions(1, { methcla_plugins_sine, methcla_plugins_patch_cable });
+        options.numSynthScratchBuffers = numSynthScratchBuffers;
+        TestEnvironment env(options);
+
+        OSCPP::Client::DynamicPacket packet(4096);
+        packet
+            .openBundle(methcla_time_to_uint64(0))
+                .openMessage("/synth/new", 4 + OSCPP::Tags::array(2) + OSCPP::Tags::array(0))
+                    .string(METHCLA_PLUGINS_SINE_URI)
+                    .int32(1).int32(0).int32(kMethcla_NodePlacementTailOfGroup)
+                    .openArray().float32(440.f).float32(0.5f).closeArray()
+                    .openArray().closeArray()
+                .closeMessage()
+                .openMessage("/synth/map/output", 4)
+                    .int32(1).int32(0).int32(0).int32(kMethcla_BusMappingInternal)
+                .closeMessage()
+                .openMessage("/synth/new", 4 + OSCPP::Tags::array(2) + OSCPP::Tags::array(0))
+                    .string(METHCLA_PLUGINS_SINE_URI)
+                    .int32(2).int32(0).int32(kMethcla_NodePlacementTailOfGroup)
+                    .openArray().float32(660.f).float32(0.5f).closeArray()
+                    .openArray().closeArray()
+                .closeMessage()
+                .openMessage("/synth/map/output", 4)
+                    .int32(2).int32(0).int32(0).int32(kMethcla_BusMappingInternal)
+                .closeMessage()
+                .openMessage("/synth/new", 4 + OSCPP::Tags::array(1) + OSCPP::Tags::array(0))
+                    .string(METHCLA_PLUGINS_AMPLIFIER_URI)
+                    .int32(3).int32(0).int32(kMethcla_NodePlacementTailOfGroup)
+                    .openArray().float32(0.5f).closeArray()
+                    .openArray().closeArray()
+                .closeMessage()
+                .openMessage("/synth/map/input", 4)
+                    .int32(3).int32(0).int32(0).int32(kMethcla_BusMappingInternal)
+                .closeMessage()
+                .openMessage("/synth/map/output", 4)
+                    .int32(3).int32(0).int32(0).int32(kMethcla_BusMappingExternal)
+                .closeMessage()
+                // Unmapped input
+                .openMessage("/synth/new", 4 + OSCPP::Tags::array(1) + OSCPP::Tags::array(0))
+                    .string(METHCLA_PLUGINS_AMPLIFIER_URI)
+                    .int32(4).int32(0).int32(kMethcla_NodePlacementTailOfGroup)
+                    .openArray().float32(1.f).closeArray()
+                    .openArray().closeArray()
+                .closeMessage()
+                .openMessage("/synth/map/output", 4)
+                    .int32(4).int32(0).int32(0).int32(kMethcla_BusMappingExternal)
+                .closeMessage()
+                .openMessage("/synth/activate", 1).int32(1).closeMessage()
+                .openMessage("/synth/activate", 1).int32(2).closeMessage()
+                .openMessage("/synth/activate", 1).int32(3).closeMessage()
+                .openMessage("/synth/activate", 1).int32(4).closeMessage()
+            .closeBundle();
+        env.send(packet.data(), packet.size());
+
+        output.clear();
+        env.render(0, numFrames / env.blockSize(), output);
+
+        return env.rtMem().statistics().usedNumBytes;
+    }
+};
+
+TEST(Methcla_Audio_Environment, Synth_scratch_buffers_should_not_change_output)
+{
+    using test_Methcla_Audio_Environment::renderMix;
+
+    const size_t blockSize = Methcla::Audio::Environment::Options().blockSize;
+    const size_t numFrames = 8 * blockSize;
+
+    std::vector<float> reference;
+    const size_t ownBuffersNumBytes = renderMix(0, numFrames, reference);
+    std::vector<float> output;
+    const size_t scratchBuffersNumBytes = renderMix(16, numFrames, output);
+
+    EXPECT_GT( test_Methcla_Audio_Environment::maxAbs(reference, 0, numFrames), 0.f );
+    EXPECT_TRUE( output == reference );
+    // Two sines with one output and two amplifiers with one input and one output each
+    EXPECT_GE( ownBuffersNumBytes - scratchBuffersNumBytes, 6 * blockSize * sizeof(float) );
+}
+
+TEST(Methcla_Audio_Environment, Synth_should_be_done_after_tail_of_silent_input)
+{
+    test_Methcla_Audio_Environment::TestEnvironment env(1, { methcla_plugins_sine, methcla_plugins_test_support });
+
+    const double sampleRate = env.sampleRate();
+    const size_t blockSize = env.blockSize();
+    const size_t tailBlocks = 4;
+
+    // sine -> bus 0 -> tail -> output 0
+    OSCPP::Client::DynamicPacket packet(4096);
+    packet
+        .openBundle(methcla_time_to_uint64(0))
+            .openMessage("/synth/new", 4 + OSCPP::Tags::array(2) + OSCPP::Tags::array(0))
+                .string(METHCLA_PLUGINS_SINE_URI)
+                .int32(1).int32(0).int32(kMethcla_NodePlacementTailOfGroup)
+                .openArray().float32(440.f).float32(1.f).closeArray()
+                .openArray().closeArray()
+            .closeMessage()
+            .openMessage("/synth/map/output", 4)
+                .int32(1).int32(0).int32(0).int32(kMethcla_BusMappingInternal)
+            .closeMessage()
+            .openMessage("/synth/new", 4 + OSCPP::Tags::array(1) + OSCPP::Tags::array(0))
+                .string(METHCLA_PLUGINS_TEST_TAIL_URI)
+                .int32(2).int32(0).int32(kMethcla_NodePlacementTailOfGroup)
+                .openArray().float32(tailBlocks * blockSize / sampleRate).closeArray()
+                .openArray().closeArray()
+            .closeMessage()
+            .openMessage("/synth/map/input", 4)
+                .int32(2).int32(0).int32(0).int32(kMethcla_BusMappingInternal)
+            .closeMessage()
+            .openMessage("/synth/map/output", 4)
+                .int32(2).int32(0).int32(0).int32(kMethcla_BusMappingExternal)
+            .closeMessage()
+            .openMessage("/synth/property/doneFlags/set", 2)
+                .int32(2).int32(kMethcla_NodeDoneFreeSelf)
+            .closeMessage()
+            .openMessage("/synth/activate", 1).int32(1).closeMessage()
+            .openMessage("/synth/activate", 1).int32(2).closeMessage()
+            .openBundle(methcla_time_to_uint64(10 / sampleRate))
+                .openMessage("/node/free", 1).int32(1).closeMessage()
+            .closeBundle()
+        .closeBundle();
+    env.send(packet.data(), packet.size());
+
+    std::vector<float> output(blockSize);
+    size_t block = 0;
+
+    // Set control of node 2, failing if the node has been freed.
+    auto processBlock = [&]() {
+        env.sendPacket([&](OSCPP::Client::Packet& msg) {
+            msg.openMessage("/node/set", 3).int32(2).int32(0).float32(tailBlocks * blockSize / sampleRate).closeMessage();
+        });
+        env.processBlock(block++, output.data());
+    };
+
+    // The input becomes silent in the second block
+    for (size_t i=0; i < tailBlocks + 1; i++) processBlock();
+    EXPECT_EQ( env.numErrors(), 0u );
+
+    // The synth has been freed after its tail
+    for (size_t i=0; i < 2; i++) processBlock();
+    EXPECT_GT( env.numErrors(), 0u );
+}
+
+TEST(Methcla_Audio_Environment, Paused_nodes_should_resume_where_they_left_off)
+{
+    using test_Methcla_Audio_Environment::renderSine;
+
+    test_Methcla_Audio_Environment::TestEnvironment env(1, { methcla_plugins_sine });
+
+    const size_t blockSize = env.blockSize();
+
+    OSCPP::Client::DynamicPacket packet(4096);
+    packet
+        .openBundle(methcla_time_to_uint64(0))
+            .openMessage("/group/new", 3)
+                .int32(1).int32(0).int32(kMethcla_NodePlacementTailOfGroup)
+            .closeMessage()
+            .openMessage("/synth/new", 4 + OSCPP::Tags::array(2) + OSCPP::Tags::array(0))
+                .string(METHCLA_PLUGINS_SINE_URI)
+                .int32(2).int32(1).int32(kMethcla_NodePlacementTailOfGroup)
+                .openArray().float32(440.f).float32(1.f).closeArray()
+                .openArray().closeArray()
+            .closeMessage()
+            .openMessage("/synth/map/output", 4)
+                .int32(2).int32(0).int32(0).int32(kMethcla_BusMappingExternal)
+            .closeMessage()
+            .openMessage("/synth/activate", 1).int32(2).closeMessage()
+        .closeBundle();
+    env.send(packet.data(), packet.size());
+
+    std::vector<float> output(blockSize);
+    auto processBlock = [&]() {
+        env.processBlock(0, output.data());
+        return output;
+    };
+
+    const std::vector<float> reference = renderSine(blockSize, 3 * blockSize);
+    auto referenceBlock = [&](size_t i) {
+        return std::vector<float>(reference.begin() + i * blockSize, reference.begin() + (i + 1) * blockSize);
+    };
+    const std::vector<float> silence(blockSize, 0.f);
+
+    EXPECT_TRUE( processBlock() == referenceBlock(0) );
+
+    // Pause the synth's group
+    env.sendMessage("/node/run", { 1, 0 });
+    EXPECT_TRUE( processBlock() == silence );
+    EXPECT_TRUE( processBlock() == silence );
+
+    env.sendMessage("/node/run", { 1, 1 });
+    EXPECT_TRUE( processBlock() == referenceBlock(1) );
+
+    // Pause the synth itself
+    env.sendMessage("/node/run", { 2, 0 });
+    EXPECT_TRUE( processBlock() == silence );
+
+    env.sendMessage("/node/run", { 2, 1 });
+    EXPECT_TRUE( processBlock() == referenceBlock(2) );
+}
+
+TEST(Methcla_Audio_Environment, Synth_batch_should_share_one_allocation)
+{
+    using test_Methcla_Audio_Environment::renderSine;
+
+    test_Methcla_Audio_Environment::TestEnvironment env(1, { methcla_plugins_sine });
+
+    const size_t blockSize = env.blockSize();
+    std::vector<float> output(blockSize);
+
+    auto processBlocks = [&](size_t numBlocks) {
+        for (size_t i=0; i < numBlocks; i++)
+            env.processBlock(0, output.data());
+    };
+
+    auto sendBatch = [&](std::initializer_list<int32_t> nodeIds, std::initializer_list<float> controls) {
+        env.sendPacket([&](OSCPP::Client::Packet& packet) {
+            packet
+                .openMessage("/synth/new/batch", 3 + OSCPP::Tags::array(nodeIds.size()) + OSCPP::Tags::array(controls.size()) + OSCPP::Tags::array(0))
+                    .string(METHCLA_PLUGINS_SINE_URI)
+                    .int32(0).int32(kMethcla_NodePlacementTailOfGroup)
+                    .putArray(nodeIds.begin(), nodeIds.end())
+                    .putArray(controls.begin(), controls.end())
+                    .openArray().closeArray()
+                .closeMessage();
+        });
+    };
+
+    processBlocks(2);
+    const size_t usedNumBytes = env.rtMem().statistics().usedNumBytes;
+
+    sendBatch({ 10, 11, 12 }, { 440.f, 0.125f, 440.f, 0.25f, 440.f, 0.5f });
+    for (int32_t nodeId : { 10, 11, 12 }) {
+        env.sendMessage("/synth/map/output", { nodeId, 0, 0, kMethcla_BusMappingExternal });
+        env.sendMessage("/synth/activate", { nodeId });
+    }
+    processBlocks(1);
+    EXPECT_EQ( env.numErrors(), 0u );
+
+    const std::vector<float> reference = renderSine(blockSize, blockSize);
+    for (size_t i=0; i < blockSize; i++) {
+        EXPECT_NEAR( output[i], 0.875f * reference[i], 1e-5f );
+    }
+
+    // Synths of a batch can be freed individually
+    env.sendMessage("/node/free", { 11 });
+    processBlocks(1);
+    EXPECT_EQ( env.numErrors(), 0u );
+    EXPECT_GT( env.rtMem().statistics().usedNumBytes, usedNumBytes );
+
+    // The batch memory is released with the last synth
+    env.sendMessage("/node/free", { 10 });
+    env.sendMessage("/node/free", { 12 });
+    processBlocks(2);
+    EXPECT_EQ( env.numErrors(), 0u );
+    EXPECT_EQ( env.rtMem().statistics().usedNumBytes, usedNumBytes );
+
+    // Failing batches don't create any synths
+    sendBatch({ 20, 21, 20 }, { 440.f, 1.f, 440.f, 1.f, 440.f, 1.f });
+    processBlocks(2);
+    EXPECT_EQ( env.numErrors(), 1u );
+    EXPECT_EQ( env.rtMem().statistics().usedNumBytes, usedNumBytes );
+    sendBatch({ 20, 21 }, { 440.f, 1.f, 440.f, 1.f });
+    processBlocks(2);
+    EXPECT_EQ( env.numErrors(), 1u );
+}
+
+TEST(Methcla_Audio_Environment, Control_buses_should_fan_out_control_values)
+{
+    using test_Methcla_Audio_Environment::renderSine;
+
+    test_Methcla_Audio_Environment::TestEnvironment env(1, { methcla_plugins_sine, methcla_plugins_test_support });
+
+    const size_t blockSize = env.blockSize();
+    const size_t numBlocks = 5;
+    const std::vector<float> reference = renderSine(blockSize, numBlocks * blockSize);
+    std::vector<float> output(blockSize);
+
+    auto processBlock = [&](size_t block, float amp) {
+        env.processBlock(block, output.data());
+        for (size_t i=0; i < blockSize; i++) {
+            EXPECT_NEAR( output[i], amp * reference[block * blockSize + i], 1e-5f );
+        }
+    };
+
+    auto sendSet = [&](int32_t nodeId, int32_t index, float value) {
+        env.sendPacket([&](OSCPP::Client::Packet& packet) {
+            packet.openMessage("/node/set", 3).int32(nodeId).int32(index).float32(value).closeMessage();
+        });
+    };
+
+    // control -> control bus 3 -> amplitude of two sines
+    env.sendSynth(METHCLA_PLUGINS_TEST_CONTROL_URI, 1, 0, { 0.25f });
+    env.sendMessage("/synth/map/control/output", { 1, 0, 3 });
+    env.sendMessage("/synth/activate", { 1 });
+    for (int32_t nodeId : { 10, 11 }) {
+        env.sendSynth(METHCLA_PLUGINS_SINE_URI, nodeId, 0, { 440.f, 1.f });
+        env.sendMessage("/synth/map/control/input", { nodeId, 1, 3 });
+        env.sendMessage("/synth/map/output", { nodeId, 0, 0, kMethcla_BusMappingExternal });
+        env.sendMessage("/synth/activate", { nodeId });
+    }
+    processBlock(0, 2 * 0.25f);
+
+    // Changing the bus source changes all mapped inputs
+    sendSet(1, 0, 0.5f);
+    processBlock(1, 2 * 0.5f);
+
+    // Setting a mapped input unmaps it
+    sendSet(11, 1, 0.125f);
+    processBlock(2, 0.5f + 0.125f);
+
+    // Unmapped inputs keep the last bus value
+    env.sendMessage("/synth/map/control/input", { 10, 1, -1 });
+    sendSet(1, 0, 1.f);
+    processBlock(3, 0.5f + 0.125f);
+    EXPECT_EQ( env.numErrors(), 0u );
+
+    // Bus ids are checked when sending, port indices when processing
+    EXPECT_THROW( env.sendMessage("/synth/map/control/input", { 10, 1, (int32_t)env.numControlBuses() }), Methcla::Error );
+    env.sendMessage("/synth/map/control/output", { 1, 1, 0 });
+    processBlock(4, 0.5f + 0.125f);
+    EXPECT_EQ( env.numErrors(), 1u );
+}
+
+TEST(Methcla_Audio_Environment, Control_inputs_should_follow_audio_buses)
+{
+    using test_Methcla_Audio_Environment::renderSine;
+
+    test_Methcla_Audio_Environment::TestEnvironment env(2, { methcla_plugins_sine });
+
+    const double sampleRate = env.sampleRate();
+    const size_t blockSize = env.blockSize();
+    const size_t numBlocks = 4;
+    const float modAmp = 100.f;
+    const std::vector<float> reference = renderSine(blockSize, numBlocks * blockSize);
+
+    auto sendSynth = [&](int32_t nodeId, float freq, float amp) {
+        env.sendSynth(METHCLA_PLUGINS_SINE_URI, nodeId, 0, { freq, amp });
+    };
+
+    // Modulator on bus 0
+    sendSynth(1, 440.f, modAmp);
+    env.sendMessage("/synth/map/output", { 1, 0, 0, kMethcla_BusMappingInternal });
+    env.sendMessage("/synth/activate", { 1 });
+    // Amplitude (control rate) follows the first frame of each block
+    sendSynth(2, 440.f, 0.f);
+    env.sendMessage("/synth/map/control/input/audio", { 2, 1, 0, kMethcla_BusMappingInternal });
+    env.sendMessage("/synth/map/output", { 2, 0, 0, kMethcla_BusMappingExternal });
+    env.sendMessage("/synth/activate", { 2 });
+    // Frequency (audio rate) follows every frame
+    const float carrierFreq = 1000.f;
+    sendSynth(3, carrierFreq, 1.f);
+    env.sendMessage("/synth/map/control/input/audio", { 3, 0, 0, kMethcla_BusMappingInternal });
+    env.sendMessage("/synth/map/output", { 3, 0, 1, kMethcla_BusMappingExternal });
+    env.sendMessage("/synth/activate", { 3 });
+
+    std::vector<float> output0(blockSize);
+    std::vector<float> output1(blockSize);
+    double phase = 0.;
+    for (size_t block=0; block < numBlocks; block++) {
+        Methcla::Audio::sample_t* outputs[2] = { output0.data(), output1.data() };
+        env.process(0, blockSize, nullptr, outputs);
+        const float* ref = reference.data() + block * blockSize;
+        for (size_t i=0; i < blockSize; i++) {
+            EXPECT_NEAR( output0[i], modAmp * ref[0] * ref[i], 1e-3f );
+            EXPECT_NEAR( output1[i], std::sin(phase), 1e-3f );
+            phase += modAmp * ref[i] * 2. * M_PI / sampleRate;
+        }
+    }
+    EXPECT_EQ( env.numErrors(), 0u );
+
+    // Unmapping succeeds, out of range indices and bus ids are rejected
+    env.sendMessage("/synth/map/control/input/audio", { 2, 1, -1, kMethcla_BusMappingInternal });
+    env.sendMessage("/synth/map/control/input/audio", { 2, 2, 0, kMethcla_BusMappingInternal });
+    EXPECT_THROW( env.sendMessage("/synth/map/control/input/audio", { 2, 0, (int32_t)env.numAudioBuses(), kMethcla_BusMappingInternal }), Methcla::Error );
+    Methcla::Audio::sample_t* outputs[2] = { output0.data(), output1.data() };
+    env.process(0, blockSize, nullptr, outputs);
+    EXPECT_EQ( env.numErrors(), 1u );
+}
+
+TEST(Methcla_Audio_Environment, Bus_bundles_should_route_like_single_channels)
+{
+    const int32_t numChannels = METHCLA_TEST_CHANNELS_NUM_CHANNELS;
+
+    // Block sizes with and without padding between bus channels
+    for (size_t blockSize : { 64, 20 })
+    {
+        for (bool bundled : { true, false })
+        {
+            Methcla::Audio::Environment::Options options = test_Methcla_Audio_Environment::makeOptions(0, { methcla_plugins_test_support });
+            options.blockSize = blockSize;
+            test_Methcla_Audio_Environment::TestEnvironment env(options);
+
+            auto sendSynth = [&](int32_t nodeId) {
+                env.sendSynth(METHCLA_PLUGINS_TEST_CHANNELS_URI, nodeId, 0, { });
+            };
+
+            auto map = [&](const char* address, int32_t nodeId, int32_t index, int32_t busId, int32_t count, int32_t flags) {
+                if (bundled) {
+                    env.sendMessage(address, { nodeId, index, busId, count, flags });
+                } else {
+                    const std::string singleAddress = std::string(address, std::strlen(address) - 1);
+                    for (int32_t c=0; c < count; c++)
+                        env.sendMessage(singleAddress.c_str(), { nodeId, index + c, busId + c, flags });
+                }
+            };
+
+            // Buses 0..3 are written by two synths and read by a third one writing to buses 4..7.
+            sendSynth(1);
+            map("/synth/map/outputs", 1, 0, 0, numChannels, kMethcla_BusMappingInternal);
+            sendSynth(2);
+            map("/synth/map/outputs", 2, 0, 0, numChannels, kMethcla_BusMappingInternal);
+            sendSynth(3);
+            map("/synth/map/inputs", 3, 1, 1, numChannels - 1, kMethcla_BusMappingInternal);
+            map("/synth/map/inputs", 3, 0, 0, 1, kMethcla_BusMappingInternal);
+            map("/synth/map/outputs", 3, 0, numChannels, numChannels, kMethcla_BusMappingInternal);
+            // Reads buses 4..7 regardless of when they were written, replaces buses 8..11
+            sendSynth(4);
+            map("/synth/map/inputs", 4, 0, numChannels, numChannels, kMethcla_BusMappingFeedback);
+            map("/synth/map/outputs", 4, 0, 2 * numChannels, numChannels, kMethcla_BusMappingReplace);
+            for (int32_t nodeId=1; nodeId <= 4; nodeId++)
+                env.sendMessage("/synth/activate", { nodeId });
+
+            for (size_t block=0; block < 3; block++)
+            {
+                env.processBlock(block);
+
+                for (int32_t c=0; c < numChannels; c++)
+                {
+                    const float* mix = env.audioBus(Methcla::Audio::AudioBusId(c))->data();
+                    const float* effect = env.audioBus(Methcla::Audio::AudioBusId(numChannels + c))->data();
+                    const float* feedback = env.audioBus(Methcla::Audio::AudioBusId(2 * numChannels + c))->data();
+                    for (size_t i=0; i < blockSize; i++)
+                    {
+                        ASSERT_EQ( mix[i], 2.f * (c + 1) );
+                        ASSERT_EQ( effect[i], 3.f * (c + 1) );
+                        ASSERT_EQ( feedback[i], 4.f * (c + 1) );
+                    }
+                }
+            }
+
+            // Ranges exceeding the ports or buses are rejected
+            env.sendMessage("/synth/map/inputs", { 3, 1, 0, numChannels, kMethcla_BusMappingInternal });
+            EXPECT_THROW( env.sendMessage("/synth/map/outputs", { 3, 0, (int32_t)env.numAudioBuses() - 1, 2, kMethcla_BusMappingInternal }), Methcla::Error );
+            env.processBlock(3);
+            EXPECT_EQ( env.numErrors(), 1u );
+        }
+    }
+}
+
+TEST(Methcla_Audio_Environment, Buses_should_be_prepared_before_they_are_mapped)
+{
+    using test_Methcla_Audio_Environment::maxAbs;
+
+    test_Methcla_Audio_Environment::TestEnvironment env(1, { methcla_plugins_sine, methcla_plugins_patch_cable });
+
+    // Buses far beyond the ones prepared initially are prepared by the sending thread
+    const int32_t busId = (int32_t)env.numAudioBuses() - 1;
+    env.sendSynth(METHCLA_PLUGINS_SINE_URI, 1, 0, { 440.f, 0.5f });
+    env.sendMessage("/synth/map/output", { 1, 0, busId, kMethcla_BusMappingInternal });
+    env.sendSynth(METHCLA_PLUGINS_PATCH_CABLE_URI, 2, 0, { });
+    env.sendMessage("/synth/map/input", { 2, 0, busId, kMethcla_BusMappingInternal });
+    env.sendMessage("/synth/map/output", { 2, 0, 0, kMethcla_BusMappingExternal });
+    env.sendMessage("/synth/activate", { 1 });
+    env.sendMessage("/synth/activate", { 2 });
+
+    std::vector<float> output;
+    env.render(0, 2, output);
+    EXPECT_GT( maxAbs(output, 0, output.size()), 0.25f );
+    EXPECT_EQ( env.numErrors(), 0u );
+}
+
+TEST(Methcla_Audio_Environment, Freed_nodes_should_be_destroyed_over_several_blocks)
+{
+    const size_t numSynths = 200;
+    const size_t maxNumDestroys = 16;
+
+    Methcla::Audio::Environment::Options options = test_Methcla_Audio_Environment::makeOptions(1, { methcla_plugins_sine });
+    options.maxNumNodeDestroysPerBlock = maxNumDestroys;
+
+    std::atomic<size_t> numEnded(0);
+
+    test_Methcla_Audio_Environment::TestEnvironment env(
+        options,
+        [&numEnded](Methcla_RequestId requestId, const void* packet, size_t size) {
+            static const char* address = "/node/ended";
+            if (requestId == kMethcla_Notification && size > strlen(address)
+                && memcmp(packet, address, strlen(address) + 1) == 0)
+                numEnded++;
+        }
+    );
+
+    std::vector<float> output(env.blockSize());
+
+    auto processBlocks = [&](size_t numBlocks) {
+        for (size_t i=0; i < numBlocks; i++)
+            env.processBlock(0, output.data());
+    };
+
+    auto sendSynth = [&](int32_t nodeId, int32_t groupId) {
+        env.sendSynth(METHCLA_PLUGINS_SINE_URI, nodeId, groupId, { 440.f, 0.f });
+    };
+
+    // Process blocks until a condition holds; notifications are sent and freed asynchronously by the worker threads.
+    auto processUntil = [&](std::function<bool()> cond) {
+        for (size_t i=0; i < 1000 && !cond(); i++) {
+            processBlocks(1);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    };
+
+    // Warm up the synth definition's instance pool
+    sendSynth(1, 0);
+    env.sendMessage("/node/free", { 1 });
+    processUntil([&]() { return numEnded.load() == 1; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    processBlocks(1);
+    const size_t usedNumBytes = env.rtMem().statistics().usedNumBytes;
+    numEnded = 0;
+
+    env.sendMessage("/group/new", { 1, 0, kMethcla_NodePlacementTailOfGroup });
+    for (size_t i=0; i < numSynths; i++) {
+        sendSynth(100 + i, 1);
+        env.sendMessage("/synth/activate", { int32_t(100 + i) });
+    }
+    processBlocks(1);
+
+    // Node ids are released immediately ...
+    env.sendMessage("/node/free", { 1 });
+    sendSynth(100, 0);
+    processBlocks(1);
+    EXPECT_EQ( env.numErrors(), 0u );
+
+    // ... while memory is released in bounded steps
+    EXPECT_GT( env.rtMem().statistics().usedNumBytes, usedNumBytes );
+
+    // /node/ended is sent for all nodes right away
+    for (size_t i=0; i < 1000 && numEnded.load() != numSynths + 1; i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    EXPECT_EQ( numEnded.load(), numSynths + 1 );
+
+    // Release the notifications, which the worker returns to the audio thread for freeing
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    processBlocks(1);
+
+    // The budget applies to a whole callback, regardless of the number of blocks it processes
+    const size_t usedBefore = env.rtMem().statistics().usedNumBytes;
+    processBlocks(1);
+    const size_t usedAfterBlock = env.rtMem().statistics().usedNumBytes;
+    std::vector<float> longOutput(4 * env.blockSize());
+    std::vector<float*> longOutputs(1, longOutput.data());
+    env.process(0, longOutput.size(), nullptr, longOutputs.data());
+    const size_t usedAfterCallback = env.rtMem().statistics().usedNumBytes;
+    EXPECT_GT( usedBefore - usedAfterBlock, 0u );
+    EXPECT_EQ( usedAfterBlock - usedAfterCallback, usedBefore - usedAfterBlock );
+
+    processBlocks(numSynths / maxNumDestroys + 1);
+    env.sendMessage("/node/free", { 100 });
+    processUntil([&]() { return env.rtMem().statistics().usedNumBytes == usedNumBytes; });
+    EXPECT_EQ( env.rtMem().statistics().usedNumBytes, usedNumBytes );
+    EXPECT_EQ( env.numErrors(), 0u );
+}
+
+#if METHCLA_PROFILING
+TEST(Methcla_Audio_Environment, Node_profiles_should_account_synth_processing)
+{
+    std::mutex repliesMutex;
+    std::unordered_map<Methcla_RequestId,std::vector<char>> replies;
+
+    test_Methcla_Audio_Environment::TestEnvironment env(
+        test_Methcla_Audio_Environment::makeOptions(1, { methcla_plugins_sine }),
+        [&](Methcla_RequestId requestId, const void* packet, size_t size) {
+            if (requestId != kMethcla_Notification) {
+                std::lock_guard<std::mutex> lock(repliesMutex);
+                const char* data = static_cast<const char*>(packet);
+                replies[requestId] = std::vector<char>(data, data + size);
+            }
+        }
+    );
+
+    std::vector<float> output(env.blockSize());
+
+    auto processBlocks = [&](size_t numBlocks) {
+        for (size_t i=0; i < numBlocks; i++)
+            env.processBlock(0, output.data());
+    };
+
+    auto waitForReply = [&](Methcla_RequestId requestId) {
+        for (size_t i=0; i < 1000; i++) {
+            {
+                std::lock_guard<std::mutex> lock(repliesMutex);
+                auto it = replies.find(requestId);
+                if (it != replies.end())
+                    return it->second;
+            }
+            processBlocks(1);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return std::vector<char>();
+    };
+
+    auto replyArgs = [](const std::vector<char>& reply) {
+        return OSCPP::Server::Message(OSCPP::Server::Packet(reply.data(), reply.size())).args();
+    };
+
+    env.sendMessage("/group/new", { 1, 0, kMethcla_NodePlacementTailOfGroup });
+    for (int32_t nodeId : { 2, 3 }) {
+        env.sendSynth(METHCLA_PLUGINS_SINE_URI, nodeId, 1, { 440.f, 0.5f });
+        env.sendMessage("/synth/activate", { nodeId });
+    }
+
+    const size_t numBlocks = 4;
+    processBlocks(numBlocks);
+
+    // Requests are answered before processing the next block.
+    env.sendMessage("/node/profile", { 1, 2 });
+    env.sendMessage("/node/profile", { 2, 1 });
+    env.sendMessage("/synthdef/profile", { 3 });
+
+    const std::vector<char> synthReply = waitForReply(1);
+    ASSERT_FALSE( synthReply.empty() );
+    OSCPP::Server::ArgStream synthArgs(replyArgs(synthReply));
+    EXPECT_EQ( synthArgs.int32(), 2 );
+    EXPECT_EQ( synthArgs.int32(), (int32_t)numBlocks );
+    const float synthTicks = synthArgs.float32();
+    EXPECT_GT( synthTicks, 0.f );
+
+    const std::vector<char> groupReply = waitForReply(2);
+    ASSERT_FALSE( groupReply.empty() );
+    OSCPP::Server::ArgStream groupArgs(replyArgs(groupReply));
+    EXPECT_EQ( groupArgs.int32(), 1 );
+    EXPECT_EQ( groupArgs.int32(), (int32_t)(2 * numBlocks) );
+    EXPECT_GE( groupArgs.float32(), synthTicks );
+
+    const std::vector<char> defReply = waitForReply(3);
+    ASSERT_FALSE( defReply.empty() );
+    OSCPP::Server::ArgStream defArgs(replyArgs(defReply));
+    bool foundSine = false;
+    while (!defArgs.atEnd()) {
+        const std::string uri(defArgs.string());
+        const int32_t numCalls = defArgs.int32();
+        defArgs.float32();
+        if (uri == METHCLA_PLUGINS_SINE_URI) {
+            foundSine = true;
+            // Counters are read by the worker, possibly after further blocks have been processed.
+            EXPECT_GE( numCalls, (int32_t)(2 * numBlocks) );
+        }
+    }
+    EXPECT_TRUE( foundSine );
+}
+#endif
+
+TEST(Methcla_Audio_Environment, Load_statistics_should_count_overruns)
+{
+    Methcla::Audio::Environment::Options options = test_Methcla_Audio_Environment::makeOptions(1, { });
+    // A block lasts less than a nanosecond, so that every callback misses its deadline.
+    options.sampleRate = 1000000000000;
+    test_Methcla_Audio_Environment::TestEnvironment env(options);
+
+    std::vector<float> output(env.blockSize());
+
+    const size_t numCallbacks = 16;
+    for (size_t i=0; i < numCallbacks; i++) {
+        env.processBlock(i, output.data());
+    }
+
+    const Methcla_EngineLoadStatistics stats = env.loadStatistics();
+    EXPECT_EQ( stats.num_callbacks, numCallbacks );
+    EXPECT_EQ( stats.num_xruns, numCallbacks );
+    EXPECT_EQ( stats.histogram[kMethcla_EngineLoadHistogramSize-1], numCallbacks );
+    EXPECT_GE( stats.peak_load, 1. );
+    EXPECT_GT( stats.load, 0. );
+}
+
+namespace test_Methcla_Audio_Environment_Commands
+{
+    static std::atomic<int32_t> gSum(0);
+    static bool gCanOverrideBuiltins = true;
+
+    // Add the int32 argument to the sum; negative values are rejected.
+    static Methcla_ErrorCode performAdd(const Methcla_World*, void* data, const void* tag_buffer, size_t tag_size, const void* arg_buffer, size_t arg_size)
+    {
+        try {
+            OSCPP::Server::ArgStream args(
+                OSCPP::ReadStream(tag_buffer, tag_size),
+                OSCPP::ReadStream(arg_buffer, arg_size)
+            );
+            const int32_t value = args.int32();
+            if (value < 0)
+                return kMethcla_ArgumentError;
+            *static_cast<std::atomic<int32_t>*>(data) += value;
+            return kMethcla_NoError;
+        } catch (std::exception&) {
+            return kMethcla_ArgumentError;
+        }
+    }
+
+    static const Methcla_Library* library(const Methcla_Host* host, const char*)
+    {
+        Methcla_Error result = methcla_host_register_command(host, "/test/add", performAdd, &gSum);
+        assert(methcla_is_ok(result));
+        result = methcla_host_register_command(host, "/node/set", performAdd, &gSum);
+        gCanOverrideBuiltins = methcla_is_ok(result);
+        methcla_error_free(result);
+        return nullptr;
+    }
+};
+
+TEST(Methcla_Audio_Environment, Plugin_commands_should_be_dispatched)
+{
+    using namespace test_Methcla_Audio_Environment_Commands;
+
+    test_Methcla_Audio_Environment::TestEnvironment env(1, { library });
+
+    EXPECT_FALSE( gCanOverrideBuiltins );
+
+    env.sendMessage("/test/add", { 2 });
+    env.sendMessage("/test/add", { 3 });
+    env.processBlock(0);
+    EXPECT_EQ( gSum.load(), 5 );
+    EXPECT_EQ( env.numErrors(), 0u );
+
+    env.sendMessage("/test/add", { -1 });
+    env.sendMessage("/test/add", { });
+    env.sendMessage("/test/unknown", { 1 });
+    env.processBlock(1);
+    EXPECT_EQ( gSum.load(), 5 );
+    EXPECT_EQ( env.numErrors(), 2u );
+}
@@ -15,6 +15,7 @@
 #include "plugins/test-support.h"
 #include <methcla/plugin.hpp>
 
+#include <algorithm>
 #include <cmath>
 
 using namespace Methcla::Plugin;
@@ -190,6 +191,162 @@ public:
 
 StaticSynthDef<TestStats,TestStatsOptions,TestStatsPorts> kTestStatsDef;
 
+// TestTail
+
+typedef NoOptions TestTailOptions;
+
+class TestTailPorts
+{
+public:
+    enum Port
+    {
+        kInput
+      , kOutput
+      , kTailLength
+    };
+
+    static constexpr size_t numPorts() { return 3; }
+
+    static Methcla_PortDescriptor descriptor(Port port)
+    {
+        switch (port)
+        {
+            case kInput:      return Methcla::Plugin::PortDescriptor::audioInput();
+            case kOutput:     return Methcla::Plugin::PortDescriptor::audioOutput();
+            case kTailLength: return Methcla::Plugin::PortDescriptor::controlInput();
+            default: throw std::runtime_error("Invalid port index");
+        }
+    }
+};
+
+// Pass input through and report the tail length given by a control input.
+class TestTail
+{
+    float* m_ports[TestTailPorts::numPorts()];
+
+public:
+    TestTail(const World<TestTail>&, const Methcla_SynthDef*, const TestTailOptions&)
+    { }
+
+    void connect(TestTailPorts::Port port, void* data)
+    {
+        m_ports[port] = static_cast<float*>(data);
+    }
+
+    void process(const World<TestTail>&, size_t numFrames)
+    {
+        std::copy(m_ports[TestTailPorts::kInput], m_ports[TestTailPorts::kInput] + numFrames, m_ports[TestTailPorts::kOutput]);
+    }
+
+    double tailLength(const World<TestTail>&) const
+    {
+        return *m_ports[TestTailPorts::kTailLength];
+    }
+};
+
+StaticSynthDef<TestTail,TestTailOptions,TestTailPorts,kSynthDefHasTailLength> kTestTailDef;
+
+// TestControl
+
+typedef NoOptions TestControlOptions;
+
+class TestControlPorts
+{
+public:
+    enum Port
+    {
+        kInput
+      , kOutput
+    };
+
+    static constexpr size_t numPorts() { return 2; }
+
+    static Methcla_PortDescriptor descriptor(Port port)
+    {
+        switch (port)
+        {
+            case kInput:  return Methcla::Plugin::PortDescriptor::controlInput();
+            case kOutput: return Methcla::Plugin::PortDescriptor::controlOutput();
+            default: throw std::runtime_error("Invalid port index");
+        }
+    }
+};
+
+// Copy control input to control output.
+class TestControl
+{
+    float* m_ports[TestControlPorts::numPorts()];
+
+public:
+    TestControl(const World<TestControl>&, const Methcla_SynthDef*, const TestControlOptions&)
+    { }
+
+    void connect(TestControlPorts::Port port, void* data)
+    {
+        m_ports[port] = static_cast<float*>(data);
+    }
+
+    void process(const World<TestControl>&, size_t)
+    {
+        *m_ports[TestControlPorts::kOutput] = *m_ports[TestControlPorts::kInput];
+    }
+};
+
+StaticSynthDef<TestControl,TestControlOptions,TestControlPorts> kTestControlDef;
+
+// TestChannels
+
+typedef NoOptions TestChannelsOptions;
+
+class TestChannelsPorts
+{
+public:
+    typedef size_t Port;
+
+    static const size_t kNumChannels = METHCLA_TEST_CHANNELS_NUM_CHANNELS;
+
+    static constexpr size_t numPorts() { return 2 * kNumChannels; }
+
+    static Methcla_PortDescriptor descriptor(Port port)
+    {
+        if (port < kNumChannels)
+            return Methcla::Plugin::PortDescriptor::audioInput();
+        else if (port < numPorts())
+            return Methcla::Plugin::PortDescriptor::audioOutput();
+        throw std::runtime_error("Invalid port index");
+    }
+};
+
+// Add the channel number plus one to each input channel.
+class TestChannels
+{
+    float* m_ports[TestChannelsPorts::numPorts()];
+
+public:
+    TestChannels(const World<TestChannels>&, const Methcla_SynthDef*, const TestChannelsOptions&)
+    { }
+
+    void connect(TestChannelsPorts::Port port, void* data)
+    {
+        m_ports[port] = static_cast<float*>(data);
+    }
+
+    void process(const World<TestChannels>&, size_t numFrames)
+    {
+        for (size_t c=0; c < TestChannelsPorts::kNumChannels; c++)
+        {
+            const float* input = m_ports[c];
+            float* output = m_ports[TestChannelsPorts::kNumChannels + c];
+            for (size_t i=0; i < numFrames; i++)
+            {
+                output[i] = input[i] + float(c + 1);
+            }
+        }
+    }
+};
+
+StaticSynthDef<TestChannels,TestChannelsOptions,TestChannelsPorts> kTestChannelsDef;
+
 // Library
 const Methcla_Library library = { NULL, NULL };
 
@@ -198,5 +355,8 @@ const Methcla_Library library = { NULL, NULL };
 METHCLA_EXPORT const Methcla_Library* methcla_plugins_test_support(const Methcla_Host* host, const char* /* bundlePath */)
 {
     kTestStatsDef(host, METHCLA_PLUGINS_TEST_STATS_URI);
+    kTestTailDef(host, METHCLA_PLUGINS_TEST_TAIL_URI);
+    kTestControlDef(host, METHCLA_PLUGINS_TEST_CONTROL_URI);
+    kTestChannelsDef(host, METHCLA_PLUGINS_TEST_CHANNELS_URI);
     return &library;
 }
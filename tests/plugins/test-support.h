@@ -23,5 +23,9 @@ METHCLA_EXPORT const Methcla_Library* methcla_plugins_test_support(const Methcla
 
 #define METHCLA_PLUGINS_TEST_STATS_URI METHCLA_PLUGINS_URI "/test/stats"
 #define METHCLA_TEST_STATS_OUTPUT_PREFIX "{TEST_STATS}"
+#define METHCLA_PLUGINS_TEST_TAIL_URI METHCLA_PLUGINS_URI "/test/tail"
+#define METHCLA_PLUGINS_TEST_CONTROL_URI METHCLA_PLUGINS_URI "/test/control"
+#define METHCLA_PLUGINS_TEST_CHANNELS_URI METHCLA_PLUGINS_URI "/test/channels"
+#define METHCLA_TEST_CHANNELS_NUM_CHANNELS 4
 
 #endif // METHCLA_PLUGINS_TEST_SUPPORT_H_INCLUDED